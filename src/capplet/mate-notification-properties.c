@@ -301,16 +301,70 @@ static gchar* get_theme_name(const gchar* filename)
 	return result;
 }
 
+static gboolean has_theme(GtkListStore* store, const gchar* theme_name)
+{
+	GtkTreeIter iter;
+	gboolean valid;
+	gboolean found = FALSE;
+
+	for (valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(store), &iter); valid && !found; valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(store), &iter))
+	{
+		gchar* name;
+
+		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, NOTIFY_THEME_NAME, &name, -1);
+		found = g_str_equal(name, theme_name);
+		g_free(name);
+	}
+
+	return found;
+}
+
+/* filename is NULL for the engines linked into the daemon */
+static void add_theme(GtkListStore* store, const gchar* theme_name, const gchar* filename)
+{
+	GtkTreeIter iter;
+	char* theme_label;
+
+	/* FIXME: other solution than hardcode? */
+	if (g_str_equal(theme_name, "coco"))
+	{
+		theme_label = g_strdup(_("Coco"));
+	}
+	else if (g_str_equal(theme_name, "nodoka"))
+	{
+		theme_label = g_strdup(_("Nodoka"));
+	}
+	else if (g_str_equal(theme_name, "slider"))
+	{
+		theme_label = g_strdup(_("Slider"));
+	}
+	else if (g_str_equal(theme_name, "standard"))
+	{
+		theme_label = g_strdup(_("Standard theme"));
+	}
+	else
+	{
+		theme_label = g_strdup(theme_name);
+	}
+
+	gtk_list_store_append(store, &iter);
+	gtk_list_store_set(store, &iter, NOTIFY_THEME_LABEL, theme_label, NOTIFY_THEME_NAME, theme_name, NOTIFY_THEME_FILENAME, filename, -1);
+	g_free(theme_label);
+}
+
 static void notification_properties_dialog_setup_themes(NotificationAppletDialog* dialog)
 {
 	GDir* dir;
 	const gchar* filename;
 	char* theme;
 	char* theme_name;
-	char* theme_label;
 	gboolean valid;
 	GtkListStore* store;
 	GtkTreeIter iter;
+#ifdef ENABLE_BUILTIN_ENGINES
+	static const gchar* builtin_themes[] = {"coco", "nodoka", "slider", "standard"};
+	guint i;
+#endif
 
 	store = gtk_list_store_new(N_COLUMNS_THEME, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
 
@@ -319,6 +373,15 @@ static void notification_properties_dialog_setup_themes(NotificationAppletDialog
 	g_signal_connect(dialog->gsettings, "changed::" GSETTINGS_KEY_THEME, G_CALLBACK (notification_properties_theme_notify), dialog);
 	g_signal_connect(dialog->theme_combo, "changed", G_CALLBACK(notification_properties_theme_changed), dialog);
 
+#ifdef ENABLE_BUILTIN_ENGINES
+	/* Linked into the daemon, so nothing of them is installed */
+	for (i = 0; i < G_N_ELEMENTS(builtin_themes); i++)
+	{
+		add_theme(store, builtin_themes[i], NULL);
+	}
+#endif
+
+	/* Third party engines are still loaded as modules */
 	if ((dir = g_dir_open(ENGINES_DIR, 0, NULL)))
 	{
 		while ((filename = g_dir_read_name(dir)))
@@ -327,41 +390,23 @@ static void notification_properties_dialog_setup_themes(NotificationAppletDialog
 			{
 				theme_name = get_theme_name(filename);
 
-				/* FIXME: other solution than hardcode? */
-				if (g_str_equal(theme_name, "coco"))
-				{
-					theme_label = g_strdup(_("Coco"));
-				}
-				else if (g_str_equal(theme_name, "nodoka"))
-				{
-					theme_label = g_strdup(_("Nodoka"));
-				}
-				else if (g_str_equal(theme_name, "slider"))
+				if (!has_theme(store, theme_name))
 				{
-					theme_label = g_strdup(_("Slider"));
-				}
-				else if (g_str_equal(theme_name, "standard"))
-				{
-					theme_label = g_strdup(_("Standard theme"));
-				}
-				else
-				{
-					theme_label = g_strdup(theme_name);
+					add_theme(store, theme_name, filename);
 				}
 
-				gtk_list_store_append(store, &iter);
-				gtk_list_store_set(store, &iter, NOTIFY_THEME_LABEL, theme_label, NOTIFY_THEME_NAME, theme_name, NOTIFY_THEME_FILENAME, filename, -1);
 				g_free(theme_name);
-				g_free(theme_label);
 			}
 		}
 
 		g_dir_close(dir);
 	}
+#ifndef ENABLE_BUILTIN_ENGINES
 	else
 	{
 		g_warning("Error opening themes dir");
 	}
+#endif
 
 	theme = g_settings_get_string(dialog->gsettings, GSETTINGS_KEY_THEME);
 
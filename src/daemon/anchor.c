@@ -0,0 +1,325 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+
+#include "anchor.h"
+
+typedef struct {
+	xcb_window_t window;
+	gint16       x;
+	gint16       y;
+	guint16      width;
+	guint16      height;
+	guint16      border_width;
+} AnchorLevel;
+
+/* Windows this client only listens to for anchors, see select_window() */
+static GHashTable* selected_windows = NULL;
+
+struct _NotifyAnchor {
+	xcb_connection_t* conn;
+	xcb_window_t      source;
+	xcb_window_t      root;
+
+	/* source first, root excluded */
+	GArray*           levels;
+	GArray*           windows;
+};
+
+NotifyAnchor* notify_anchor_new(Display* display, Window source)
+{
+	NotifyAnchor* anchor;
+
+	anchor = g_new0(NotifyAnchor, 1);
+	anchor->conn = XGetXCBConnection(display);
+	anchor->source = source;
+	anchor->levels = g_array_new(FALSE, FALSE, sizeof(AnchorLevel));
+	anchor->windows = g_array_new(FALSE, FALSE, sizeof(Window));
+
+	notify_anchor_refresh(anchor);
+
+	return anchor;
+}
+
+void notify_anchor_free(NotifyAnchor* anchor)
+{
+	g_array_free(anchor->levels, TRUE);
+	g_array_free(anchor->windows, TRUE);
+	g_free(anchor);
+}
+
+/*
+ * Adds StructureNotify to the events this client selects on window,
+ * keeping what GDK or wnck selected there through the same connection.
+ * Returns a null cookie if nothing had to be sent.
+ */
+static xcb_void_cookie_t select_window(NotifyAnchor* anchor, xcb_window_t window, xcb_get_window_attributes_reply_t* attributes)
+{
+	xcb_void_cookie_t cookie = { 0 };
+	guint32 event_mask;
+
+	if (attributes == NULL || (attributes->your_event_mask & XCB_EVENT_MASK_STRUCTURE_NOTIFY) != 0)
+	{
+		return cookie;
+	}
+
+	if (selected_windows == NULL)
+	{
+		selected_windows = g_hash_table_new(NULL, NULL);
+	}
+
+	g_hash_table_add(selected_windows, GUINT_TO_POINTER(window));
+
+	event_mask = attributes->your_event_mask | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+
+	return xcb_change_window_attributes_checked(anchor->conn, window, XCB_CW_EVENT_MASK, &event_mask);
+}
+
+/*
+ * Walk from the source window up to the root. Each level costs one
+ * QueryTree round trip since the next parent is only known from its
+ * reply, but the attributes sent before it are answered by then, and
+ * the event selection and the geometry requests of every level ride
+ * along and are collected at the end. Errors come back in the replies,
+ * so no XSync is needed.
+ */
+gboolean notify_anchor_refresh(NotifyAnchor* anchor)
+{
+	GArray* select_cookies;
+	GArray* geometry_cookies;
+	xcb_window_t window = anchor->source;
+	gboolean ok = TRUE;
+	guint i;
+
+	g_array_set_size(anchor->levels, 0);
+	g_array_set_size(anchor->windows, 0);
+	anchor->root = XCB_WINDOW_NONE;
+
+	select_cookies = g_array_new(FALSE, FALSE, sizeof(xcb_void_cookie_t));
+	geometry_cookies = g_array_new(FALSE, FALSE, sizeof(xcb_get_geometry_cookie_t));
+
+	while (window != XCB_WINDOW_NONE)
+	{
+		xcb_get_window_attributes_cookie_t attributes_cookie;
+		xcb_query_tree_cookie_t tree_cookie;
+		xcb_void_cookie_t select_cookie;
+		xcb_get_geometry_cookie_t geometry_cookie;
+		xcb_get_window_attributes_reply_t* attributes;
+		xcb_query_tree_reply_t* tree;
+		Window xid = window;
+
+		attributes_cookie = xcb_get_window_attributes(anchor->conn, window);
+		tree_cookie = xcb_query_tree(anchor->conn, window);
+		geometry_cookie = xcb_get_geometry(anchor->conn, window);
+
+		g_array_append_val(geometry_cookies, geometry_cookie);
+		g_array_append_val(anchor->windows, xid);
+
+		tree = xcb_query_tree_reply(anchor->conn, tree_cookie, NULL);
+
+		/* Already answered, so this does not wait */
+		attributes = xcb_get_window_attributes_reply(anchor->conn, attributes_cookie, NULL);
+		select_cookie = select_window(anchor, window, attributes);
+		g_array_append_val(select_cookies, select_cookie);
+		free(attributes);
+
+		if (tree == NULL)
+		{
+			ok = FALSE;
+			break;
+		}
+
+		anchor->root = tree->root;
+		window = tree->parent == tree->root ? XCB_WINDOW_NONE : tree->parent;
+		free(tree);
+	}
+
+	for (i = 0; i < geometry_cookies->len; i++)
+	{
+		xcb_get_geometry_reply_t* geometry;
+		xcb_generic_error_t* error;
+		AnchorLevel level;
+
+		geometry = xcb_get_geometry_reply(anchor->conn, g_array_index(geometry_cookies, xcb_get_geometry_cookie_t, i), NULL);
+
+		/* Already answered, so this does not wait */
+		if (g_array_index(select_cookies, xcb_void_cookie_t, i).sequence != 0)
+		{
+			error = xcb_request_check(anchor->conn, g_array_index(select_cookies, xcb_void_cookie_t, i));
+
+			if (error != NULL)
+			{
+				free(error);
+			}
+		}
+
+		if (geometry == NULL)
+		{
+			ok = FALSE;
+			continue;
+		}
+
+		level.window = g_array_index(anchor->windows, Window, i);
+		level.x = geometry->x;
+		level.y = geometry->y;
+		level.width = geometry->width;
+		level.height = geometry->height;
+		level.border_width = geometry->border_width;
+		g_array_append_val(anchor->levels, level);
+
+		free(geometry);
+	}
+
+	g_array_free(select_cookies, TRUE);
+	g_array_free(geometry_cookies, TRUE);
+
+	if (!ok)
+	{
+		g_array_set_size(anchor->levels, 0);
+	}
+
+	return ok;
+}
+
+/*
+ * Stop listening to a window nobody is anchored to anymore. Only the
+ * StructureNotify added by select_window() is taken away; windows that
+ * had it selected before are left alone. The window may already be gone,
+ * so errors are dropped instead of reaching the Xlib error handler.
+ */
+void notify_anchor_unselect_window(NotifyAnchor* anchor, Window window)
+{
+	xcb_get_window_attributes_reply_t* attributes;
+	xcb_void_cookie_t cookie;
+	guint32 event_mask;
+
+	if (selected_windows == NULL || !g_hash_table_remove(selected_windows, GUINT_TO_POINTER(window)))
+	{
+		return;
+	}
+
+	/* The mask may have changed since it was selected */
+	attributes = xcb_get_window_attributes_reply(anchor->conn, xcb_get_window_attributes(anchor->conn, window), NULL);
+
+	if (attributes == NULL)
+	{
+		return;
+	}
+
+	event_mask = attributes->your_event_mask & ~XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+	free(attributes);
+
+	cookie = xcb_change_window_attributes_checked(anchor->conn, window, XCB_CW_EVENT_MASK, &event_mask);
+	xcb_discard_reply(anchor->conn, cookie.sequence);
+}
+
+/* A destroyed window's XID may be reused by one this client never selected */
+void notify_anchor_forget_window(Window window)
+{
+	if (selected_windows != NULL)
+	{
+		g_hash_table_remove(selected_windows, GUINT_TO_POINTER(window));
+	}
+}
+
+Window notify_anchor_get_source(NotifyAnchor* anchor)
+{
+	return anchor->source;
+}
+
+/* Every window whose StructureNotify events affect the anchor */
+GArray* notify_anchor_get_windows(NotifyAnchor* anchor)
+{
+	return anchor->windows;
+}
+
+/* Center of the source window in root coordinates */
+gboolean notify_anchor_get_position(NotifyAnchor* anchor, int* x, int* y)
+{
+	AnchorLevel* source;
+	guint i;
+
+	if (anchor->levels->len == 0)
+	{
+		return FALSE;
+	}
+
+	source = &g_array_index(anchor->levels, AnchorLevel, 0);
+	*x = source->width / 2;
+	*y = source->height / 2;
+
+	for (i = 0; i < anchor->levels->len; i++)
+	{
+		AnchorLevel* level = &g_array_index(anchor->levels, AnchorLevel, i);
+
+		*x += level->x + level->border_width;
+		*y += level->y + level->border_width;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Apply a ConfigureNotify to the cached geometry. Synthetic events from
+ * the window manager carry root coordinates and are ignored, the real
+ * event of the frame follows. Returns TRUE if the anchor moved.
+ */
+gboolean notify_anchor_configure(NotifyAnchor* anchor, XConfigureEvent* event)
+{
+	guint i;
+
+	if (event->send_event)
+	{
+		return FALSE;
+	}
+
+	for (i = 0; i < anchor->levels->len; i++)
+	{
+		AnchorLevel* level = &g_array_index(anchor->levels, AnchorLevel, i);
+
+		if (level->window != event->window)
+		{
+			continue;
+		}
+
+		if (level->x == event->x && level->y == event->y
+			&& level->border_width == event->border_width
+			&& (i > 0 || (level->width == event->width && level->height == event->height)))
+		{
+			return FALSE;
+		}
+
+		level->x = event->x;
+		level->y = event->y;
+		level->width = event->width;
+		level->height = event->height;
+		level->border_width = event->border_width;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_ANCHOR_H_
+#define _NOTIFY_ANCHOR_H_
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+/*
+ * The window a notification points at (window-xid hint) along with its
+ * ancestors up to the root. Geometry of every level is cached so the
+ * anchor position can be computed without talking to the X server, and
+ * kept current from ConfigureNotify events.
+ */
+typedef struct _NotifyAnchor NotifyAnchor;
+
+NotifyAnchor* notify_anchor_new(Display* display, Window source);
+void notify_anchor_free(NotifyAnchor* anchor);
+
+gboolean notify_anchor_refresh(NotifyAnchor* anchor);
+void notify_anchor_unselect_window(NotifyAnchor* anchor, Window window);
+void notify_anchor_forget_window(Window window);
+Window notify_anchor_get_source(NotifyAnchor* anchor);
+GArray* notify_anchor_get_windows(NotifyAnchor* anchor);
+gboolean notify_anchor_get_position(NotifyAnchor* anchor, int* x, int* y);
+gboolean notify_anchor_configure(NotifyAnchor* anchor, XConfigureEvent* event);
+
+#endif /* _NOTIFY_ANCHOR_H_ */
@@ -0,0 +1,315 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Times every step of showing a notification with each engine, offscreen:
+ * creating the window, setting its content, laying it out, painting it
+ * the first time, painting it again and painting countdown ticks. Runs
+ * over several body lengths and icon sizes, with the engines drawing
+ * both composited and shaped windows, and prints the results as JSON.
+ *
+ *   bench-engines [-n ITERATIONS] [-w WIDTH] ENGINE...
+ *
+ * ENGINE is a theme name or the path of an engine module. A display is
+ * needed, Xvfb will do.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "daemon.h"
+#include "engines.h"
+#include "render.h"
+
+/* Bodies longer than what the daemon shows uncut are not measured */
+static const gsize body_lengths[] = {0, 80, 400, 1024};
+static const int icon_sizes[] = {0, 16, 48, 128};
+
+static const struct {
+	const char* name;
+	NotifyEngineCompositing compositing;
+} modes[] = {
+	{"composited", NOTIFY_ENGINE_COMPOSITING_ON},
+	{"shaped", NOTIFY_ENGINE_COMPOSITING_OFF}
+};
+
+static const NotificationAction actions[] = {
+	{"Reply", "reply"},
+	{"Dismiss", "dismiss"}
+};
+
+#define TIMEOUT 7000
+
+typedef enum {
+	STEP_CREATE,
+	STEP_SET_CONTENT,
+	STEP_LAYOUT,
+	STEP_FIRST_PAINT,
+	STEP_REPAINT,
+	STEP_TICK,
+	N_STEPS
+} Step;
+
+static const char* const step_names[] = {
+	"create",
+	"set-content",
+	"layout",
+	"first-paint",
+	"repaint",
+	"tick"
+};
+
+typedef struct {
+	gint64 total;
+	gint64 min;
+	guint count;
+} Timing;
+
+static void action_invoked_cb(GtkWindow* nw, const char* key)
+{
+}
+
+static void add_timing(Timing* timing, gint64 usec)
+{
+	if (timing->count == 0 || usec < timing->min)
+	{
+		timing->min = usec;
+	}
+
+	timing->total += usec;
+	timing->count++;
+}
+
+/* Lorem ipsum with a little markup, as bodies tend to have */
+static char* make_body(gsize length)
+{
+	static const char* const words[] = {"lorem", "<b>ipsum</b>", "dolor", "sit", "<i>amet</i>,", "consectetur", "adipiscing", "elit."};
+	GString* body;
+	guint i = 0;
+
+	body = g_string_sized_new(length + 16);
+
+	while (body->len < length)
+	{
+		g_string_append(body, words[i++ % G_N_ELEMENTS(words)]);
+		g_string_append_c(body, ' ');
+	}
+
+	return g_string_free(body, FALSE);
+}
+
+static GdkPixbuf* make_icon(int size)
+{
+	GdkPixbuf* icon;
+
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	icon = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+	gdk_pixbuf_fill(icon, 0x3465a4ff);
+
+	return icon;
+}
+
+/* "coco" for both "coco" and ".../.libs/libcoco.so" */
+static char* get_engine_name(const char* engine)
+{
+	char* name;
+	char* dot;
+
+	name = g_path_get_basename(engine);
+
+	if (g_str_has_prefix(name, "lib"))
+	{
+		memmove(name, name + 3, strlen(name + 3) + 1);
+	}
+
+	if ((dot = strchr(name, '.')) != NULL)
+	{
+		*dot = '\0';
+	}
+
+	return name;
+}
+
+static void run_case(ThemeEngine* engine, const NotificationContent* content, guint iterations, int width, Timing* timings, int* out_width, int* out_height)
+{
+	NotifyRender* render;
+	gint64 start;
+	guint i;
+
+	for (i = 0; i < iterations; i++)
+	{
+		start = g_get_monotonic_time();
+		render = notify_render_new(engine);
+		add_timing(&timings[STEP_CREATE], g_get_monotonic_time() - start);
+
+		start = g_get_monotonic_time();
+		notify_render_set_content(render, content);
+		add_timing(&timings[STEP_SET_CONTENT], g_get_monotonic_time() - start);
+
+		start = g_get_monotonic_time();
+		notify_render_layout(render, width, out_width, out_height);
+		add_timing(&timings[STEP_LAYOUT], g_get_monotonic_time() - start);
+
+		start = g_get_monotonic_time();
+		notify_render_paint(render);
+		add_timing(&timings[STEP_FIRST_PAINT], g_get_monotonic_time() - start);
+
+		start = g_get_monotonic_time();
+		notify_render_paint(render);
+		add_timing(&timings[STEP_REPAINT], g_get_monotonic_time() - start);
+
+		/* A tick that moves the pie, and the paint it asks for */
+		start = g_get_monotonic_time();
+		theme_notification_tick(notify_render_get_window(render), TIMEOUT - (glong) (i + 1) * TIMEOUT / (iterations + 1));
+		notify_render_paint(render);
+		add_timing(&timings[STEP_TICK], g_get_monotonic_time() - start);
+
+		notify_render_free(render);
+	}
+}
+
+static void print_case(const char* engine_name, const char* mode, gsize body_length, int icon_size, int width, int height, const Timing* timings, gboolean first)
+{
+	guint i;
+
+	g_print("%s\n    {\"engine\": \"%s\", \"mode\": \"%s\", \"body-bytes\": %" G_GSIZE_FORMAT ", \"icon-size\": %d, \"width\": %d, \"height\": %d,\n",
+			first ? "" : ",", engine_name, mode, body_length, icon_size, width, height);
+
+	for (i = 0; i < N_STEPS; i++)
+	{
+		g_print("      \"%s\": {\"mean-usec\": %.1f, \"min-usec\": %" G_GINT64_FORMAT "}%s\n",
+				step_names[i], (gdouble) timings[i].total / MAX(timings[i].count, 1), timings[i].min, i + 1 < N_STEPS ? "," : "}");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	guint iterations = 20;
+	int width = 300;
+	GdkScreen* screen;
+	NotificationContent content;
+	ThemeEngine* engine;
+	Timing timings[N_STEPS];
+	gboolean first = TRUE;
+	char* engine_name;
+	char* body;
+	GdkPixbuf* icon;
+	int out_width = 0;
+	int out_height = 0;
+	guint m, b, s;
+	int i;
+
+	gtk_init(&argc, &argv);
+
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+	{
+		if (strcmp(argv[i], "-n") == 0)
+		{
+			iterations = MAX((guint) strtoul(argv[i + 1], NULL, 10), 1);
+		}
+		else if (strcmp(argv[i], "-w") == 0)
+		{
+			width = atoi(argv[i + 1]);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (i >= argc)
+	{
+		g_printerr("Usage: %s [-n ITERATIONS] [-w WIDTH] ENGINE...\n", argv[0]);
+		return 1;
+	}
+
+	screen = gdk_screen_get_default();
+
+	memset(&content, 0, sizeof(content));
+	content.summary = "Build finished";
+	content.urgency = URGENCY_NORMAL;
+	content.actions = actions;
+	content.n_actions = G_N_ELEMENTS(actions);
+	content.action_cb = G_CALLBACK(action_invoked_cb);
+	content.timeout = TIMEOUT;
+	content.changed = NOTIFICATION_CONTENT_ALL;
+
+	g_print("{\n  \"iterations\": %u,\n  \"requested-width\": %d,\n  \"display-composited\": %s,\n  \"results\": [",
+			iterations, width, gdk_screen_is_composited(screen) ? "true" : "false");
+
+	for (; i < argc; i++)
+	{
+		engine = theme_engine_open(argv[i]);
+
+		if (engine == NULL)
+		{
+			g_printerr("Unable to load theme engine '%s'\n", argv[i]);
+			continue;
+		}
+
+		engine_name = get_engine_name(argv[i]);
+
+		for (m = 0; m < G_N_ELEMENTS(modes); m++)
+		{
+			g_object_set_data(G_OBJECT(screen), NOTIFY_ENGINE_COMPOSITING_KEY, GINT_TO_POINTER(modes[m].compositing));
+
+			for (b = 0; b < G_N_ELEMENTS(body_lengths); b++)
+			{
+				body = make_body(body_lengths[b]);
+				content.body = body;
+
+				for (s = 0; s < G_N_ELEMENTS(icon_sizes); s++)
+				{
+					icon = make_icon(icon_sizes[s]);
+					content.icon = icon;
+
+					memset(timings, 0, sizeof(timings));
+					run_case(engine, &content, iterations, width, timings, &out_width, &out_height);
+					print_case(engine_name, modes[m].name, strlen(body), icon_sizes[s], out_width, out_height, timings, first);
+					first = FALSE;
+
+					if (icon != NULL)
+					{
+						g_object_unref(icon);
+					}
+				}
+
+				g_free(body);
+			}
+		}
+
+		g_object_set_data(G_OBJECT(screen), NOTIFY_ENGINE_COMPOSITING_KEY, NULL);
+
+		g_free(engine_name);
+		theme_engine_close(engine);
+	}
+
+	g_print("\n  ]\n}\n");
+
+	return 0;
+}
@@ -0,0 +1,173 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Measures notify_sanitize_markup() over a corpus of notification bodies:
+ * the built-in one below, collected from common senders, or the files
+ * given on the command line, one body per file.
+ *
+ *   bench-sanitize [-n ROUNDS] [-b MAX_BYTES] [-l MAX_LINES] [FILE...]
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "sanitize.h"
+
+static const char* const builtin_corpus[] = {
+	"Battery is at 5%. Plug in your charger.",
+	"You have 3 new messages",
+	"<b>Download complete</b>\nubuntu-22.04-desktop-amd64.iso",
+	"<b>Alice</b>: are we still on for lunch? &#x1F354;",
+	"Now playing: <i>Sonata No. 14 in C&#9839; minor</i>\nby Ludwig van Beethoven",
+	"Connection established to <a href=\"https://example.org/wifi\">Home Network</a>",
+	"<img src=\"file:///usr/share/icons/hicolor/48x48/apps/cheese.png\" alt=\"Photo\"/> Photo saved to ~/Pictures",
+	"Build #4512 <b>failed</b> on <u>master</u>: test_parse <i>(3 of 812)</i> & lint",
+	"if (a < b && b > c) { return &x; }",
+	"<span foreground=\"red\">Disk almost full</span>: 512 MB left on /home",
+	"<b><i>Unbalanced</b> markup</i> from a careless sender <br/> with <p>html</p>",
+	"Ünïcödé text: Grüße aus Köln — ничего страшного — 日本語のテキスト",
+	"Reminder: <b>Stand-up</b> in 5 minutes\n<a href=\"https://meet.example.com/abc-defg-hij?pwd=1&amp;x=2\">Join meeting</a>\nRoom 4.12",
+	"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur.",
+};
+
+static gchar** load_corpus(int argc, char** argv, guint* n_bodies)
+{
+	gchar** corpus;
+	GError* error = NULL;
+	guint n = 0;
+	int i;
+
+	if (argc == 0)
+	{
+		*n_bodies = G_N_ELEMENTS(builtin_corpus);
+		corpus = g_new0(gchar*, *n_bodies + 1);
+
+		for (i = 0; i < (int) *n_bodies; i++)
+		{
+			corpus[i] = g_strdup(builtin_corpus[i]);
+		}
+
+		return corpus;
+	}
+
+	corpus = g_new0(gchar*, argc + 1);
+
+	for (i = 0; i < argc; i++)
+	{
+		if (!g_file_get_contents(argv[i], &corpus[n], NULL, &error))
+		{
+			g_printerr("%s\n", error->message);
+			g_clear_error(&error);
+			continue;
+		}
+
+		n++;
+	}
+
+	*n_bodies = n;
+
+	return corpus;
+}
+
+int main(int argc, char** argv)
+{
+	gchar** corpus;
+	guint n_bodies;
+	guint rounds = 20000;
+	gsize max_bytes = 16384;
+	guint max_lines = 0;
+	gsize total_bytes = 0;
+	guint n_truncated = 0;
+	gint64 start;
+	gint64 elapsed;
+	gboolean truncated;
+	guint i;
+	guint j;
+
+	while (argc > 2 && argv[1][0] == '-')
+	{
+		if (strcmp(argv[1], "-n") == 0)
+		{
+			rounds = (guint) strtoul(argv[2], NULL, 10);
+		}
+		else if (strcmp(argv[1], "-b") == 0)
+		{
+			max_bytes = (gsize) strtoul(argv[2], NULL, 10);
+		}
+		else if (strcmp(argv[1], "-l") == 0)
+		{
+			max_lines = (guint) strtoul(argv[2], NULL, 10);
+		}
+		else
+		{
+			break;
+		}
+
+		argc -= 2;
+		argv += 2;
+	}
+
+	corpus = load_corpus(argc - 1, argv + 1, &n_bodies);
+
+	if (n_bodies == 0 || rounds == 0)
+	{
+		g_printerr("Nothing to sanitize\n");
+		g_strfreev(corpus);
+		return 1;
+	}
+
+	for (i = 0; i < n_bodies; i++)
+	{
+		total_bytes += strlen(corpus[i]);
+		g_free(notify_sanitize_markup(corpus[i], max_bytes, max_lines, &truncated));
+
+		if (truncated)
+		{
+			n_truncated++;
+		}
+	}
+
+	start = g_get_monotonic_time();
+
+	for (j = 0; j < rounds; j++)
+	{
+		for (i = 0; i < n_bodies; i++)
+		{
+			g_free(notify_sanitize_markup(corpus[i], max_bytes, max_lines, NULL));
+		}
+	}
+
+	elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+	g_print("bodies: %u (%" G_GSIZE_FORMAT " bytes, %u truncated at %" G_GSIZE_FORMAT " bytes, %u lines)\n", n_bodies, total_bytes, n_truncated, max_bytes, max_lines);
+	g_print("rounds: %u\n", rounds);
+	g_print("time per body: %.1f ns\n", elapsed * 1000.0 / ((gdouble) rounds * n_bodies));
+	g_print("throughput: %.1f MB/s\n", (gdouble) total_bytes * rounds / elapsed);
+
+	g_strfreev(corpus);
+
+	return 0;
+}
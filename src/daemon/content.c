@@ -0,0 +1,308 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "content.h"
+
+/* Image hints are large, and compared as the icon they turn into */
+static gboolean is_image_hint(const char* key)
+{
+	return strcmp(key, "image-data") == 0
+		|| strcmp(key, "image_data") == 0
+		|| strcmp(key, "image-path") == 0
+		|| strcmp(key, "image_path") == 0
+		|| strcmp(key, "icon_data") == 0;
+}
+
+static void free_hint_value(GValue* value)
+{
+	g_value_unset(value);
+	g_free(value);
+}
+
+static GHashTable* copy_hints(GHashTable* hints)
+{
+	GHashTable* copy;
+	GHashTableIter iter;
+	const char* key;
+	GValue* value;
+
+	copy = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) free_hint_value);
+
+	if (hints == NULL)
+	{
+		return copy;
+	}
+
+	g_hash_table_iter_init(&iter, hints);
+
+	while (g_hash_table_iter_next(&iter, (gpointer*) &key, (gpointer*) &value))
+	{
+		GValue* value_copy;
+
+		if (is_image_hint(key))
+		{
+			continue;
+		}
+
+		value_copy = g_new0(GValue, 1);
+		g_value_init(value_copy, G_VALUE_TYPE(value));
+		g_value_copy(value, value_copy);
+
+		g_hash_table_insert(copy, g_strdup(key), value_copy);
+	}
+
+	return copy;
+}
+
+NotificationContent* notification_content_copy(const NotificationContent* content)
+{
+	NotificationContent* copy;
+	NotificationAction* actions;
+	guint i;
+
+	copy = g_new(NotificationContent, 1);
+	*copy = *content;
+	copy->summary = g_strdup(content->summary);
+	copy->body = g_strdup(content->body);
+	copy->hints = copy_hints(content->hints);
+	copy->changed = 0;
+
+	actions = g_new(NotificationAction, content->n_actions);
+
+	for (i = 0; i < content->n_actions; i++)
+	{
+		actions[i].label = g_strdup(content->actions[i].label);
+		actions[i].key = g_strdup(content->actions[i].key);
+	}
+
+	copy->actions = actions;
+
+	if (copy->icon != NULL)
+	{
+		g_object_ref(copy->icon);
+	}
+
+	return copy;
+}
+
+void notification_content_free(NotificationContent* content)
+{
+	guint i;
+
+	for (i = 0; i < content->n_actions; i++)
+	{
+		g_free((gchar*) content->actions[i].label);
+		g_free((gchar*) content->actions[i].key);
+	}
+
+	g_free((NotificationAction*) content->actions);
+	g_free((gchar*) content->summary);
+	g_free((gchar*) content->body);
+	g_hash_table_destroy(content->hints);
+
+	if (content->icon != NULL)
+	{
+		g_object_unref(content->icon);
+	}
+
+	g_free(content);
+}
+
+/* Clients resend the same icon with every update, compare the pixels */
+static gboolean icons_equal(GdkPixbuf* a, GdkPixbuf* b)
+{
+	int height;
+	int rowstride;
+	gsize length;
+
+	if (a == b)
+	{
+		return TRUE;
+	}
+
+	if (a == NULL || b == NULL)
+	{
+		return FALSE;
+	}
+
+	height = gdk_pixbuf_get_height(a);
+	rowstride = gdk_pixbuf_get_rowstride(a);
+
+	if (gdk_pixbuf_get_width(a) != gdk_pixbuf_get_width(b)
+		|| height != gdk_pixbuf_get_height(b)
+		|| rowstride != gdk_pixbuf_get_rowstride(b)
+		|| gdk_pixbuf_get_n_channels(a) != gdk_pixbuf_get_n_channels(b)
+		|| gdk_pixbuf_get_has_alpha(a) != gdk_pixbuf_get_has_alpha(b))
+	{
+		return FALSE;
+	}
+
+	/* The last row isn't padded to the rowstride */
+	length = (gsize) rowstride * (height - 1) + gdk_pixbuf_get_width(a) * ((gdk_pixbuf_get_n_channels(a) * gdk_pixbuf_get_bits_per_sample(a) + 7) / 8);
+
+	return memcmp(gdk_pixbuf_get_pixels(a), gdk_pixbuf_get_pixels(b), length) == 0;
+}
+
+static gboolean hint_values_equal(const GValue* a, const GValue* b)
+{
+	gchar* a_contents;
+	gchar* b_contents;
+	gboolean equal;
+
+	if (G_VALUE_TYPE(a) != G_VALUE_TYPE(b))
+	{
+		return FALSE;
+	}
+
+	switch (G_TYPE_FUNDAMENTAL(G_VALUE_TYPE(a)))
+	{
+		case G_TYPE_BOOLEAN:
+			return g_value_get_boolean(a) == g_value_get_boolean(b);
+		case G_TYPE_UCHAR:
+			return g_value_get_uchar(a) == g_value_get_uchar(b);
+		case G_TYPE_INT:
+			return g_value_get_int(a) == g_value_get_int(b);
+		case G_TYPE_UINT:
+			return g_value_get_uint(a) == g_value_get_uint(b);
+		case G_TYPE_INT64:
+			return g_value_get_int64(a) == g_value_get_int64(b);
+		case G_TYPE_UINT64:
+			return g_value_get_uint64(a) == g_value_get_uint64(b);
+		case G_TYPE_DOUBLE:
+			return g_value_get_double(a) == g_value_get_double(b);
+		case G_TYPE_STRING:
+			return g_strcmp0(g_value_get_string(a), g_value_get_string(b)) == 0;
+		default:
+			break;
+	}
+
+	/* Structs and arrays, rare outside of the image hints */
+	a_contents = g_strdup_value_contents(a);
+	b_contents = g_strdup_value_contents(b);
+	equal = strcmp(a_contents, b_contents) == 0;
+	g_free(a_contents);
+	g_free(b_contents);
+
+	return equal;
+}
+
+/* old comes from notification_content_copy(), so it has no image hints */
+static gboolean hints_equal(GHashTable* old, GHashTable* hints)
+{
+	GHashTableIter iter;
+	const char* key;
+	GValue* value;
+	guint n_hints = 0;
+
+	if (hints != NULL)
+	{
+		g_hash_table_iter_init(&iter, hints);
+
+		while (g_hash_table_iter_next(&iter, (gpointer*) &key, (gpointer*) &value))
+		{
+			GValue* old_value;
+
+			if (is_image_hint(key))
+			{
+				continue;
+			}
+
+			old_value = old != NULL ? g_hash_table_lookup(old, key) : NULL;
+
+			if (old_value == NULL || !hint_values_equal(old_value, value))
+			{
+				return FALSE;
+			}
+
+			n_hints++;
+		}
+	}
+
+	return n_hints == (old != NULL ? g_hash_table_size(old) : 0);
+}
+
+static gboolean actions_equal(const NotificationContent* old, const NotificationContent* content)
+{
+	guint i;
+
+	if (old->n_actions != content->n_actions)
+	{
+		return FALSE;
+	}
+
+	for (i = 0; i < content->n_actions; i++)
+	{
+		if (g_strcmp0(old->actions[i].label, content->actions[i].label) != 0
+			|| g_strcmp0(old->actions[i].key, content->actions[i].key) != 0)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Returns the NotificationContentFields of content that differ from old */
+guint notification_content_diff(const NotificationContent* old, const NotificationContent* content)
+{
+	guint changed = 0;
+
+	if (old == NULL)
+	{
+		return NOTIFICATION_CONTENT_ALL;
+	}
+
+	if (g_strcmp0(old->summary, content->summary) != 0 || g_strcmp0(old->body, content->body) != 0)
+	{
+		changed |= NOTIFICATION_CONTENT_TEXT;
+	}
+
+	if (old->urgency != content->urgency || old->action_icons != content->action_icons || !hints_equal(old->hints, content->hints))
+	{
+		changed |= NOTIFICATION_CONTENT_HINTS;
+	}
+
+	/* action-icons changes how the buttons look */
+	if (old->action_cb != content->action_cb || old->action_icons != content->action_icons || !actions_equal(old, content))
+	{
+		changed |= NOTIFICATION_CONTENT_ACTIONS;
+	}
+
+	if (!icons_equal(old->icon, content->icon))
+	{
+		changed |= NOTIFICATION_CONTENT_ICON;
+	}
+
+	if (old->arrow_visible != content->arrow_visible || old->arrow_x != content->arrow_x || old->arrow_y != content->arrow_y)
+	{
+		changed |= NOTIFICATION_CONTENT_ARROW;
+	}
+
+	if (old->timeout != content->timeout)
+	{
+		changed |= NOTIFICATION_CONTENT_TIMEOUT;
+	}
+
+	return changed;
+}
@@ -0,0 +1,37 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_CONTENT_H_
+#define _NOTIFY_CONTENT_H_
+
+#include <glib.h>
+
+#include "notify-engine.h"
+
+/*
+ * The content last applied to a notification window, kept so a replacing
+ * Notify only has to forward what actually changed. The copy keeps the
+ * raw hints, except for images, which are kept as the icon.
+ */
+NotificationContent* notification_content_copy(const NotificationContent* content);
+void notification_content_free(NotificationContent* content);
+guint notification_content_diff(const NotificationContent* old, const NotificationContent* content);
+
+#endif /* _NOTIFY_CONTENT_H_ */
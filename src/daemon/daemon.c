@@ -27,6 +27,10 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
 
 #include <dbus/dbus.h>
 #include <dbus/dbus-glib.h>
@@ -41,19 +45,33 @@
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
 #include <gdk/gdkx.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
 
 #define WNCK_I_KNOW_THIS_IS_UNSTABLE
 #include <libwnck/libwnck.h>
 
 #include "daemon.h"
+#include "anchor.h"
+#include "content.h"
 #include "engines.h"
+#include "iconindex.h"
+#include "profile.h"
 #include "stack.h"
 #include "sound.h"
+#include "pixmem.h"
+#include "stats.h"
+#include "sanitize.h"
 #include "notificationdaemon-dbus-glue.h"
 
 #define MAX_NOTIFICATIONS 20
 #define IMAGE_SIZE 48
 #define IDLE_SECONDS 30
+#define REPOSITION_INTERVAL 16 /* ms, about one frame */
+#define ACTIVE_POLL_INTERVAL 5 /* ms, until the active monitor lookup is answered */
+#define MAX_BODY_BYTES 16384 /* more than any notification can show */
+#define EXPAND_URI "notification-daemon:expand" /* link to show a cut body in full */
 #define NOTIFICATION_BUS_NAME      "org.freedesktop.Notifications"
 #define NOTIFICATION_BUS_PATH      "/org/freedesktop/Notifications"
 
@@ -85,25 +103,78 @@ typedef struct {
 	GTimeVal paused_diff;
 	guint id;
 	GtkWindow* nw;
-	Window src_window_xid;
+	NotifyAnchor* anchor;
+
+	/* what the window shows, and its size when last placed in a stack */
+	NotificationContent* content;
+	gint width;
+	gint height;
+
+	/* the whole body while only its beginning is shown, else NULL */
+	char* full_body;
+
 	guint   has_timeout : 1;
+	guint   expanded : 1;
 	guint   paused : 1;
+	guint   stacked : 1;   /* last placed in a stack, not by hints */
 } NotifyTimeout;
 
+typedef enum {
+	ACTIVE_LOOKUP_IDLE,
+	ACTIVE_LOOKUP_WINDOW,    /* waiting for _NET_ACTIVE_WINDOW */
+	ACTIVE_LOOKUP_GEOMETRY,  /* waiting for the position and size of it */
+	ACTIVE_LOOKUP_POINTER    /* nothing has the focus, waiting for the pointer */
+} ActiveLookupStep;
+
 typedef struct {
 	NotifyStack** stacks;
 	int n_stacks;
 	Atom workarea_atom;
+	Atom active_window_atom;
+	xcb_connection_t* conn;
+	xcb_window_t root;
+
+	/* stack of the focused window's monitor, NULL until known */
+	NotifyStack* active_stack;
+	guint n_active_stack_updates;
+
+	/* requests of the active monitor lookup in flight */
+	ActiveLookupStep active_step;
+	unsigned int active_requests[2];
+	guint active_poll_id;
 } NotifyScreen;
 
 struct _NotifyDaemonPrivate {
 	guint next_id;
 	guint timeout_source;
 	guint exit_timeout_source;
-	GHashTable* idle_reposition_notify_ids;
+	GHashTable* reposition_ids;
+	guint reposition_source;
+	guint n_reposition_passes;
+	guint n_unchanged_updates;
+	guint n_truncated_bodies;
+	guint n_cut_bodies;
+	guint n_expanded_bodies;
+	guint n_relayouts_skipped;
+	guint n_repositions;
+
+	/* X events seen by _notify_x11_filter, looked up, and matched */
+	guint64 n_anchor_events;
+	guint64 n_anchor_lookups;
+	guint64 n_anchor_dispatches;
 	GHashTable* monitored_window_hash;
 	GHashTable* notification_hash;
 	gboolean url_clicked_lock;
+	gboolean trimmed;
+
+	/* what a notification shows of its text before it is expanded */
+	guint body_max_lines;
+	gsize body_max_bytes;
+
+	gsize idle_rss;
+	guint n_idle_trims;
+	gint64 first_notification_usec;
+	gint64 wake_notification_usec;
 
 	NotifyStackLocation stack_location;
 	NotifyScreen* screen;
@@ -115,6 +186,7 @@ typedef struct {
 } _NotifyPendingClose;
 
 static DBusConnection* dbus_conn;
+static gint64 process_start_time;
 
 static void notify_daemon_finalize(GObject* object);
 static void _notification_destroyed_cb(GtkWindow* nw, NotifyDaemon* daemon);
@@ -123,8 +195,10 @@ static GdkFilterReturn _notify_x11_filter(GdkXEvent* xevent, GdkEvent* event, No
 static void _emit_closed_signal(GtkWindow* nw, NotifydClosedReason reason);
 static void _action_invoked_cb(GtkWindow* nw, const char* key);
 static NotifyStackLocation get_stack_location_from_string(const gchar *slocation);
-static void sync_notification_position(NotifyDaemon* daemon, GtkWindow* nw, Window source);
+static void sync_notification_position(NotifyDaemon* daemon, GtkWindow* nw, NotifyAnchor* anchor);
+static void migrate_notifications(NotifyDaemon* daemon);
 static void monitor_notification_source_windows(NotifyDaemon* daemon, NotifyTimeout* nt, Window source);
+static void unwatch_anchor_windows(NotifyDaemon* daemon, NotifyTimeout* nt);
 
 G_DEFINE_TYPE(NotifyDaemon, notify_daemon, G_TYPE_OBJECT);
 
@@ -146,11 +220,70 @@ static void _notify_timeout_destroy(NotifyTimeout* nt)
 	 */
 	g_signal_handlers_disconnect_by_func(nt->nw, _notification_destroyed_cb, nt->daemon);
 	gtk_widget_destroy(GTK_WIDGET(nt->nw));
+	pixmem_untrack_notification(nt->id);
+
+	if (nt->anchor != NULL)
+	{
+		unwatch_anchor_windows(nt->daemon, nt);
+		notify_anchor_free(nt->anchor);
+	}
+
+	if (nt->content != NULL)
+	{
+		notification_content_free(nt->content);
+	}
+
+	g_free(nt->full_body);
 	g_free(nt);
 }
 
-static gboolean do_exit(gpointer user_data)
+static gsize get_resident_size(void)
+{
+	FILE* f;
+	unsigned long size;
+	unsigned long resident = 0;
+
+	f = fopen("/proc/self/statm", "r");
+
+	if (f != NULL)
+	{
+		if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+		{
+			resident = 0;
+		}
+
+		fclose(f);
+	}
+
+	return (gsize) resident * sysconf(_SC_PAGESIZE);
+}
+
+/* Give back what can be rebuilt while there is nothing to show */
+static void trim_memory(NotifyDaemon* daemon)
+{
+	pixmem_release_caches();
+
+#ifdef HAVE_MALLOC_TRIM
+	malloc_trim(0);
+#endif
+
+	daemon->priv->trimmed = TRUE;
+	daemon->priv->n_idle_trims++;
+	daemon->priv->idle_rss = get_resident_size();
+}
+
+static gboolean do_exit(NotifyDaemon* daemon)
 {
+	daemon->priv->exit_timeout_source = 0;
+
+	if (g_settings_get_boolean(daemon->gsettings, GSETTINGS_KEY_PERSISTENT))
+	{
+		trim_memory(daemon);
+		return FALSE;
+	}
+
+	g_debug("Exiting after %d idle seconds, resident size %" G_GSIZE_FORMAT " bytes", IDLE_SECONDS, get_resident_size());
+
 	exit(0);
 	return FALSE;
 }
@@ -162,7 +295,7 @@ static void add_exit_timeout(NotifyDaemon* daemon)
 	if (daemon->priv->exit_timeout_source > 0)
 		return;
 
-	daemon->priv->exit_timeout_source = g_timeout_add_seconds(IDLE_SECONDS, do_exit, NULL);
+	daemon->priv->exit_timeout_source = g_timeout_add_seconds(IDLE_SECONDS, (GSourceFunc) do_exit, daemon);
 }
 
 static void remove_exit_timeout(NotifyDaemon* daemon)
@@ -208,6 +341,8 @@ static void create_stack_for_monitor(NotifyDaemon* daemon, GdkScreen* screen, in
 #endif
 }
 
+static void start_active_lookup(NotifyScreen* nscreen);
+
 static void on_screen_monitors_changed(GdkScreen* screen, NotifyDaemon* daemon)
 {
 #if GTK_CHECK_VERSION (3, 22, 0)
@@ -226,6 +361,10 @@ static void on_screen_monitors_changed(GdkScreen* screen, NotifyDaemon* daemon)
 	n_monitors = gdk_screen_get_n_monitors(screen);
 #endif
 
+	/* The stack may go away, and the active window may now be elsewhere */
+	nscreen->active_stack = NULL;
+	start_active_lookup(nscreen);
+
 	if (n_monitors > nscreen->n_stacks)
 	{
 		/* grow */
@@ -304,6 +443,222 @@ static void create_stacks_for_screen(NotifyDaemon* daemon, GdkScreen *screen)
 	}
 }
 
+static NotifyStack* get_stack_for_monitor(NotifyScreen* nscreen, int monitor_num)
+{
+	if (monitor_num >= nscreen->n_stacks)
+	{
+		/* screw it - dump it on the last one we'll get
+		 a monitors-changed signal soon enough*/
+		monitor_num = nscreen->n_stacks - 1;
+	}
+
+	return nscreen->stacks[MAX(monitor_num, 0)];
+}
+
+static int get_monitor_at_point(GdkScreen* screen, int x, int y)
+{
+#if GTK_CHECK_VERSION (3, 22, 0)
+	return _gtk_get_monitor_num (gdk_display_get_monitor_at_point (gdk_screen_get_display (screen), x, y));
+#else
+	return gdk_screen_get_monitor_at_point (screen, x, y);
+#endif
+}
+
+static void set_active_monitor(NotifyScreen* nscreen, int monitor_num)
+{
+	nscreen->active_stack = get_stack_for_monitor (nscreen, monitor_num);
+	nscreen->active_step = ACTIVE_LOOKUP_IDLE;
+	nscreen->n_active_stack_updates++;
+}
+
+/* Takes the reply to request if it has arrived, or waits for it */
+static gboolean take_reply(NotifyScreen* nscreen, unsigned int request, gboolean wait, void** reply)
+{
+	xcb_generic_error_t* error = NULL;
+
+	if (wait)
+	{
+		*reply = xcb_wait_for_reply (nscreen->conn, request, &error);
+	}
+	else if (!xcb_poll_for_reply (nscreen->conn, request, reply, &error))
+	{
+		return FALSE;
+	}
+
+	/* A window that went away meanwhile just gives no reply */
+	free (error);
+
+	return TRUE;
+}
+
+static void query_active_pointer(NotifyScreen* nscreen)
+{
+	nscreen->active_requests[0] = xcb_query_pointer (nscreen->conn, nscreen->root).sequence;
+	nscreen->active_step = ACTIVE_LOOKUP_POINTER;
+	xcb_flush (nscreen->conn);
+}
+
+/*
+ * Moves the lookup of the active monitor on as far as the replies already
+ * received allow, or to its end when wait is set. Returns TRUE once the
+ * monitor is known.
+ */
+static gboolean continue_active_lookup(NotifyScreen* nscreen, gboolean wait)
+{
+	GdkScreen* screen;
+	xcb_get_property_reply_t* property;
+	xcb_translate_coordinates_reply_t* position;
+	xcb_get_geometry_reply_t* geometry;
+	xcb_query_pointer_reply_t* pointer;
+	xcb_window_t active;
+
+	screen = gdk_display_get_default_screen (gdk_display_get_default ());
+
+	while (nscreen->active_step != ACTIVE_LOOKUP_IDLE)
+	{
+		switch (nscreen->active_step)
+		{
+			case ACTIVE_LOOKUP_WINDOW:
+				if (!take_reply (nscreen, nscreen->active_requests[0], wait, (void**) &property))
+				{
+					return FALSE;
+				}
+
+				active = XCB_WINDOW_NONE;
+
+				if (property != NULL)
+				{
+					if (property->type == XCB_ATOM_WINDOW && property->format == 32 && xcb_get_property_value_length (property) == sizeof (xcb_window_t))
+					{
+						active = *(xcb_window_t*) xcb_get_property_value (property);
+					}
+
+					free (property);
+				}
+
+				if (active == XCB_WINDOW_NONE)
+				{
+					query_active_pointer (nscreen);
+					break;
+				}
+
+				/* Sent together, so the geometry reply always comes last */
+				nscreen->active_requests[0] = xcb_translate_coordinates (nscreen->conn, active, nscreen->root, 0, 0).sequence;
+				nscreen->active_requests[1] = xcb_get_geometry (nscreen->conn, active).sequence;
+				nscreen->active_step = ACTIVE_LOOKUP_GEOMETRY;
+				xcb_flush (nscreen->conn);
+				break;
+
+			case ACTIVE_LOOKUP_GEOMETRY:
+				if (!take_reply (nscreen, nscreen->active_requests[1], wait, (void**) &geometry))
+				{
+					return FALSE;
+				}
+
+				/* Already received along with the geometry */
+				take_reply (nscreen, nscreen->active_requests[0], TRUE, (void**) &position);
+
+				if (geometry != NULL && position != NULL)
+				{
+					set_active_monitor (nscreen, get_monitor_at_point (screen, position->dst_x + geometry->width / 2, position->dst_y + geometry->height / 2));
+				}
+				else
+				{
+					query_active_pointer (nscreen);
+				}
+
+				free (geometry);
+				free (position);
+				break;
+
+			case ACTIVE_LOOKUP_POINTER:
+				if (!take_reply (nscreen, nscreen->active_requests[0], wait, (void**) &pointer))
+				{
+					return FALSE;
+				}
+
+				set_active_monitor (nscreen, pointer != NULL ? get_monitor_at_point (screen, pointer->root_x, pointer->root_y) : 0);
+
+				free (pointer);
+				break;
+
+			default:
+				g_assert_not_reached ();
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean poll_active_lookup(NotifyScreen* nscreen)
+{
+	if (continue_active_lookup (nscreen, FALSE))
+	{
+		nscreen->active_poll_id = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Drops the replies of a lookup that is still in flight */
+static void cancel_active_lookup(NotifyScreen* nscreen)
+{
+	switch (nscreen->active_step)
+	{
+		case ACTIVE_LOOKUP_GEOMETRY:
+			xcb_discard_reply (nscreen->conn, nscreen->active_requests[1]);
+			/* fall through */
+		case ACTIVE_LOOKUP_WINDOW:
+		case ACTIVE_LOOKUP_POINTER:
+			xcb_discard_reply (nscreen->conn, nscreen->active_requests[0]);
+			break;
+		default:
+			break;
+	}
+
+	nscreen->active_step = ACTIVE_LOOKUP_IDLE;
+}
+
+/*
+ * Follows focus changes so that placing a notification on the active
+ * monitor is a plain read. The requests are pipelined and their replies
+ * collected from a timeout, so neither the X event filter nor Notify
+ * wait on the server. The pointer is only asked for when no window has
+ * the focus.
+ */
+static void start_active_lookup(NotifyScreen* nscreen)
+{
+	cancel_active_lookup (nscreen);
+
+	if (nscreen->active_window_atom == None)
+	{
+		query_active_pointer (nscreen);
+	}
+	else
+	{
+		nscreen->active_requests[0] = xcb_get_property (nscreen->conn, FALSE, nscreen->root, (xcb_atom_t) nscreen->active_window_atom, XCB_ATOM_WINDOW, 0, 1).sequence;
+		nscreen->active_step = ACTIVE_LOOKUP_WINDOW;
+		xcb_flush (nscreen->conn);
+	}
+
+	if (nscreen->active_poll_id == 0)
+	{
+		nscreen->active_poll_id = g_timeout_add (ACTIVE_POLL_INTERVAL, (GSourceFunc) poll_active_lookup, nscreen);
+	}
+}
+
+static NotifyStack* get_active_stack(NotifyScreen* nscreen)
+{
+	/* Only right after startup or a monitor change the first answer is still out */
+	if (nscreen->active_stack == NULL)
+	{
+		continue_active_lookup (nscreen, TRUE);
+	}
+
+	return nscreen->active_stack;
+}
+
 static GdkFilterReturn screen_xevent_filter(GdkXEvent* xevent, GdkEvent* event, NotifyScreen* nscreen)
 {
 	XEvent* xev = (XEvent*) xevent;
@@ -317,6 +672,10 @@ static GdkFilterReturn screen_xevent_filter(GdkXEvent* xevent, GdkEvent* event,
 			notify_stack_queue_update_position(nscreen->stacks[i]);
 		}
 	}
+	else if (xev->type == PropertyNotify && xev->xproperty.atom == nscreen->active_window_atom)
+	{
+		start_active_lookup(nscreen);
+	}
 
 	return GDK_FILTER_CONTINUE;
 }
@@ -337,12 +696,25 @@ static void create_screen(NotifyDaemon* daemon)
 	daemon->priv->screen = g_new0(NotifyScreen, 1);
 
 	daemon->priv->screen->workarea_atom = XInternAtom(GDK_DISPLAY_XDISPLAY (display), "_NET_WORKAREA", True);
+	daemon->priv->screen->active_window_atom = XInternAtom(GDK_DISPLAY_XDISPLAY (display), "_NET_ACTIVE_WINDOW", True);
+	daemon->priv->screen->conn = XGetXCBConnection(GDK_DISPLAY_XDISPLAY (display));
+	daemon->priv->screen->root = GDK_WINDOW_XID (gdk_screen_get_root_window (screen));
 
 	gdkwindow = gdk_screen_get_root_window(screen);
 	gdk_window_add_filter(gdkwindow, (GdkFilterFunc) screen_xevent_filter, daemon->priv->screen);
 	gdk_window_set_events(gdkwindow, gdk_window_get_events(gdkwindow) | GDK_PROPERTY_CHANGE_MASK);
 
 	create_stacks_for_screen(daemon, screen);
+	start_active_lookup(daemon->priv->screen);
+}
+
+/* Stacks are only needed once a notification has to be placed */
+static void ensure_screen(NotifyDaemon* daemon)
+{
+	if (daemon->priv->screen == NULL)
+	{
+		create_screen(daemon);
+	}
 }
 
 static void on_popup_location_changed(GSettings *settings, gchar *key, NotifyDaemon* daemon)
@@ -370,6 +742,12 @@ static void on_popup_location_changed(GSettings *settings, gchar *key, NotifyDae
     NotifyScreen *nscreen;
 
 	nscreen = daemon->priv->screen;
+
+	if (nscreen == NULL)
+	{
+		return;
+	}
+
 	for (i = 0; i < nscreen->n_stacks; i++)
 	{
 		NotifyStack* stack;
@@ -378,6 +756,71 @@ static void on_popup_location_changed(GSettings *settings, gchar *key, NotifyDae
 	}
 }
 
+static void on_image_memory_budget_changed(GSettings *settings, gchar *key, NotifyDaemon* daemon)
+{
+	gint kbytes = g_settings_get_int(daemon->gsettings, GSETTINGS_KEY_IMAGE_BUDGET);
+
+	pixmem_set_budget((gsize) MAX(kbytes, 0) * 1024);
+}
+
+/* The theme engine's caches, counted and trimmed by pixmem */
+static gsize get_theme_cache_size(gpointer user_data)
+{
+	return theme_get_cache_size();
+}
+
+static gsize trim_theme_caches(gsize excess, gpointer user_data)
+{
+	return theme_release_caches(excess);
+}
+
+/* Called by pixmem when over budget: halve or remove a notification icon */
+static void reclaim_notification_icon(guint id, gboolean drop, NotifyDaemon* daemon)
+{
+	NotifyTimeout* nt;
+	GdkPixbuf* icon;
+	GdkPixbuf* smaller = NULL;
+
+	nt = (NotifyTimeout*) g_hash_table_lookup(daemon->priv->notification_hash, &id);
+
+	if (nt == NULL || nt->content == NULL || nt->content->icon == NULL)
+	{
+		return;
+	}
+
+	icon = nt->content->icon;
+
+	if (!drop)
+	{
+		smaller = gdk_pixbuf_scale_simple(icon,
+										  MAX(gdk_pixbuf_get_width(icon) / 2, 1),
+										  MAX(gdk_pixbuf_get_height(icon) / 2, 1),
+										  GDK_INTERP_BILINEAR);
+	}
+
+	theme_set_notification_icon(nt->nw, smaller);
+	g_object_unref(icon);
+	nt->content->icon = smaller;
+
+	pixmem_set_notification_icon(id, pixmem_pixbuf_size(smaller));
+}
+
+static void on_body_budget_changed(GSettings *settings, gchar *key, NotifyDaemon* daemon)
+{
+	daemon->priv->body_max_lines = (guint) g_settings_get_int(daemon->gsettings, GSETTINGS_KEY_BODY_MAX_LINES);
+	daemon->priv->body_max_bytes = (gsize) g_settings_get_int(daemon->gsettings, GSETTINGS_KEY_BODY_MAX_BYTES);
+}
+
+static void on_persistent_changed(GSettings *settings, gchar *key, NotifyDaemon* daemon)
+{
+	/* Rearm the idle timeout so that turning the mode off exits again */
+	if (g_hash_table_size(daemon->priv->notification_hash) == 0)
+	{
+		remove_exit_timeout(daemon);
+		add_exit_timeout(daemon);
+	}
+}
+
 static void notify_daemon_init(NotifyDaemon* daemon)
 {
 	gchar *location;
@@ -392,6 +835,16 @@ static void notify_daemon_init(NotifyDaemon* daemon)
 	daemon->gsettings = g_settings_new (GSETTINGS_SCHEMA);
 
 	g_signal_connect (daemon->gsettings, "changed::" GSETTINGS_KEY_POPUP_LOCATION, G_CALLBACK (on_popup_location_changed), daemon);
+	g_signal_connect (daemon->gsettings, "changed::" GSETTINGS_KEY_IMAGE_BUDGET, G_CALLBACK (on_image_memory_budget_changed), daemon);
+	g_signal_connect (daemon->gsettings, "changed::" GSETTINGS_KEY_PERSISTENT, G_CALLBACK (on_persistent_changed), daemon);
+	g_signal_connect (daemon->gsettings, "changed::" GSETTINGS_KEY_BODY_MAX_LINES, G_CALLBACK (on_body_budget_changed), daemon);
+	g_signal_connect (daemon->gsettings, "changed::" GSETTINGS_KEY_BODY_MAX_BYTES, G_CALLBACK (on_body_budget_changed), daemon);
+
+	pixmem_set_reclaim_func((PixmemReclaimFunc) reclaim_notification_icon, daemon);
+	pixmem_register_cache("theme", get_theme_cache_size, trim_theme_caches, NULL);
+	theme_set_changed_func((ThemeChangedFunc) migrate_notifications, daemon);
+	on_image_memory_budget_changed(daemon->gsettings, GSETTINGS_KEY_IMAGE_BUDGET, daemon);
+	on_body_budget_changed(daemon->gsettings, GSETTINGS_KEY_BODY_MAX_LINES, daemon);
 
 	location = g_settings_get_string (daemon->gsettings, GSETTINGS_KEY_POPUP_LOCATION);
 	daemon->priv->stack_location = get_stack_location_from_string(location);
@@ -399,10 +852,8 @@ static void notify_daemon_init(NotifyDaemon* daemon)
 
 	daemon->priv->screen = NULL;
 
-	create_screen(daemon);
-
-	daemon->priv->idle_reposition_notify_ids = g_hash_table_new(NULL, NULL);
-	daemon->priv->monitored_window_hash = g_hash_table_new(NULL, NULL);
+	daemon->priv->reposition_ids = g_hash_table_new(NULL, NULL);
+	daemon->priv->monitored_window_hash = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
 	daemon->priv->notification_hash = g_hash_table_new_full(g_int_hash, g_int_equal, g_free, (GDestroyNotify) _notify_timeout_destroy);
 }
 
@@ -413,6 +864,11 @@ static void destroy_screen(NotifyDaemon* daemon)
 	GdkWindow  *gdkwindow;
 	gint        i;
 
+	if (daemon->priv->screen == NULL)
+	{
+		return;
+	}
+
 	display = gdk_display_get_default();
 	screen = gdk_display_get_default_screen (display);
 
@@ -422,6 +878,14 @@ static void destroy_screen(NotifyDaemon* daemon)
 
 	gdkwindow = gdk_screen_get_root_window (screen);
 	gdk_window_remove_filter (gdkwindow, (GdkFilterFunc) screen_xevent_filter, daemon->priv->screen);
+
+	cancel_active_lookup (daemon->priv->screen);
+
+	if (daemon->priv->screen->active_poll_id != 0)
+	{
+		g_source_remove (daemon->priv->screen->active_poll_id);
+	}
+
 	for (i = 0; i < daemon->priv->screen->n_stacks; i++) {
 		 g_clear_object (&daemon->priv->screen->stacks[i]);
 	}
@@ -439,16 +903,23 @@ static void notify_daemon_finalize(GObject* object)
 
 	daemon = NOTIFY_DAEMON(object);
 
+	remove_exit_timeout(daemon);
+
+	/* Closing the notifications unwatches their windows */
+	g_hash_table_destroy(daemon->priv->notification_hash);
+	if (daemon->priv->reposition_source != 0)
+	{
+		g_source_remove(daemon->priv->reposition_source);
+	}
+
+	g_hash_table_destroy(daemon->priv->reposition_ids);
+
 	if (g_hash_table_size(daemon->priv->monitored_window_hash) > 0)
 	{
 		gdk_window_remove_filter(NULL, (GdkFilterFunc) _notify_x11_filter, daemon);
 	}
 
-	remove_exit_timeout(daemon);
-
 	g_hash_table_destroy(daemon->priv->monitored_window_hash);
-	g_hash_table_destroy(daemon->priv->idle_reposition_notify_ids);
-	g_hash_table_destroy(daemon->priv->notification_hash);
 
 	destroy_screen(daemon);
 
@@ -569,70 +1040,94 @@ static void _notification_destroyed_cb(GtkWindow* nw, NotifyDaemon* daemon)
 	_close_notification(daemon, NW_GET_NOTIFY_ID(nw), FALSE, NOTIFYD_CLOSED_EXPIRED);
 }
 
-typedef struct {
-	NotifyDaemon* daemon;
-	gint id;
-} IdleRepositionData;
-
-static gboolean idle_reposition_notification(IdleRepositionData* data)
+/*
+ * Anchored notifications that need to follow their window are collected in
+ * reposition_ids and moved together once per frame, so dragging a window
+ * costs one pass and one flush no matter how many notifications point at it.
+ */
+static gboolean reposition_notifications(NotifyDaemon* daemon)
 {
-	NotifyDaemon* daemon;
-	NotifyTimeout* nt;
-	gint notify_id;
+	GHashTableIter iter;
+	gpointer key;
 
-	daemon = data->daemon;
-	notify_id = data->id;
+	g_hash_table_iter_init(&iter, daemon->priv->reposition_ids);
 
-	/* Look up the timeout, if it's completed we don't need to do anything */
-	nt = (NotifyTimeout*) g_hash_table_lookup(daemon->priv->notification_hash, &notify_id);
-
-	if (nt != NULL)
+	while (g_hash_table_iter_next(&iter, &key, NULL))
 	{
-		sync_notification_position(daemon, nt->nw, nt->src_window_xid);
+		guint notify_id = GPOINTER_TO_UINT(key);
+		NotifyTimeout* nt;
+
+		/* Look up the timeout, if it's completed we don't need to do anything */
+		nt = (NotifyTimeout*) g_hash_table_lookup(daemon->priv->notification_hash, &notify_id);
+
+		if (nt != NULL)
+		{
+			sync_notification_position(daemon, nt->nw, nt->anchor);
+			daemon->priv->n_repositions++;
+		}
 	}
 
-	g_hash_table_remove(daemon->priv->idle_reposition_notify_ids, GINT_TO_POINTER(notify_id));
-	g_object_unref(daemon);
-	g_free(data);
+	g_hash_table_remove_all(daemon->priv->reposition_ids);
+	daemon->priv->n_reposition_passes++;
+	daemon->priv->reposition_source = 0;
+
+	gdk_display_flush(gdk_display_get_default());
 
 	return FALSE;
 }
 
 static void _queue_idle_reposition_notification(NotifyDaemon* daemon, gint notify_id)
 {
-	IdleRepositionData* data;
-	gpointer orig_key;
-	gpointer value;
-	guint idle_id;
+	g_hash_table_add(daemon->priv->reposition_ids, GINT_TO_POINTER(notify_id));
 
-	/* Do we already have an idle update pending? */
-	if (g_hash_table_lookup_extended(daemon->priv->idle_reposition_notify_ids, GINT_TO_POINTER(notify_id), &orig_key, &value))
+	if (daemon->priv->reposition_source == 0)
 	{
-		return;
+		daemon->priv->reposition_source = g_timeout_add_full(G_PRIORITY_LOW, REPOSITION_INTERVAL, (GSourceFunc) reposition_notifications, daemon, NULL);
 	}
-
-	data = g_new0(IdleRepositionData, 1);
-	data->daemon = g_object_ref(daemon);
-	data->id = notify_id;
-
-	/* We do this as a short timeout to avoid repositioning spam */
-	idle_id = g_timeout_add_full(G_PRIORITY_LOW, 50, (GSourceFunc) idle_reposition_notification, data, NULL);
-	g_hash_table_insert(daemon->priv->idle_reposition_notify_ids, GINT_TO_POINTER(notify_id), GUINT_TO_POINTER(idle_id));
 }
 
+/*
+ * Dispatches StructureNotify events of anchor windows through
+ * monitored_window_hash. GDK only knows its own windows, so this is a
+ * display-wide filter, installed while the table has entries; anything
+ * that cannot be an anchor event is rejected before the lookup.
+ */
 static GdkFilterReturn _notify_x11_filter(GdkXEvent* xevent, GdkEvent* event, NotifyDaemon* daemon)
 {
 	XEvent* xev;
-	gpointer orig_key;
-	gpointer value;
-	gint notify_id;
-	NotifyTimeout* nt;
+	GArray* ids;
+	guint i;
 
 	xev = (XEvent*) xevent;
+	daemon->priv->n_anchor_events++;
+
+	/* Only StructureNotify is selected on anchor windows */
+	switch (xev->xany.type)
+	{
+		case ConfigureNotify:
+		case MapNotify:
+		case ReparentNotify:
+		case DestroyNotify:
+			break;
+		default:
+			return GDK_FILTER_CONTINUE;
+	}
+
+	daemon->priv->n_anchor_lookups++;
+	ids = g_hash_table_lookup(daemon->priv->monitored_window_hash, GUINT_TO_POINTER(xev->xany.window));
+
+	if (ids == NULL)
+	{
+		return GDK_FILTER_CONTINUE;
+	}
+
+	daemon->priv->n_anchor_dispatches++;
 
 	if (xev->xany.type == DestroyNotify)
 	{
+		/* Nothing left to unselect, the anchors keep a stale XID until they are refreshed */
 		g_hash_table_remove(daemon->priv->monitored_window_hash, GUINT_TO_POINTER(xev->xany.window));
+		notify_anchor_forget_window(xev->xany.window);
 
 		if (g_hash_table_size(daemon->priv->monitored_window_hash) == 0)
 		{
@@ -642,32 +1137,50 @@ static GdkFilterReturn _notify_x11_filter(GdkXEvent* xevent, GdkEvent* event, No
 		return GDK_FILTER_CONTINUE;
 	}
 
-	if (!g_hash_table_lookup_extended(daemon->priv->monitored_window_hash, GUINT_TO_POINTER(xev->xany.window), &orig_key, &value))
+	if (xev->xany.type == ReparentNotify)
 	{
-		return GDK_FILTER_CONTINUE;
+		/* Re-monitoring changes the index, so walk a copy */
+		ids = g_array_append_vals(g_array_sized_new(FALSE, FALSE, sizeof(guint), ids->len), ids->data, ids->len);
 	}
 
-	notify_id = GPOINTER_TO_INT(value);
-
-	if (xev->xany.type == ConfigureNotify || xev->xany.type == MapNotify)
-	{
-		_queue_idle_reposition_notification(daemon, notify_id);
-	}
-	else if (xev->xany.type == ReparentNotify)
+	for (i = 0; i < ids->len; i++)
 	{
+		guint notify_id = g_array_index(ids, guint, i);
+		NotifyTimeout* nt;
+
 		nt = (NotifyTimeout *) g_hash_table_lookup(daemon->priv->notification_hash, &notify_id);
 
-		if (nt == NULL)
+		if (nt == NULL || nt->anchor == NULL)
 		{
-			return GDK_FILTER_CONTINUE;
+			continue;
 		}
 
-		/*
-		 * If the window got reparented, we need to start monitoring the
-		 * new parents.
-		 */
-		monitor_notification_source_windows(daemon, nt, nt->src_window_xid);
-		sync_notification_position(daemon, nt->nw, nt->src_window_xid);
+		if (xev->xany.type == ConfigureNotify)
+		{
+			/* The cached geometry is updated in place, no round trip */
+			if (notify_anchor_configure(nt->anchor, &xev->xconfigure))
+			{
+				_queue_idle_reposition_notification(daemon, notify_id);
+			}
+		}
+		else if (xev->xany.type == MapNotify)
+		{
+			_queue_idle_reposition_notification(daemon, notify_id);
+		}
+		else if (xev->xany.type == ReparentNotify)
+		{
+			/*
+			 * If the window got reparented, we need to start monitoring the
+			 * new parents.
+			 */
+			monitor_notification_source_windows(daemon, nt, notify_anchor_get_source(nt->anchor));
+			sync_notification_position(daemon, nt->nw, nt->anchor);
+		}
+	}
+
+	if (xev->xany.type == ReparentNotify)
+	{
+		g_array_free(ids, TRUE);
 	}
 
 	return GDK_FILTER_CONTINUE;
@@ -790,8 +1303,6 @@ static void _calculate_timeout(NotifyDaemon* daemon, NotifyTimeout* nt, int time
 			timeout = NOTIFY_DAEMON_DEFAULT_TIMEOUT;
 		}
 
-		theme_set_notification_timeout(nt->nw, timeout);
-
 		glong usec = timeout * 1000L;  /* convert from msec to usec */
 
 		/*
@@ -995,6 +1506,23 @@ static GdkPixbuf* _notify_daemon_pixbuf_from_data_hint(GValue* icon_data)
 	return pixbuf;
 }
 
+/* Stack a notification without position hints goes to */
+static NotifyStack* get_notification_stack(NotifyDaemon* daemon)
+{
+	ensure_screen (daemon);
+
+	/* If the "use-active-monitor" gsettings key is set to TRUE, then
+	 * use the monitor of the focused window, or the one the pointer
+	 * is at. Otherwise, get the monitor number the user has set in
+	 * gsettings. */
+	if (g_settings_get_boolean(daemon->gsettings, GSETTINGS_KEY_USE_ACTIVE))
+	{
+		return get_active_stack (daemon->priv->screen);
+	}
+
+	return get_stack_for_monitor (daemon->priv->screen, g_settings_get_int(daemon->gsettings, GSETTINGS_KEY_MONITOR_NUMBER));
+}
+
 static GdkPixbuf* _notify_daemon_pixbuf_from_path(const char* path)
 {
 	GdkPixbuf* pixbuf = NULL;
@@ -1015,23 +1543,45 @@ static GdkPixbuf* _notify_daemon_pixbuf_from_path(const char* path)
 	else
 	{
 		/* Load icon theme icon */
-		GtkIconTheme *theme;
-		GtkIconInfo  *icon_info;
+		GtkIconTheme *theme = NULL;
+		GtkIconInfo  *icon_info = NULL;
+		gchar        *file;
 
-		theme = gtk_icon_theme_get_default ();
-		icon_info = gtk_icon_theme_lookup_icon (theme, path, IMAGE_SIZE, GTK_ICON_LOOKUP_USE_BUILTIN);
+		/* Try the precomputed index first, GTK may have to scan the theme */
+		icon_index_init (gtk_icon_theme_get_default ());
+		file = icon_index_lookup (path);
 
-		if (icon_info != NULL)
+		if (file != NULL)
 		{
-			gint icon_size;
-
-			icon_size = MIN (IMAGE_SIZE, gtk_icon_info_get_base_size (icon_info));
-
-			if (icon_size == 0)
+			if (g_str_has_suffix (file, ".svg"))
 			{
-				icon_size = IMAGE_SIZE;
+				pixbuf = gdk_pixbuf_new_from_file_at_size (file, IMAGE_SIZE, IMAGE_SIZE, NULL);
 			}
-
+			else
+			{
+				pixbuf = gdk_pixbuf_new_from_file (file, NULL);
+			}
+
+			g_free (file);
+		}
+
+		if (pixbuf == NULL)
+		{
+			theme = gtk_icon_theme_get_default ();
+			icon_info = gtk_icon_theme_lookup_icon (theme, path, IMAGE_SIZE, GTK_ICON_LOOKUP_USE_BUILTIN);
+		}
+
+		if (icon_info != NULL)
+		{
+			gint icon_size;
+
+			icon_size = MIN (IMAGE_SIZE, gtk_icon_info_get_base_size (icon_info));
+
+			if (icon_size == 0)
+			{
+				icon_size = IMAGE_SIZE;
+			}
+
 			pixbuf = gtk_icon_theme_load_icon (theme, path, icon_size, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
 
 			g_object_unref (icon_info);
@@ -1090,6 +1640,53 @@ static void window_clicked_cb(GtkWindow* nw, GdkEventButton* button, NotifyDaemo
 	_close_notification (daemon, NW_GET_NOTIFY_ID (nw), TRUE, NOTIFYD_CLOSED_USER);
 }
 
+/* Shows the whole body of a notification that was cut for its length */
+static void expand_notification(NotifyDaemon* daemon, GtkWindow* nw)
+{
+	NotifyTimeout* nt;
+	NotificationContent content;
+	GtkRequisition req;
+	guint id;
+	gint i;
+
+	id = NW_GET_NOTIFY_ID(nw);
+	nt = (NotifyTimeout*) g_hash_table_lookup(daemon->priv->notification_hash, &id);
+
+	if (nt == NULL || nt->content == NULL || nt->full_body == NULL)
+	{
+		return;
+	}
+
+	g_free((gchar*) nt->content->body);
+	nt->content->body = nt->full_body;
+	nt->full_body = NULL;
+	nt->expanded = TRUE;
+	daemon->priv->n_expanded_bodies++;
+
+	content = *nt->content;
+	content.changed = NOTIFICATION_CONTENT_TEXT;
+	theme_set_notification_content(nw, &content);
+
+	/* The window grew, so the ones stacked after it have to move */
+	gtk_widget_get_preferred_size(GTK_WIDGET(nw), NULL, &req);
+	nt->width = req.width;
+	nt->height = req.height;
+
+	if (daemon->priv->screen == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < daemon->priv->screen->n_stacks; i++)
+	{
+		if (g_list_find(notify_stack_get_windows(daemon->priv->screen->stacks[i]), nw) != NULL)
+		{
+			notify_stack_queue_update_position(daemon->priv->screen->stacks[i]);
+			break;
+		}
+	}
+}
+
 static void url_clicked_cb(GtkWindow* nw, const char *url)
 {
 	NotifyDaemon* daemon;
@@ -1102,6 +1699,12 @@ static void url_clicked_cb(GtkWindow* nw, const char *url)
 	/* Somewhat of a hack.. */
 	daemon->priv->url_clicked_lock = TRUE;
 
+	if (strcmp (url, EXPAND_URI) == 0)
+	{
+		expand_notification (daemon, nw);
+		return;
+	}
+
 	escaped_url = g_shell_quote (url);
 
 	if ((found = g_find_program_in_path ("gvfs-open")) != NULL)
@@ -1204,97 +1807,136 @@ static gboolean fullscreen_window_exists(GtkWidget* nw)
 	return FALSE;
 }
 
-static Window get_window_parent(Display* display, Window window, Window* root)
+/*
+ * monitored_window_hash maps every watched XID to the ids of the
+ * notifications anchored below it. A window stays selected for
+ * StructureNotify as long as one of them is still around.
+ */
+static void watch_anchor_windows(NotifyDaemon* daemon, NotifyTimeout* nt)
 {
-	Window parent;
-	Window* children = NULL;
-	guint nchildren;
-	gboolean result;
+	GArray* windows;
+	guint i, j;
 
-	gdk_error_trap_push();
-	result = XQueryTree(display, window, root, &parent, &children, &nchildren);
+	/* Start monitoring events if necessary.  We don't want to
+	   filter events unless we absolutely have to. */
+	if (g_hash_table_size (daemon->priv->monitored_window_hash) == 0)
+	{
+		gdk_window_add_filter (NULL, (GdkFilterFunc) _notify_x11_filter, daemon);
+	}
+
+	windows = notify_anchor_get_windows (nt->anchor);
 
-	if (gdk_error_trap_pop() || !result)
+	for (i = 0; i < windows->len; i++)
 	{
-		return None;
+		gpointer window = GUINT_TO_POINTER (g_array_index (windows, Window, i));
+		GArray* ids;
+
+		ids = g_hash_table_lookup (daemon->priv->monitored_window_hash, window);
+
+		if (ids == NULL)
+		{
+			ids = g_array_sized_new (FALSE, FALSE, sizeof (guint), 1);
+			g_hash_table_insert (daemon->priv->monitored_window_hash, window, ids);
+		}
+
+		for (j = 0; j < ids->len; j++)
+		{
+			if (g_array_index (ids, guint, j) == nt->id)
+			{
+				break;
+			}
+		}
+
+		if (j == ids->len)
+		{
+			g_array_append_val (ids, nt->id);
+		}
 	}
+}
 
-	if (children)
+static void unwatch_anchor_windows(NotifyDaemon* daemon, NotifyTimeout* nt)
+{
+	GArray* windows;
+	guint i, j;
+
+	windows = notify_anchor_get_windows (nt->anchor);
+
+	for (i = 0; i < windows->len; i++)
 	{
-		XFree(children);
+		gpointer window = GUINT_TO_POINTER (g_array_index (windows, Window, i));
+		GArray* ids;
+
+		ids = g_hash_table_lookup (daemon->priv->monitored_window_hash, window);
+
+		if (ids == NULL)
+		{
+			continue;
+		}
+
+		for (j = 0; j < ids->len; j++)
+		{
+			if (g_array_index (ids, guint, j) == nt->id)
+			{
+				g_array_remove_index_fast (ids, j);
+				break;
+			}
+		}
+
+		if (ids->len == 0)
+		{
+			notify_anchor_unselect_window (nt->anchor, g_array_index (windows, Window, i));
+			g_hash_table_remove (daemon->priv->monitored_window_hash, window);
+		}
 	}
 
-	return parent;
+	if (g_hash_table_size (daemon->priv->monitored_window_hash) == 0)
+	{
+		gdk_window_remove_filter (NULL, (GdkFilterFunc) _notify_x11_filter, daemon);
+	}
 }
 
 /*
- * Recurse over X Window and parents, up to root, and start watching them
+ * Walk the X Window and its parents, up to root, and start watching them
  * for position changes.
  */
 static void monitor_notification_source_windows(NotifyDaemon  *daemon, NotifyTimeout *nt, Window source)
 {
-	Display* display;
-	Window root = None;
-	Window parent;
-
-	display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+	/* Store the window in the timeout */
+	g_assert (nt != NULL);
 
-	/* Start monitoring events if necessary.  We don't want to
-	   filter events unless we absolutely have to. */
-	if (g_hash_table_size (daemon->priv->monitored_window_hash) == 0)
+	if (nt->anchor != NULL)
 	{
-		gdk_window_add_filter (NULL, (GdkFilterFunc) _notify_x11_filter, daemon);
+		/* Drop the old chain first, refreshing selects the new one again */
+		unwatch_anchor_windows (daemon, nt);
 	}
 
-	/* Store the window in the timeout */
-	g_assert (nt != NULL);
-	nt->src_window_xid = source;
-
-	for (parent = get_window_parent (display, source, &root); parent != None && root != parent; parent = get_window_parent (display, parent, &root))
+	if (nt->anchor != NULL && notify_anchor_get_source (nt->anchor) == source)
+	{
+		notify_anchor_refresh (nt->anchor);
+	}
+	else
 	{
-		XSelectInput (display, parent, StructureNotifyMask);
+		if (nt->anchor != NULL)
+		{
+			notify_anchor_free (nt->anchor);
+		}
 
-		g_hash_table_insert(daemon->priv->monitored_window_hash, GUINT_TO_POINTER (parent), GINT_TO_POINTER (nt->id));
+		nt->anchor = notify_anchor_new (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()), source);
 	}
+
+	watch_anchor_windows (daemon, nt);
 }
 
-/* Use a source X Window ID to reposition a notification. */
-static void sync_notification_position(NotifyDaemon* daemon, GtkWindow* nw, Window source)
+/* Use the cached source window geometry to reposition a notification. */
+static void sync_notification_position(NotifyDaemon* daemon, GtkWindow* nw, NotifyAnchor* anchor)
 {
-	Display* display;
-	Status result;
-	Window root;
-	Window child;
 	int x, y;
-	unsigned int width, height;
-	unsigned int border_width, depth;
-
-	display = GDK_DISPLAY_XDISPLAY(gdk_display_get_default ());
-
-	gdk_error_trap_push();
-
-	/* Get the root for this window */
-	result = XGetGeometry(display, source, &root, &x, &y, &width, &height, &border_width, &depth);
-
-	if (gdk_error_trap_pop () || !result)
-	{
-		return;
-	}
 
-	/*
-	 * Now calculate the offset coordinates for the source window from
-	 * the root.
-	 */
-	gdk_error_trap_push ();
-	result = XTranslateCoordinates (display, source, root, 0, 0, &x, &y, &child);
-	if (gdk_error_trap_pop () || !result)
+	if (anchor == NULL || !notify_anchor_get_position (anchor, &x, &y))
 	{
 		return;
 	}
 
-	x += width / 2;
-	y += height / 2;
-
 	theme_set_notification_arrow (nw, TRUE, x, y);
 	theme_move_notification (nw, x, y);
 	theme_show_notification (nw);
@@ -1308,6 +1950,138 @@ static void sync_notification_position(NotifyDaemon* daemon, GtkWindow* nw, Wind
 	gtk_widget_queue_draw (GTK_WIDGET (nw));
 }
 
+static gboolean first_paint_cb(GtkWidget* nw, cairo_t* cr, NotifyDaemon* daemon)
+{
+	profile_mark("first-paint");
+	g_signal_handlers_disconnect_by_func(nw, first_paint_cb, daemon);
+
+	return FALSE;
+}
+
+/*
+ * Everything the first notification could do without. Runs once the
+ * triggering Notify call has been served.
+ */
+static gboolean deferred_init(NotifyDaemon* daemon)
+{
+	ensure_screen(daemon);
+	icon_index_init(gtk_icon_theme_get_default());
+	theme_preload_engine();
+	wnck_screen_force_update(wnck_screen_get_default());
+	sound_init();
+
+	profile_mark("deferred-init");
+
+	return FALSE;
+}
+
+static GtkWindow* create_notification_window(NotifyDaemon* daemon)
+{
+	GtkWindow* nw;
+
+	nw = theme_create_notification(url_clicked_cb);
+	g_object_set_data(G_OBJECT(nw), "_notify_daemon", daemon);
+	gtk_widget_realize(GTK_WIDGET(nw));
+
+	g_signal_connect(G_OBJECT(nw), "button-release-event", G_CALLBACK(window_clicked_cb), daemon);
+	g_signal_connect(G_OBJECT(nw), "destroy", G_CALLBACK(_notification_destroyed_cb), daemon);
+	g_signal_connect(G_OBJECT(nw), "enter-notify-event", G_CALLBACK(_mouse_entered_cb), daemon);
+	g_signal_connect(G_OBJECT(nw), "leave-notify-event", G_CALLBACK(_mouse_exitted_cb), daemon);
+
+	return nw;
+}
+
+/*
+ * Rebuild a live notification in the current engine from the content it
+ * shows, in the same place and with the same remaining time.
+ */
+static void migrate_notification(NotifyDaemon* daemon, NotifyTimeout* nt)
+{
+	GtkWindow* old_nw = nt->nw;
+	GtkWindow* nw;
+	NotificationContent content;
+	gboolean placed = FALSE;
+	gint x, y;
+	gint i;
+
+	if (nt->content == NULL)
+	{
+		return;
+	}
+
+	nw = create_notification_window(daemon);
+
+	content = *nt->content;
+	content.changed = NOTIFICATION_CONTENT_ALL;
+	theme_set_notification_content(nw, &content);
+
+	g_object_set_data(G_OBJECT(nw), "_notify_id", GUINT_TO_POINTER(nt->id));
+	g_object_set_data_full(G_OBJECT(nw), "_notify_sender", g_strdup(NW_GET_NOTIFY_SENDER(old_nw)), (GDestroyNotify) g_free);
+	nt->nw = nw;
+
+	if (nt->has_timeout)
+	{
+		GTimeVal now;
+
+		g_get_current_time(&now);
+		theme_notification_tick(nw, (nt->expiration.tv_sec - now.tv_sec) * 1000 + (nt->expiration.tv_usec - now.tv_usec) / 1000);
+	}
+
+	if (nt->anchor != NULL)
+	{
+		sync_notification_position(daemon, nw, nt->anchor);
+		placed = TRUE;
+	}
+
+	for (i = 0; !placed && daemon->priv->screen != NULL && i < daemon->priv->screen->n_stacks; i++)
+	{
+		placed = notify_stack_replace_window(daemon->priv->screen->stacks[i], old_nw, nw);
+	}
+
+	if (!placed)
+	{
+		gtk_window_get_position(old_nw, &x, &y);
+		theme_move_notification(nw, x, y);
+	}
+
+	if (gtk_widget_get_visible(GTK_WIDGET(old_nw)))
+	{
+		theme_show_notification(nw);
+	}
+
+	g_signal_handlers_disconnect_by_func(old_nw, _notification_destroyed_cb, daemon);
+	gtk_widget_destroy(GTK_WIDGET(old_nw));
+}
+
+/* The theme engine changed, move every notification over to it at once */
+static void migrate_notifications(NotifyDaemon* daemon)
+{
+	GHashTableIter iter;
+	NotifyTimeout* nt;
+
+	g_hash_table_iter_init(&iter, daemon->priv->notification_hash);
+
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer*) &nt))
+	{
+		migrate_notification(daemon, nt);
+	}
+}
+
+/* Whether a replaced notification changed size and has to be restacked */
+static gboolean notification_resized(NotifyTimeout* nt, guint changed)
+{
+	GtkRequisition req;
+
+	if ((changed & (NOTIFICATION_CONTENT_TEXT | NOTIFICATION_CONTENT_HINTS | NOTIFICATION_CONTENT_ACTIONS | NOTIFICATION_CONTENT_ICON)) == 0)
+	{
+		return FALSE;
+	}
+
+	gtk_widget_get_preferred_size(GTK_WIDGET(nt->nw), NULL, &req);
+
+	return req.width != nt->width || req.height != nt->height;
+}
+
 GQuark notify_daemon_error_quark(void)
 {
 	static GQuark q;
@@ -1336,8 +2110,20 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 	char* sound_file = NULL;
 	gboolean sound_enabled;
 	gint i;
+	gint urgency = URGENCY_NORMAL;
+	gboolean action_icons = FALSE;
+	gboolean always_stack;
+	gboolean placed_in_stack = FALSE;
+	GArray* content_actions;
+	NotificationContent content;
 	GdkPixbuf* pixbuf;
+	GdkPixbuf* scaled_icon = NULL;
 	GSettings* gsettings;
+	char* safe_body;
+	char* full_body = NULL;
+	char* safe_summary = NULL;
+	gboolean truncated;
+	gint64 start_time = g_get_monotonic_time ();
 
 	if (g_hash_table_size (priv->notification_hash) > MAX_NOTIFICATIONS)
 	{
@@ -1366,24 +2152,15 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 
 	if (nw == NULL)
 	{
-		nw = theme_create_notification (url_clicked_cb);
-		g_object_set_data (G_OBJECT (nw), "_notify_daemon", daemon);
-		gtk_widget_realize (GTK_WIDGET (nw));
+		nw = create_notification_window (daemon);
 		new_notification = TRUE;
 
-		g_signal_connect (G_OBJECT (nw), "button-release-event", G_CALLBACK (window_clicked_cb), daemon);
-		g_signal_connect (G_OBJECT (nw), "destroy", G_CALLBACK (_notification_destroyed_cb), daemon);
-		g_signal_connect (G_OBJECT (nw), "enter-notify-event", G_CALLBACK (_mouse_entered_cb), daemon);
-		g_signal_connect (G_OBJECT (nw), "leave-notify-event", G_CALLBACK (_mouse_exitted_cb), daemon);
-	}
-	else
-	{
-		theme_clear_notification_actions (nw);
+		if (profile_get_elapsed ("first-paint") < 0)
+		{
+			g_signal_connect_after (G_OBJECT (nw), "draw", G_CALLBACK (first_paint_cb), daemon);
+		}
 	}
 
-	theme_set_notification_text (nw, summary, body);
-	theme_set_notification_hints (nw, hints);
-
 	/*
 	 *XXX This needs to handle file URIs and all that.
 	 */
@@ -1405,6 +2182,16 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 		}
 	}
 
+	if ((data = (GValue *) g_hash_table_lookup (hints, "urgency")) != NULL && G_VALUE_HOLDS_UCHAR (data))
+	{
+		urgency = g_value_get_uchar (data);
+	}
+
+	if ((data = (GValue *) g_hash_table_lookup (hints, "action-icons")) != NULL && G_VALUE_HOLDS_BOOLEAN (data))
+	{
+		action_icons = g_value_get_boolean (data);
+	}
+
 	/* Deal with sound hints */
 	gsettings = g_settings_new (GSETTINGS_SCHEMA);
 	sound_enabled = g_settings_get_boolean (gsettings, GSETTINGS_KEY_SOUND_ENABLED);
@@ -1445,8 +2232,11 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 	}
 
 	/* set up action buttons */
+	content_actions = g_array_new (FALSE, FALSE, sizeof (NotificationAction));
+
 	for (i = 0; actions[i] != NULL; i += 2)
 	{
+		NotificationAction action;
 		char* l = actions[i + 1];
 
 		if (l == NULL)
@@ -1458,7 +2248,9 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 
 		if (strcasecmp (actions[i], "default"))
 		{
-			theme_add_notification_action (nw, l, actions[i], G_CALLBACK (_action_invoked_cb));
+			action.label = l;
+			action.key = actions[i];
+			g_array_append_val (content_actions, action);
 		}
 	}
 
@@ -1508,123 +2300,195 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 
 	if (pixbuf != NULL)
 	{
-		GdkPixbuf *scaled;
-		scaled = NULL;
-		scaled = _notify_daemon_scale_pixbuf (pixbuf, TRUE);
-		theme_set_notification_icon (nw, scaled);
+		scaled_icon = _notify_daemon_scale_pixbuf (pixbuf, TRUE);
 		g_object_unref (G_OBJECT (pixbuf));
-		if (scaled != NULL)
-			g_object_unref (scaled);
 	}
 
-	if (window_xid != None && !theme_get_always_stack (nw))
+	always_stack = theme_get_always_stack (nw);
+
+	/* Engines only ever see whitelisted, well-formed markup of bounded size */
+	safe_body = notify_sanitize_markup (body, MAX_BODY_BYTES, 0, &truncated);
+
+	if (truncated)
+	{
+		priv->n_truncated_bodies++;
+	}
+
+	/*
+	 * Laying out a long body costs every time the stack moves, so only
+	 * its beginning is shown until the user asks for the rest.
+	 */
+	if (nt == NULL || !nt->expanded)
+	{
+		char* preview;
+
+		preview = notify_sanitize_markup (body, priv->body_max_bytes, priv->body_max_lines, &truncated);
+
+		if (truncated)
+		{
+			/* Translations may contain characters markup reads as syntax */
+			char* label = g_markup_escape_text (_("Show more"), -1);
+
+			full_body = safe_body;
+			safe_body = g_strdup_printf ("%s <a href=\"" EXPAND_URI "\">%s</a>", preview, label);
+			g_free (label);
+			g_free (preview);
+			priv->n_cut_bodies++;
+		}
+		else
+		{
+			g_free (preview);
+		}
+	}
+
+	/* The summary is plain text and has no way to be expanded */
+	if (priv->body_max_bytes > 0 && strlen (summary) > priv->body_max_bytes)
+	{
+		const char* end = g_utf8_find_prev_char (summary, summary + priv->body_max_bytes + 1);
+
+		safe_summary = g_strdup_printf ("%.*s\342\200\246", (int) (end - summary), summary);
+		summary = safe_summary;
+	}
+
+	/* Hand everything to the engine at once so it lays out only once */
+	content.summary = summary;
+	content.body = safe_body;
+	content.hints = hints;
+	content.urgency = urgency;
+	content.action_icons = action_icons;
+	content.actions = (NotificationAction*) content_actions->data;
+	content.n_actions = content_actions->len;
+	content.action_cb = G_CALLBACK (_action_invoked_cb);
+	content.icon = scaled_icon;
+	content.arrow_visible = use_pos_data && !always_stack;
+	content.arrow_x = x;
+	content.arrow_y = y;
+	content.timeout = timeout == -1 ? NOTIFY_DAEMON_DEFAULT_TIMEOUT : timeout;
+	content.changed = notification_content_diff (nt != NULL ? nt->content : NULL, &content);
+
+	/* Replacing a notification with itself, e.g. an unchanged progress value */
+	if (content.changed != 0)
+	{
+		theme_set_notification_content (nw, &content);
+	}
+	else
+	{
+		priv->n_unchanged_updates++;
+	}
+
+	if (window_xid != None && !always_stack)
 	{
 		/*
 		 * Do nothing here if we were passed an XID; we'll call
 		 * sync_notification_position later.
 		 */
+		if (nt != NULL)
+		{
+			nt->stacked = FALSE;
+		}
 	}
-	else if (use_pos_data && !theme_get_always_stack (nw))
+	else if (use_pos_data && !always_stack)
 	{
 		/*
 		 * Typically, the theme engine will set its own position based on
 		 * the arrow X, Y hints. However, in case, move the notification to
 		 * that position.
 		 */
-		theme_set_notification_arrow (nw, TRUE, x, y);
 		theme_move_notification (nw, x, y);
+
+		if (nt != NULL)
+		{
+			nt->stacked = FALSE;
+		}
+	}
+	else if (nt != NULL && nt->stacked && !notification_resized (nt, content.changed))
+	{
+		/* Same size, the stack doesn't need to move anything */
+		priv->n_relayouts_skipped++;
 	}
 	else
 	{
-#if GTK_CHECK_VERSION (3, 22, 0)
-		GdkMonitor *monitor_id;
-#else
-		int monitor_num;
-#endif
-		GdkDisplay *display;
-#if GTK_CHECK_VERSION (3, 20, 0)
-		GdkSeat *seat;
-#else
-		GdkDeviceManager *device_manager;
-#endif
-		GdkDevice *pointer;
-		GdkScreen* screen;
-		gint x, y;
+		NotifyStack* stack;
 
-		theme_set_notification_arrow (nw, FALSE, 0, 0);
+		stack = get_notification_stack (daemon);
 
-		/* If the "use-active-monitor" gsettings key is set to TRUE, then
-		 * get the monitor the pointer is at. Otherwise, get the monitor
-		 * number the user has set in gsettings. */
-		if (g_settings_get_boolean(daemon->gsettings, GSETTINGS_KEY_USE_ACTIVE))
-		{
-			display = gdk_display_get_default ();
-#if GTK_CHECK_VERSION (3, 20, 0)
-			seat = gdk_display_get_default_seat (display);
-			pointer = gdk_seat_get_pointer (seat);
-#else
-			device_manager = gdk_display_get_device_manager (display);
-			pointer = gdk_device_manager_get_client_pointer (device_manager);
-#endif
+		notify_stack_add_window (stack, nw, new_notification);
+		placed_in_stack = TRUE;
+	}
 
-			gdk_device_get_position (pointer, &screen, &x, &y);
-#if GTK_CHECK_VERSION (3, 22, 0)
-			monitor_id = gdk_display_get_monitor_at_point (gdk_screen_get_display (screen), x, y);
-#else
-			monitor_num = gdk_screen_get_monitor_at_point (screen, x, y);
-#endif
-		}
-		else
-		{
-			screen = gdk_display_get_default_screen(gdk_display_get_default());
-#if GTK_CHECK_VERSION (3, 22, 0)
-			monitor_id = gdk_display_get_monitor (gdk_display_get_default(),
-							      g_settings_get_int(daemon->gsettings, GSETTINGS_KEY_MONITOR_NUMBER));
-#else
-			monitor_num = g_settings_get_int(daemon->gsettings, GSETTINGS_KEY_MONITOR_NUMBER);
-#endif
-		}
+	if (id == 0)
+	{
+		nt = _store_notification (daemon, nw, timeout);
+		return_id = nt->id;
+	}
+	else
+	{
+		return_id = id;
+	}
 
-#if GTK_CHECK_VERSION (3, 22, 0)
-		if (_gtk_get_monitor_num (monitor_id) >= priv->screen->n_stacks)
-		{
-			/* screw it - dump it on the last one we'll get
-			 a monitors-changed signal soon enough*/
-			monitor_id = gdk_display_get_monitor (gdk_display_get_default(), priv->screen->n_stacks - 1);
-		}
+	sender = dbus_g_method_get_sender (context);
 
-		notify_stack_add_window (priv->screen->stacks[_gtk_get_monitor_num (monitor_id)], nw, new_notification);
-#else
-		if (monitor_num >= priv->screen->n_stacks)
+	pixmem_track_notification (return_id, sender, urgency);
+
+	if (content.changed != 0)
+	{
+		if (nt->content != NULL)
 		{
-			/* screw it - dump it on the last one we'll get
-			 a monitors-changed signal soon enough*/
-			monitor_num = priv->screen->n_stacks - 1;
+			notification_content_free (nt->content);
 		}
 
-		notify_stack_add_window (priv->screen->stacks[monitor_num], nw, new_notification);
-#endif
+		/* Kept in the notification record so the icon can be shrunk later */
+		nt->content = notification_content_copy (&content);
+		pixmem_set_notification_icon (return_id, pixmem_pixbuf_size (content.icon));
 	}
 
-	if (id == 0)
+	g_free (nt->full_body);
+	nt->full_body = full_body;
+
+	if (placed_in_stack)
 	{
-		nt = _store_notification (daemon, nw, timeout);
-		return_id = nt->id;
+		GtkRequisition req;
+
+		gtk_widget_get_preferred_size (GTK_WIDGET (nw), NULL, &req);
+		nt->width = req.width;
+		nt->height = req.height;
+		nt->stacked = TRUE;
 	}
-	else
+
+	g_array_free (content_actions, TRUE);
+
+	if (scaled_icon != NULL)
 	{
-		return_id = id;
+		g_object_unref (scaled_icon);
+	}
+
+	/* Settle the budget before the window is shown */
+	pixmem_enforce ();
+
+	g_object_set_data (G_OBJECT (nw), "_notify_id", GUINT_TO_POINTER (return_id));
+	g_object_set_data_full (G_OBJECT (nw), "_notify_sender", sender, (GDestroyNotify) g_free);
+
+	if (nt)
+	{
+		_calculate_timeout (daemon, nt, timeout);
 	}
 
+	/*
+	 * Nothing below can change the returned id, so don't keep the client
+	 * waiting on the screensaver and fullscreen checks.
+	 */
+	dbus_g_method_return (context, return_id);
+	profile_mark ("first-notify");
+
 	/*
 	 * If we have a source Window XID, start monitoring the tree
 	 * for changes, and reposition the window based on the source
 	 * window.  We need to do this after return_id is calculated.
 	 */
-	if (window_xid != None && !theme_get_always_stack (nw))
+	if (window_xid != None && !always_stack)
 	{
 		monitor_notification_source_windows (daemon, nt, window_xid);
-		sync_notification_position (daemon, nw, window_xid);
+		sync_notification_position (daemon, nw, nt->anchor);
 	}
 
 	/* If there is no timeout, show the notification also if screensaver
@@ -1652,18 +2516,20 @@ gboolean notify_daemon_notify_handler(NotifyDaemon* daemon, const char* app_name
 	}
 
 	g_free (sound_file);
+	g_free (safe_body);
+	g_free (safe_summary);
 
-	sender = dbus_g_method_get_sender (context);
-
-	g_object_set_data (G_OBJECT (nw), "_notify_id", GUINT_TO_POINTER (return_id));
-	g_object_set_data_full (G_OBJECT (nw), "_notify_sender", sender, (GDestroyNotify) g_free);
-
-	if (nt)
+	/* Startup cost in the default mode, wake-up cost in persistent mode */
+	if (priv->first_notification_usec == 0)
 	{
-		_calculate_timeout (daemon, nt, timeout);
+		priv->first_notification_usec = g_get_monotonic_time () - process_start_time;
 	}
 
-	dbus_g_method_return (context, return_id);
+	if (priv->trimmed)
+	{
+		priv->wake_notification_usec = g_get_monotonic_time () - start_time;
+		priv->trimmed = FALSE;
+	}
 
 	return TRUE;
 }
@@ -1710,20 +2576,84 @@ gboolean notify_daemon_get_server_information(NotifyDaemon *daemon, char** out_n
 	return TRUE;
 }
 
+gboolean notify_daemon_get_statistics(NotifyDaemon* daemon, GHashTable** out_stats, GError** error)
+{
+	GHashTable* stats = notify_stats_new ();
+
+	notify_stats_set_uint64 (stats, "notifications", g_hash_table_size (daemon->priv->notification_hash));
+	notify_stats_set_uint64 (stats, "persistent", g_settings_get_boolean (daemon->gsettings, GSETTINGS_KEY_PERSISTENT));
+	notify_stats_set_uint64 (stats, "rss-bytes", get_resident_size ());
+	notify_stats_set_uint64 (stats, "idle-rss-bytes", daemon->priv->idle_rss);
+	notify_stats_set_uint64 (stats, "idle-trims", daemon->priv->n_idle_trims);
+	notify_stats_set_uint64 (stats, "first-notification-usec", daemon->priv->first_notification_usec);
+	notify_stats_set_uint64 (stats, "wake-notification-usec", daemon->priv->wake_notification_usec);
+	notify_stats_set_uint64 (stats, "reposition-passes", daemon->priv->n_reposition_passes);
+	notify_stats_set_uint64 (stats, "unchanged-updates", daemon->priv->n_unchanged_updates);
+	notify_stats_set_uint64 (stats, "truncated-bodies", daemon->priv->n_truncated_bodies);
+	notify_stats_set_uint64 (stats, "cut-bodies", daemon->priv->n_cut_bodies);
+	notify_stats_set_uint64 (stats, "expanded-bodies", daemon->priv->n_expanded_bodies);
+	notify_stats_set_uint64 (stats, "relayouts-skipped", daemon->priv->n_relayouts_skipped);
+	notify_stats_set_uint64 (stats, "repositions", daemon->priv->n_repositions);
+	notify_stats_set_uint64 (stats, "anchor-windows", g_hash_table_size (daemon->priv->monitored_window_hash));
+	notify_stats_set_uint64 (stats, "anchor-events", daemon->priv->n_anchor_events);
+	notify_stats_set_uint64 (stats, "anchor-event-lookups", daemon->priv->n_anchor_lookups);
+	notify_stats_set_uint64 (stats, "anchor-event-dispatches", daemon->priv->n_anchor_dispatches);
+	pixmem_add_statistics (stats);
+	profile_add_statistics (stats);
+
+	if (daemon->priv->screen != NULL)
+	{
+		notify_stats_set_uint64 (stats, "active-monitor-updates", daemon->priv->screen->n_active_stack_updates);
+	}
+	icon_index_add_statistics (stats);
+	theme_add_statistics (stats);
+
+	*out_stats = stats;
+
+	return TRUE;
+}
+
 int main(int argc, char** argv)
 {
 	NotifyDaemon* daemon;
 	DBusGConnection* connection;
 	DBusGProxy* bus_proxy;
+	GOptionContext* context;
 	GError* error;
 	gboolean res;
 	guint request_name_result;
+	gboolean profile_startup = FALSE;
+	GOptionEntry entries[] = {
+		{"profile-startup", 0, 0, G_OPTION_ARG_NONE, &profile_startup, N_("Print how long each startup phase takes"), NULL},
+		{NULL}
+	};
 
-	g_log_set_always_fatal(G_LOG_LEVEL_CRITICAL);
+	process_start_time = g_get_monotonic_time();
+	profile_init();
 
-	gtk_init(&argc, &argv);
+	g_log_set_always_fatal(G_LOG_LEVEL_CRITICAL);
 
+	/* GTK options are left in place for gtk_init() */
 	error = NULL;
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, entries, GETTEXT_PACKAGE);
+	g_option_context_set_ignore_unknown_options(context, TRUE);
+	g_option_context_set_help_enabled(context, TRUE);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		exit(1);
+	}
+
+	g_option_context_free(context);
+	profile_set_verbose(profile_startup);
+
+	/*
+	 * Claim the bus name before anything else, calls are queued on the
+	 * connection until the main loop runs.
+	 */
 	connection = dbus_g_bus_get(DBUS_BUS_SESSION, &error);
 
 	if (connection == NULL)
@@ -1756,9 +2686,17 @@ int main(int argc, char** argv)
 		goto out;
 	}
 
+	profile_mark("name-acquired");
+
+	gtk_init(&argc, &argv);
+	profile_mark("gtk-init");
+
 	daemon = g_object_new(NOTIFY_TYPE_DAEMON, NULL);
 
 	dbus_g_connection_register_g_object(connection, "/org/freedesktop/Notifications", G_OBJECT(daemon));
+	profile_mark("daemon-ready");
+
+	g_idle_add((GSourceFunc) deferred_init, daemon);
 
 	gtk_main();
 
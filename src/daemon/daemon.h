@@ -37,6 +37,10 @@
 #define GSETTINGS_KEY_SOUND_ENABLED  "sound-enabled"
 #define GSETTINGS_KEY_MONITOR_NUMBER "monitor-number"
 #define GSETTINGS_KEY_USE_ACTIVE     "use-active-monitor"
+#define GSETTINGS_KEY_IMAGE_BUDGET   "image-memory-budget"
+#define GSETTINGS_KEY_PERSISTENT     "persistent"
+#define GSETTINGS_KEY_BODY_MAX_LINES "body-max-lines"
+#define GSETTINGS_KEY_BODY_MAX_BYTES "body-max-bytes"
 
 #define NOTIFY_TYPE_DAEMON (notify_daemon_get_type())
 #define NOTIFY_DAEMON(obj) \
@@ -97,6 +101,8 @@ gboolean notify_daemon_get_capabilities(NotifyDaemon* daemon, char*** out_caps);
 
 gboolean notify_daemon_get_server_information(NotifyDaemon* daemon, char** out_name, char** out_vendor, char** out_version, char** out_spec_ver);
 
+gboolean notify_daemon_get_statistics(NotifyDaemon* daemon, GHashTable** out_stats, GError** error);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -23,65 +23,104 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "daemon.h"
 #include "engines.h"
+#include "notify-engine.h"
+#include "stats.h"
 
-typedef struct {
+struct _ThemeEngine {
 	GModule*    module;
 	guint       ref_count;
 
-	/* callbacks */
-	gboolean    (*theme_check_init)            (unsigned int major_ver, unsigned int minor_ver, unsigned int micro_ver);
-	void        (*get_theme_info)              (char** theme_name, char** theme_ver, char** author, char** homepage);
-	GtkWindow*  (*create_notification)         (UrlClickedCb url_clicked_cb);
-	void        (*destroy_notification)        (GtkWindow* nw);
-	void        (*show_notification)           (GtkWindow* nw);
-	void        (*hide_notification)           (GtkWindow* nw);
-	void        (*set_notification_hints)      (GtkWindow* nw, GHashTable* hints);
-	void        (*set_notification_text)       (GtkWindow* nw, const char* summary, const char* body);
-	void        (*set_notification_icon)       (GtkWindow* nw, GdkPixbuf* pixbuf);
-	void        (*set_notification_arrow)      (GtkWindow* nw, gboolean visible, int x, int y);
-	void        (*add_notification_action)     (GtkWindow* nw, const char* label, const char* key, GCallback cb);
-	void        (*clear_notification_actions)  (GtkWindow* nw);
-	void        (*move_notification)           (GtkWindow* nw, int x, int y);
-	void        (*set_notification_timeout)    (GtkWindow* nw, glong timeout);
-	void        (*notification_tick)           (GtkWindow* nw, glong timeout);
-	gboolean    (*get_always_stack)            (GtkWindow* nw);
-
-} ThemeEngine;
+	/* Copy of the engine's table, entry points it doesn't know are NULL */
+	NotifyEngineVTable vtable;
+};
 
 static guint        theme_prop_notify_id = 0;
 static ThemeEngine* active_engine = NULL;
-
-static ThemeEngine* load_theme_engine(const char *name)
+static GQuark       engine_quark = 0;
+
+#ifdef ENABLE_BUILTIN_ENGINES
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE_FOR(coco) (guint abi_version);
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE_FOR(nodoka) (guint abi_version);
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE_FOR(slider) (guint abi_version);
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE_FOR(standard) (guint abi_version);
+
+/* Engines linked into the daemon, looked up before ENGINES_DIR */
+static const struct {
+	const char* name;
+	NotifyEngineGetVTableFunc get_vtable;
+} builtin_engines[] = {
+	{"coco", NOTIFY_ENGINE_GET_VTABLE_FOR(coco)},
+	{"nodoka", NOTIFY_ENGINE_GET_VTABLE_FOR(nodoka)},
+	{"slider", NOTIFY_ENGINE_GET_VTABLE_FOR(slider)},
+	{"standard", NOTIFY_ENGINE_GET_VTABLE_FOR(standard)}
+};
+#endif
+
+static ThemeChangedFunc theme_changed_func = NULL;
+static gpointer         theme_changed_data = NULL;
+static guint            n_theme_switches = 0;
+static gint64           theme_switch_usec = 0;
+static gint64           engine_load_usec = 0;
+static gboolean         engine_builtin = FALSE;
+
+static gboolean bind_engine_vtable(ThemeEngine* engine, NotifyEngineGetVTableFunc get_vtable)
 {
-	ThemeEngine* engine;
-	char* path;
+	const NotifyEngineVTable* vtable;
 
-	path = g_module_build_path (ENGINES_DIR, name);
+	vtable = get_vtable(NOTIFY_ENGINE_ABI_VERSION);
 
-	engine = g_new0(ThemeEngine, 1);
-	engine->ref_count = 1;
-	engine->module = g_module_open(path, G_MODULE_BIND_LAZY);
+	if (vtable == NULL || vtable->abi_version < 2 || vtable->size < NOTIFY_ENGINE_VTABLE_MIN_SIZE)
+	{
+		g_warning("Theme doesn't work with this version of mate-notification-daemon");
+		return FALSE;
+	}
 
-	g_free(path);
+	memcpy(&engine->vtable, vtable, MIN(vtable->size, sizeof(NotifyEngineVTable)));
+	engine->vtable.size = sizeof(NotifyEngineVTable);
 
-	if (engine->module == NULL)
-			goto error;
+	if (engine->vtable.create_notification == NULL
+		|| engine->vtable.set_notification_text == NULL
+		|| engine->vtable.set_notification_icon == NULL
+		|| engine->vtable.set_notification_arrow == NULL
+		|| engine->vtable.add_notification_action == NULL
+		|| engine->vtable.clear_notification_actions == NULL
+		|| engine->vtable.move_notification == NULL)
+	{
+		g_warning("Theme doesn't provide all the required functions");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Engines written before notify_engine_get_vtable() export every entry point */
+static gboolean bind_engine_symbols(ThemeEngine* engine)
+{
+	gboolean (*theme_check_init) (unsigned int major_ver, unsigned int minor_ver, unsigned int micro_ver);
+	gpointer get_theme_info;
 
 	#define BIND_REQUIRED_FUNC(name) \
-		if (!g_module_symbol(engine->module, #name, (gpointer*) &engine->name)) \
+		if (!g_module_symbol(engine->module, #name, (gpointer*) &engine->vtable.name)) \
 		{ \
 			/* Too harsh! Fall back to default. */ \
 			g_warning("Theme doesn't provide the required function '%s'", #name); \
-			goto error; \
+			return FALSE; \
 		}
 
 	#define BIND_OPTIONAL_FUNC(name) \
-		g_module_symbol(engine->module, #name, (gpointer*) &engine->name);
+		g_module_symbol(engine->module, #name, (gpointer*) &engine->vtable.name);
+
+	if (!g_module_symbol(engine->module, "theme_check_init", (gpointer*) &theme_check_init)
+		|| !g_module_symbol(engine->module, "get_theme_info", &get_theme_info))
+	{
+		g_warning("Theme doesn't provide the required version functions");
+		return FALSE;
+	}
 
-	BIND_REQUIRED_FUNC(theme_check_init);
-	BIND_REQUIRED_FUNC(get_theme_info);
 	BIND_REQUIRED_FUNC(create_notification);
 	BIND_REQUIRED_FUNC(set_notification_text);
 	BIND_REQUIRED_FUNC(set_notification_icon);
@@ -98,11 +137,100 @@ static ThemeEngine* load_theme_engine(const char *name)
 	BIND_OPTIONAL_FUNC(notification_tick);
 	BIND_OPTIONAL_FUNC(get_always_stack);
 
-	if (!engine->theme_check_init(NOTIFICATION_DAEMON_MAJOR_VERSION, NOTIFICATION_DAEMON_MINOR_VERSION, NOTIFICATION_DAEMON_MICRO_VERSION))
+	#undef BIND_REQUIRED_FUNC
+	#undef BIND_OPTIONAL_FUNC
+
+	if (!theme_check_init(NOTIFICATION_DAEMON_MAJOR_VERSION, NOTIFICATION_DAEMON_MINOR_VERSION, NOTIFICATION_DAEMON_MICRO_VERSION))
 	{
 		g_warning ("Theme doesn't work with this version of mate-notification-daemon");
-		goto error;
+		return FALSE;
+	}
+
+	engine->vtable.size = sizeof(NotifyEngineVTable);
+	engine->vtable.abi_version = 1;
+
+	return TRUE;
+}
+
+static NotifyEngineGetVTableFunc find_builtin_engine(const char* name)
+{
+#ifdef ENABLE_BUILTIN_ENGINES
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(builtin_engines); i++)
+	{
+		if (strcmp(builtin_engines[i].name, name) == 0)
+		{
+			return builtin_engines[i].get_vtable;
+		}
 	}
+#endif
+
+	return NULL;
+}
+
+static ThemeEngine* load_theme_engine(const char *name)
+{
+	ThemeEngine* engine;
+	NotifyEngineGetVTableFunc get_vtable;
+	char* path;
+	gboolean bound;
+	gint64 start_time;
+
+	start_time = g_get_monotonic_time();
+
+	engine = g_new0(ThemeEngine, 1);
+	engine->ref_count = 1;
+
+	get_vtable = find_builtin_engine(name);
+
+	if (get_vtable != NULL)
+	{
+		if (!bind_engine_vtable(engine, get_vtable))
+				goto error;
+
+		engine_builtin = TRUE;
+		engine_load_usec = g_get_monotonic_time() - start_time;
+
+		return engine;
+	}
+
+	/* A path is opened as is, e.g. a module in the build tree */
+	if (strchr(name, G_DIR_SEPARATOR) != NULL)
+	{
+		path = g_strdup(name);
+	}
+	else
+	{
+		path = g_module_build_path (ENGINES_DIR, name);
+	}
+
+	engine->module = g_module_open(path, G_MODULE_BIND_LAZY);
+
+	g_free(path);
+
+	if (engine->module == NULL)
+			goto error;
+
+	if (g_module_symbol(engine->module, "notify_engine_get_vtable", (gpointer*) &get_vtable))
+	{
+		bound = bind_engine_vtable(engine, get_vtable);
+	}
+	else
+	{
+		bound = bind_engine_symbols(engine);
+	}
+
+	if (!bound)
+			goto error;
+
+	if (engine->vtable.flags & NOTIFY_ENGINE_FLAG_RESIDENT)
+	{
+		g_module_make_resident(engine->module);
+	}
+
+	engine_builtin = FALSE;
+	engine_load_usec = g_get_monotonic_time() - start_time;
 
 	return engine;
 
@@ -124,7 +252,11 @@ static void destroy_engine(ThemeEngine* engine)
 	if (active_engine == engine)
 		active_engine = NULL;
 
-	g_module_close(engine->module);
+	if (engine->module != NULL)
+	{
+		g_module_close(engine->module);
+	}
+
 	g_free(engine);
 }
 
@@ -153,19 +285,53 @@ static void theme_engine_unref(ThemeEngine* engine)
 
 static void theme_changed_cb(GSettings *settings, gchar *key, gpointer user_data)
 {
-	if (active_engine == NULL)
+	ThemeEngine* old_engine = active_engine;
+	gint64 start_time;
+
+	if (old_engine == NULL)
 	{
 		return;
 	}
 
-	theme_engine_unref(active_engine);
+	start_time = g_get_monotonic_time();
 
 	/* This is no longer the true active engine, so reset this. */
 	active_engine = NULL;
+
+	/* Live notifications move to the new engine and drop their references */
+	if (theme_changed_func != NULL)
+	{
+		theme_changed_func(theme_changed_data);
+	}
+
+	if (old_engine->ref_count == 1)
+	{
+		/* Every window of the old engine is gone, no need to wait for an idle */
+		old_engine->ref_count = 0;
+		destroy_engine(old_engine);
+	}
+	else
+	{
+		theme_engine_unref(old_engine);
+	}
+
+	n_theme_switches++;
+	theme_switch_usec = g_get_monotonic_time() - start_time;
+}
+
+void theme_set_changed_func(ThemeChangedFunc func, gpointer user_data)
+{
+	theme_changed_func = func;
+	theme_changed_data = user_data;
 }
 
 static ThemeEngine* get_theme_engine(void)
 {
+	if (engine_quark == 0)
+	{
+		engine_quark = g_quark_from_static_string("notify-theme-engine");
+	}
+
 	if (active_engine == NULL)
 	{
 		GSettings* gsettings = g_settings_new (GSETTINGS_SCHEMA);
@@ -200,22 +366,41 @@ static ThemeEngine* get_theme_engine(void)
 	return active_engine;
 }
 
-GtkWindow* theme_create_notification(UrlClickedCb url_clicked_cb)
+ThemeEngine* theme_engine_open(const char* name)
 {
-	ThemeEngine* engine = get_theme_engine();
-	GtkWindow* nw = engine->create_notification(url_clicked_cb);
-	g_object_set_data_full(G_OBJECT(nw), "_theme_engine", engine, (GDestroyNotify) theme_engine_unref);
+	if (engine_quark == 0)
+	{
+		engine_quark = g_quark_from_static_string("notify-theme-engine");
+	}
+
+	return load_theme_engine(name);
+}
+
+void theme_engine_close(ThemeEngine* engine)
+{
+	theme_engine_unref(engine);
+}
+
+GtkWindow* theme_engine_create_notification(ThemeEngine* engine, UrlClickedCb url_clicked_cb)
+{
+	GtkWindow* nw = engine->vtable.create_notification(url_clicked_cb);
+	g_object_set_qdata_full(G_OBJECT(nw), engine_quark, engine, (GDestroyNotify) theme_engine_unref);
 	engine->ref_count++;
 	return nw;
 }
 
+GtkWindow* theme_create_notification(UrlClickedCb url_clicked_cb)
+{
+	return theme_engine_create_notification(get_theme_engine(), url_clicked_cb);
+}
+
 void theme_destroy_notification(GtkWindow* nw)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->destroy_notification != NULL)
+	if (engine->vtable.destroy_notification != NULL)
 	{
-		engine->destroy_notification(nw);
+		engine->vtable.destroy_notification(nw);
 	}
 	else
 	{
@@ -225,11 +410,11 @@ void theme_destroy_notification(GtkWindow* nw)
 
 void theme_show_notification(GtkWindow* nw)
 {
-	ThemeEngine *engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->show_notification != NULL)
+	if (engine->vtable.show_notification != NULL)
 	{
-		engine->show_notification(nw);
+		engine->vtable.show_notification(nw);
 	}
 	else
 	{
@@ -239,11 +424,11 @@ void theme_show_notification(GtkWindow* nw)
 
 void theme_hide_notification(GtkWindow* nw)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->hide_notification != NULL)
+	if (engine->vtable.hide_notification != NULL)
 	{
-		engine->hide_notification(nw);
+		engine->vtable.hide_notification(nw);
 	}
 	else
 	{
@@ -253,80 +438,176 @@ void theme_hide_notification(GtkWindow* nw)
 
 void theme_set_notification_hints(GtkWindow* nw, GHashTable* hints)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->set_notification_hints != NULL)
+	if (engine->vtable.set_notification_hints != NULL)
 	{
-		engine->set_notification_hints(nw, hints);
+		engine->vtable.set_notification_hints(nw, hints);
 	}
 }
 
 void theme_set_notification_timeout(GtkWindow* nw, glong timeout)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->set_notification_timeout != NULL)
+	if (engine->vtable.set_notification_timeout != NULL)
 	{
-		engine->set_notification_timeout(nw, timeout);
+		engine->vtable.set_notification_timeout(nw, timeout);
 	}
 }
 
 void theme_notification_tick(GtkWindow* nw, glong remaining)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->notification_tick != NULL)
+	if (engine->vtable.notification_tick != NULL)
 	{
-		engine->notification_tick(nw, remaining);
+		engine->vtable.notification_tick(nw, remaining);
 	}
 }
 
 void theme_set_notification_text(GtkWindow* nw, const char* summary, const char* body)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT (nw), "_theme_engine");
-	engine->set_notification_text (nw, summary, body);
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	engine->vtable.set_notification_text (nw, summary, body);
 }
 
 void theme_set_notification_icon(GtkWindow* nw, GdkPixbuf* pixbuf)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT (nw), "_theme_engine");
-	engine->set_notification_icon(nw, pixbuf);
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	engine->vtable.set_notification_icon(nw, pixbuf);
 }
 
 void theme_set_notification_arrow(GtkWindow* nw, gboolean visible, int x, int y)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT (nw), "_theme_engine");
-	engine->set_notification_arrow(nw, visible, x, y);
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	engine->vtable.set_notification_arrow(nw, visible, x, y);
 }
 
 void theme_add_notification_action(GtkWindow* nw, const char* label, const char* key, GCallback cb)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
-	engine->add_notification_action(nw, label, key, cb);
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	engine->vtable.add_notification_action(nw, label, key, cb);
 }
 
 void theme_clear_notification_actions(GtkWindow* nw)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
-	engine->clear_notification_actions(nw);
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	engine->vtable.clear_notification_actions(nw);
 }
 
 void theme_move_notification(GtkWindow* nw, int x, int y)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
-	engine->move_notification(nw, x, y);
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	engine->vtable.move_notification(nw, x, y);
 }
 
 gboolean theme_get_always_stack(GtkWindow* nw)
 {
-	ThemeEngine* engine = g_object_get_data(G_OBJECT(nw), "_theme_engine");
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
 
-	if (engine->get_always_stack != NULL)
+	if (engine->vtable.get_always_stack != NULL)
 	{
-		return engine->get_always_stack(nw);
+		return engine->vtable.get_always_stack(nw);
 	}
 	else
 	{
 		return FALSE;
 	}
 }
+
+/*
+ * Engines without set_notification_content get the changed fields the
+ * way they always did, one at a time.
+ */
+void theme_set_notification_content(GtkWindow* nw, const NotificationContent* content)
+{
+	ThemeEngine* engine = g_object_get_qdata(G_OBJECT(nw), engine_quark);
+	guint i;
+
+	if (engine->vtable.set_notification_content != NULL)
+	{
+		engine->vtable.set_notification_content(nw, content);
+		return;
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_TEXT)
+	{
+		engine->vtable.set_notification_text(nw, content->summary, content->body);
+	}
+
+	if ((content->changed & NOTIFICATION_CONTENT_HINTS) && content->hints != NULL && engine->vtable.set_notification_hints != NULL)
+	{
+		engine->vtable.set_notification_hints(nw, content->hints);
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_ACTIONS)
+	{
+		engine->vtable.clear_notification_actions(nw);
+
+		for (i = 0; i < content->n_actions; i++)
+		{
+			engine->vtable.add_notification_action(nw, content->actions[i].label, content->actions[i].key, content->action_cb);
+		}
+	}
+
+	/* A replacing notification without an icon clears the old one */
+	if (content->changed & NOTIFICATION_CONTENT_ICON)
+	{
+		engine->vtable.set_notification_icon(nw, content->icon);
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_ARROW)
+	{
+		engine->vtable.set_notification_arrow(nw, content->arrow_visible, content->arrow_x, content->arrow_y);
+	}
+
+	if ((content->changed & NOTIFICATION_CONTENT_TIMEOUT) && content->timeout > 0 && engine->vtable.set_notification_timeout != NULL)
+	{
+		engine->vtable.set_notification_timeout(nw, content->timeout);
+	}
+}
+
+void theme_add_statistics(GHashTable* stats)
+{
+	notify_stats_set_uint64(stats, "theme-switches", n_theme_switches);
+	notify_stats_set_uint64(stats, "theme-switch-usec", theme_switch_usec);
+	notify_stats_set_uint64(stats, "theme-engine-builtin", engine_builtin);
+	notify_stats_set_uint64(stats, "theme-engine-load-usec", engine_load_usec);
+
+	/* Counts restart with each engine loaded as a module */
+	if (active_engine != NULL && active_engine->vtable.get_repaint_counts != NULL)
+	{
+		NotifyEngineRepaintCounts counts;
+
+		active_engine->vtable.get_repaint_counts(&counts);
+
+		notify_stats_set_uint64(stats, "engine-paints", counts.paints);
+		notify_stats_set_uint64(stats, "engine-configure-moves", counts.configure_moves);
+		notify_stats_set_uint64(stats, "engine-configure-resizes", counts.configure_resizes);
+		notify_stats_set_uint64(stats, "engine-queued-redraws", counts.queued_redraws);
+	}
+}
+
+/* Resolve the active engine ahead of the first notification */
+void theme_preload_engine(void)
+{
+	get_theme_engine();
+}
+
+/* Image memory the active engine caches, 0 if it doesn't tell */
+gsize theme_get_cache_size(void)
+{
+	if (active_engine == NULL || active_engine->vtable.get_cache_size == NULL)
+		return 0;
+
+	return active_engine->vtable.get_cache_size();
+}
+
+gsize theme_release_caches(gsize excess)
+{
+	if (active_engine == NULL || active_engine->vtable.release_caches == NULL)
+		return 0;
+
+	return active_engine->vtable.release_caches(excess);
+}
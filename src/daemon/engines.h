@@ -26,7 +26,12 @@
 
 #include <gtk/gtk.h>
 
+#include "notify-engine.h"
+
 typedef void    (*UrlClickedCb) (GtkWindow * nw, const char *url);
+typedef void    (*ThemeChangedFunc) (gpointer user_data);
+
+typedef struct _ThemeEngine ThemeEngine;
 
 GtkWindow      *theme_create_notification        (UrlClickedCb url_clicked_cb);
 void            theme_destroy_notification       (GtkWindow   *nw);
@@ -56,5 +61,22 @@ void            theme_move_notification          (GtkWindow   *nw,
                                                   int          x,
                                                   int          y);
 gboolean        theme_get_always_stack           (GtkWindow   *nw);
+void            theme_set_notification_content   (GtkWindow   *nw,
+                                                  const NotificationContent *content);
+void            theme_preload_engine             (void);
+void            theme_set_changed_func           (ThemeChangedFunc func,
+                                                  gpointer     user_data);
+void            theme_add_statistics             (GHashTable  *stats);
+gsize           theme_get_cache_size             (void);
+gsize           theme_release_caches             (gsize        excess);
+
+/*
+ * An engine other than the configured one, by name or by module path,
+ * e.g. to render or benchmark it. Its windows keep it loaded.
+ */
+ThemeEngine    *theme_engine_open                (const char  *name);
+void            theme_engine_close               (ThemeEngine *engine);
+GtkWindow      *theme_engine_create_notification (ThemeEngine *engine,
+                                                  UrlClickedCb url_clicked_cb);
 
 #endif /* _ENGINES_H_ */
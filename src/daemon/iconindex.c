@@ -0,0 +1,761 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "iconindex.h"
+#include "stats.h"
+
+#define INDEX_MAGIC   "MNDI"
+#define INDEX_VERSION 2
+#define INDEX_SIZE    48
+#define NO_FILE       0xffffffff
+
+enum {
+	SUBDIR_FIXED,
+	SUBDIR_SCALABLE,
+	SUBDIR_THRESHOLD
+};
+
+/* In order of preference */
+static const char* extensions[] = { ".png", ".svg", ".xpm" };
+
+/*
+ * On-disk layout: header, directory table, hash buckets, string pool.
+ * Offsets are from the start of the file. The file is a private cache,
+ * so it is stored in host byte order.
+ */
+typedef struct {
+	gchar   magic[4];
+	guint32 version;
+	guint32 n_names;
+	guint32 n_dirs;
+	guint32 dirs_offset;
+	guint32 n_buckets;
+	guint32 buckets_offset;
+	guint32 length;
+} IndexHeader;
+
+typedef struct {
+	guint32 path;
+	guint32 toplevel;
+	gint64  mtime;
+} IndexDir;
+
+typedef struct {
+	guint32 hash;
+	guint32 name;     /* 0 for an empty bucket */
+	guint32 file;     /* (dir << 2) | extension */
+} IndexBucket;
+
+typedef struct {
+	gint type;
+	gint size;
+	gint min_size;
+	gint max_size;
+	gint threshold;
+	gint scale;
+} SubdirInfo;
+
+typedef struct {
+	guint32 file;
+	gint    distance;
+} BuildEntry;
+
+/* Everything a build needs, so that it can run in a thread */
+typedef struct {
+	GPtrArray*  dir_paths;
+	GArray*     dirs;
+	GHashTable* names;
+	GHashTable* visited;
+	gchar**     search_path;
+	gint        n_search_path;
+	gchar*      theme;
+	gchar*      index_path;
+	gint64      usec;
+} IndexBuilder;
+
+static GtkIconTheme* icon_theme = NULL;
+static gchar*        index_theme = NULL;
+static GMappedFile*  index_file = NULL;
+static const gchar*  index_data = NULL;
+static gsize         index_length = 0;
+static gboolean      building = FALSE;
+static gboolean      build_queued = FALSE;
+static guint         validate_id = 0;
+
+static guint64       n_hits = 0;
+static guint64       n_misses = 0;
+static gint64        load_usec = 0;
+static gint64        build_usec = 0;
+
+static guint32 hash_name(const char* name)
+{
+	guint32 hash = 2166136261u;
+
+	for (; *name != '\0'; name++)
+	{
+		hash ^= (guchar) *name;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static gchar* get_index_path(void)
+{
+	gchar* filename;
+	gchar* path;
+
+	filename = g_strdup_printf("icon-index-%s", index_theme);
+	g_strdelimit(filename, G_DIR_SEPARATOR_S, '_');
+	path = g_build_filename(g_get_user_cache_dir(), "mate-notification-daemon", filename, NULL);
+	g_free(filename);
+
+	return path;
+}
+
+static const IndexHeader* get_header(void)
+{
+	return (const IndexHeader*) index_data;
+}
+
+static const IndexDir* get_dirs(void)
+{
+	return (const IndexDir*) (index_data + get_header()->dirs_offset);
+}
+
+/* Whether a NUL-terminated string starts at offset inside the mapping */
+static gboolean is_valid_string(guint32 offset)
+{
+	return offset < index_length && memchr(index_data + offset, '\0', index_length - offset) != NULL;
+}
+
+/* Bucket names and files are checked as they are looked up */
+static gboolean dirs_valid(void)
+{
+	const IndexDir* dirs = get_dirs();
+	guint32 i;
+
+	for (i = 0; i < get_header()->n_dirs; i++)
+	{
+		if (!is_valid_string(dirs[i].path))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean dirs_unchanged(gboolean toplevel_only)
+{
+	const IndexDir* dirs = get_dirs();
+	struct stat st;
+	guint32 i;
+
+	for (i = 0; i < get_header()->n_dirs; i++)
+	{
+		if (toplevel_only && !dirs[i].toplevel)
+			continue;
+
+		if (g_stat(index_data + dirs[i].path, &st) != 0 || st.st_mtime != dirs[i].mtime)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void unload_index(void)
+{
+	if (index_file != NULL)
+	{
+		g_mapped_file_unref(index_file);
+		index_file = NULL;
+		index_data = NULL;
+		index_length = 0;
+	}
+}
+
+static gboolean load_index(void)
+{
+	const IndexHeader* header;
+	gchar* path;
+	gsize length;
+
+	unload_index();
+
+	path = get_index_path();
+	index_file = g_mapped_file_new(path, FALSE, NULL);
+	g_free(path);
+
+	if (index_file == NULL)
+		return FALSE;
+
+	index_data = g_mapped_file_get_contents(index_file);
+	length = g_mapped_file_get_length(index_file);
+	index_length = length;
+	header = get_header();
+
+	if (length < sizeof(IndexHeader)
+		|| memcmp(header->magic, INDEX_MAGIC, 4) != 0
+		|| header->version != INDEX_VERSION
+		|| header->length != length
+		|| header->n_buckets == 0
+		|| (header->n_buckets & (header->n_buckets - 1)) != 0
+		|| header->dirs_offset % sizeof(gint64) != 0
+		|| header->buckets_offset % sizeof(guint32) != 0
+		|| (gsize) header->dirs_offset + (gsize) header->n_dirs * sizeof(IndexDir) > length
+		|| (gsize) header->buckets_offset + (gsize) header->n_buckets * sizeof(IndexBucket) > length
+		|| !dirs_valid()
+		|| !dirs_unchanged(TRUE))
+	{
+		unload_index();
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static guint32 builder_add_dir(IndexBuilder* builder, const gchar* path, gboolean toplevel)
+{
+	IndexDir dir = { 0 };
+	struct stat st;
+
+	if (g_stat(path, &st) == 0)
+		dir.mtime = st.st_mtime;
+
+	dir.toplevel = toplevel;
+
+	g_ptr_array_add(builder->dir_paths, g_strdup(path));
+	g_array_append_val(builder->dirs, dir);
+
+	return builder->dirs->len - 1;
+}
+
+static gboolean read_subdir_info(GKeyFile* keyfile, const gchar* subdir, SubdirInfo* info)
+{
+	gchar* type;
+
+	if (!g_key_file_has_key(keyfile, subdir, "Size", NULL))
+		return FALSE;
+
+	info->size = g_key_file_get_integer(keyfile, subdir, "Size", NULL);
+	info->scale = g_key_file_has_key(keyfile, subdir, "Scale", NULL) ? g_key_file_get_integer(keyfile, subdir, "Scale", NULL) : 1;
+	info->min_size = g_key_file_has_key(keyfile, subdir, "MinSize", NULL) ? g_key_file_get_integer(keyfile, subdir, "MinSize", NULL) : info->size;
+	info->max_size = g_key_file_has_key(keyfile, subdir, "MaxSize", NULL) ? g_key_file_get_integer(keyfile, subdir, "MaxSize", NULL) : info->size;
+	info->threshold = g_key_file_has_key(keyfile, subdir, "Threshold", NULL) ? g_key_file_get_integer(keyfile, subdir, "Threshold", NULL) : 2;
+
+	type = g_key_file_get_string(keyfile, subdir, "Type", NULL);
+
+	if (g_strcmp0(type, "Fixed") == 0)
+		info->type = SUBDIR_FIXED;
+	else if (g_strcmp0(type, "Scalable") == 0)
+		info->type = SUBDIR_SCALABLE;
+	else
+		info->type = SUBDIR_THRESHOLD;
+
+	g_free(type);
+
+	if (info->scale < 1)
+		info->scale = 1;
+
+	return TRUE;
+}
+
+/*
+ * Same rules as the icon theme spec, for scale 1: notification icons are
+ * pixbufs drawn at their size, so a scaled variant would only be shrunk
+ * back. A wrong scale never matches exactly.
+ */
+static gint subdir_distance(const SubdirInfo* info, gint size)
+{
+	gint wanted = size;
+	gint min_size;
+	gint max_size;
+	gint distance = 0;
+
+	switch (info->type)
+	{
+		case SUBDIR_FIXED:
+			min_size = max_size = info->size;
+			break;
+		case SUBDIR_SCALABLE:
+			min_size = info->min_size;
+			max_size = info->max_size;
+			break;
+		default:
+			min_size = info->size - info->threshold;
+			max_size = info->size + info->threshold;
+			break;
+	}
+
+	min_size *= info->scale;
+	max_size *= info->scale;
+
+	if (wanted < min_size)
+		distance = min_size - wanted;
+	else if (wanted > max_size)
+		distance = wanted - max_size;
+
+	if (info->scale != 1)
+		distance++;
+
+	return distance;
+}
+
+static void scan_subdir(IndexBuilder* builder, GHashTable* theme_names, const gchar* path, const SubdirInfo* info)
+{
+	GDir* dir;
+	const gchar* filename;
+	guint32 dir_index;
+
+	dir = g_dir_open(path, 0, NULL);
+
+	if (dir == NULL)
+		return;
+
+	dir_index = builder_add_dir(builder, path, FALSE);
+
+	while ((filename = g_dir_read_name(dir)) != NULL)
+	{
+		BuildEntry* entry;
+		gsize len = strlen(filename);
+		guint32 ext;
+		gchar* name;
+		gint distance;
+
+		for (ext = 0; ext < G_N_ELEMENTS(extensions); ext++)
+		{
+			if (len > 4 && strcmp(filename + len - 4, extensions[ext]) == 0)
+				break;
+		}
+
+		if (ext == G_N_ELEMENTS(extensions))
+			continue;
+
+		name = g_strndup(filename, len - 4);
+
+		entry = g_hash_table_lookup(theme_names, name);
+
+		if (entry == NULL)
+		{
+			entry = g_new(BuildEntry, 1);
+			entry->file = NO_FILE;
+			g_hash_table_insert(theme_names, name, entry);
+		}
+		else
+		{
+			g_free(name);
+		}
+
+		distance = subdir_distance(info, INDEX_SIZE);
+
+		if (entry->file == NO_FILE
+			|| distance < entry->distance
+			|| (distance == entry->distance && ext < (entry->file & 3)))
+		{
+			entry->file = (dir_index << 2) | ext;
+			entry->distance = distance;
+		}
+	}
+
+	g_dir_close(dir);
+}
+
+static void scan_theme(IndexBuilder* builder, const gchar* theme_name)
+{
+	GKeyFile* keyfile = NULL;
+	GPtrArray* bases;
+	GHashTable* theme_names;
+	GHashTableIter iter;
+	gpointer name;
+	gpointer entry;
+	gchar** subdirs;
+	gchar** scaled_subdirs;
+	gchar** inherits;
+	guint i;
+	gint j;
+
+	if (g_hash_table_contains(builder->visited, theme_name))
+		return;
+
+	g_hash_table_add(builder->visited, g_strdup(theme_name));
+
+	bases = g_ptr_array_new_with_free_func(g_free);
+
+	for (j = 0; j < builder->n_search_path; j++)
+	{
+		gchar* base = g_build_filename(builder->search_path[j], theme_name, NULL);
+
+		if (!g_file_test(base, G_FILE_TEST_IS_DIR))
+		{
+			g_free(base);
+			continue;
+		}
+
+		if (keyfile == NULL)
+		{
+			gchar* index_theme_file = g_build_filename(base, "index.theme", NULL);
+
+			keyfile = g_key_file_new();
+
+			if (!g_key_file_load_from_file(keyfile, index_theme_file, G_KEY_FILE_NONE, NULL))
+			{
+				g_key_file_free(keyfile);
+				keyfile = NULL;
+			}
+
+			g_free(index_theme_file);
+		}
+
+		g_ptr_array_add(bases, base);
+	}
+
+	if (keyfile == NULL)
+	{
+		g_ptr_array_unref(bases);
+		return;
+	}
+
+	subdirs = g_key_file_get_string_list(keyfile, "Icon Theme", "Directories", NULL, NULL);
+	scaled_subdirs = g_key_file_get_string_list(keyfile, "Icon Theme", "ScaledDirectories", NULL, NULL);
+	theme_names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	for (i = 0; i < bases->len; i++)
+	{
+		gchar** lists[2] = { subdirs, scaled_subdirs };
+		gint l;
+
+		builder_add_dir(builder, g_ptr_array_index(bases, i), TRUE);
+
+		for (l = 0; l < 2; l++)
+		{
+			for (j = 0; lists[l] != NULL && lists[l][j] != NULL; j++)
+			{
+				SubdirInfo info;
+				gchar* path;
+
+				if (!read_subdir_info(keyfile, lists[l][j], &info))
+					continue;
+
+				path = g_build_filename(g_ptr_array_index(bases, i), lists[l][j], NULL);
+				scan_subdir(builder, theme_names, path, &info);
+				g_free(path);
+			}
+		}
+	}
+
+	/* Icons of a theme take precedence over the ones it inherits */
+	g_hash_table_iter_init(&iter, theme_names);
+
+	while (g_hash_table_iter_next(&iter, &name, &entry))
+	{
+		if (!g_hash_table_contains(builder->names, name))
+		{
+			g_hash_table_iter_steal(&iter);
+			g_hash_table_insert(builder->names, name, entry);
+		}
+	}
+
+	g_hash_table_destroy(theme_names);
+	g_strfreev(subdirs);
+	g_strfreev(scaled_subdirs);
+	g_ptr_array_unref(bases);
+
+	inherits = g_key_file_get_string_list(keyfile, "Icon Theme", "Inherits", NULL, NULL);
+
+	for (j = 0; inherits != NULL && inherits[j] != NULL; j++)
+		scan_theme(builder, inherits[j]);
+
+	g_strfreev(inherits);
+	g_key_file_free(keyfile);
+}
+
+static guint32 pool_add(GString* pool, guint32 pool_offset, const gchar* str)
+{
+	guint32 offset = pool_offset + pool->len;
+
+	g_string_append_len(pool, str, strlen(str) + 1);
+
+	return offset;
+}
+
+/* Runs in the build thread */
+static gboolean write_index(IndexBuilder* builder)
+{
+	IndexHeader header;
+	IndexBucket* buckets;
+	GHashTableIter iter;
+	gpointer name;
+	BuildEntry* entry;
+	GString* pool;
+	GString* out;
+	guint32 n_buckets = 64;
+	guint32 pool_offset;
+	guint32 i;
+	gchar* dir;
+	gboolean res;
+
+	while (n_buckets < 2 * g_hash_table_size(builder->names))
+		n_buckets <<= 1;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, 4);
+	header.version = INDEX_VERSION;
+	header.n_names = g_hash_table_size(builder->names);
+	header.n_dirs = builder->dirs->len;
+	header.dirs_offset = sizeof(IndexHeader);
+	header.n_buckets = n_buckets;
+	header.buckets_offset = header.dirs_offset + header.n_dirs * sizeof(IndexDir);
+	pool_offset = header.buckets_offset + n_buckets * sizeof(IndexBucket);
+
+	pool = g_string_new(NULL);
+
+	for (i = 0; i < builder->dirs->len; i++)
+	{
+		g_array_index(builder->dirs, IndexDir, i).path = pool_add(pool, pool_offset, g_ptr_array_index(builder->dir_paths, i));
+	}
+
+	buckets = g_new0(IndexBucket, n_buckets);
+	g_hash_table_iter_init(&iter, builder->names);
+
+	while (g_hash_table_iter_next(&iter, &name, (gpointer*) &entry))
+	{
+		guint32 hash = hash_name(name);
+		guint32 b = hash & (n_buckets - 1);
+
+		while (buckets[b].name != 0)
+			b = (b + 1) & (n_buckets - 1);
+
+		buckets[b].hash = hash;
+		buckets[b].name = pool_add(pool, pool_offset, name);
+		buckets[b].file = entry->file;
+	}
+
+	header.length = pool_offset + pool->len;
+
+	out = g_string_sized_new(header.length);
+	g_string_append_len(out, (const gchar*) &header, sizeof(header));
+	g_string_append_len(out, (const gchar*) builder->dirs->data, header.n_dirs * sizeof(IndexDir));
+	g_string_append_len(out, (const gchar*) buckets, n_buckets * sizeof(IndexBucket));
+	g_string_append_len(out, pool->str, pool->len);
+
+	dir = g_path_get_dirname(builder->index_path);
+	g_mkdir_with_parents(dir, 0700);
+
+	res = g_file_set_contents(builder->index_path, out->str, out->len, NULL);
+
+	g_free(dir);
+	g_string_free(out, TRUE);
+	g_string_free(pool, TRUE);
+	g_free(buckets);
+
+	return res;
+}
+
+static void free_builder(IndexBuilder* builder)
+{
+	g_strfreev(builder->search_path);
+	g_hash_table_destroy(builder->visited);
+	g_hash_table_destroy(builder->names);
+	g_array_free(builder->dirs, TRUE);
+	g_ptr_array_unref(builder->dir_paths);
+	g_free(builder->theme);
+	g_free(builder->index_path);
+	g_free(builder);
+}
+
+/* Scanning every theme directory takes long, so it is kept off the main loop */
+static void build_index_thread(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	IndexBuilder* builder = task_data;
+	gint64 start = g_get_monotonic_time();
+	gboolean res;
+
+	scan_theme(builder, builder->theme);
+	scan_theme(builder, "hicolor");
+
+	res = write_index(builder);
+
+	builder->usec = g_get_monotonic_time() - start;
+
+	g_task_return_boolean(task, res);
+}
+
+static void queue_build(void);
+
+static void build_index_done(GObject* source_object, GAsyncResult* result, gpointer user_data)
+{
+	IndexBuilder* builder = g_task_get_task_data(G_TASK(result));
+	gboolean res;
+
+	res = g_task_propagate_boolean(G_TASK(result), NULL);
+
+	building = FALSE;
+	build_usec = builder->usec;
+
+	/* The theme changed while building, this index is already stale */
+	if (build_queued)
+	{
+		build_queued = FALSE;
+		queue_build();
+	}
+	else if (res && g_strcmp0(builder->theme, index_theme) == 0)
+	{
+		load_index();
+	}
+}
+
+static void queue_build(void)
+{
+	IndexBuilder* builder;
+	GTask* task;
+
+	if (building)
+	{
+		build_queued = TRUE;
+		return;
+	}
+
+	builder = g_new0(IndexBuilder, 1);
+	builder->dir_paths = g_ptr_array_new_with_free_func(g_free);
+	builder->dirs = g_array_new(FALSE, TRUE, sizeof(IndexDir));
+	builder->names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	builder->visited = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	builder->theme = g_strdup(index_theme);
+	builder->index_path = get_index_path();
+
+	gtk_icon_theme_get_search_path(icon_theme, &builder->search_path, &builder->n_search_path);
+
+	building = TRUE;
+
+	task = g_task_new(NULL, NULL, build_index_done, NULL);
+	g_task_set_task_data(task, builder, (GDestroyNotify) free_builder);
+	g_task_run_in_thread(task, build_index_thread);
+	g_object_unref(task);
+}
+
+/* Only top level directories are checked at load time, the rest here */
+static gboolean validate_index(gpointer user_data)
+{
+	validate_id = 0;
+
+	if (index_data != NULL && !dirs_unchanged(FALSE))
+	{
+		unload_index();
+		queue_build();
+	}
+
+	return FALSE;
+}
+
+static void reload_index(void)
+{
+	g_free(index_theme);
+	index_theme = NULL;
+
+	g_object_get(gtk_settings_get_default(), "gtk-icon-theme-name", &index_theme, NULL);
+
+	if (index_theme == NULL)
+		index_theme = g_strdup("hicolor");
+
+	if (load_index())
+	{
+		if (validate_id == 0)
+			validate_id = g_idle_add_full(G_PRIORITY_LOW, validate_index, NULL, NULL);
+	}
+	else
+	{
+		queue_build();
+	}
+}
+
+static void icon_theme_changed_cb(GtkIconTheme* theme, gpointer user_data)
+{
+	reload_index();
+}
+
+void icon_index_init(GtkIconTheme* theme)
+{
+	gint64 start = g_get_monotonic_time();
+
+	if (icon_theme != NULL)
+		return;
+
+	icon_theme = theme;
+	g_signal_connect(icon_theme, "changed", G_CALLBACK(icon_theme_changed_cb), NULL);
+
+	reload_index();
+
+	load_usec = g_get_monotonic_time() - start;
+}
+
+gchar* icon_index_lookup(const char* name)
+{
+	const IndexBucket* buckets;
+	guint32 hash;
+	guint32 mask;
+	guint32 b;
+	guint32 n;
+
+	if (index_data == NULL)
+		return NULL;
+
+	buckets = (const IndexBucket*) (index_data + get_header()->buckets_offset);
+	mask = get_header()->n_buckets - 1;
+	hash = hash_name(name);
+
+	/* A corrupt index may have no empty bucket to stop at */
+	for (b = hash & mask, n = 0; n <= mask && buckets[b].name != 0; b = (b + 1) & mask, n++)
+	{
+		if (buckets[b].hash == hash && is_valid_string(buckets[b].name) && strcmp(index_data + buckets[b].name, name) == 0)
+		{
+			guint32 file = buckets[b].file;
+
+			if (file == NO_FILE
+				|| (file >> 2) >= get_header()->n_dirs
+				|| (file & 3) >= G_N_ELEMENTS(extensions))
+				break;
+
+			n_hits++;
+
+			return g_strconcat(index_data + get_dirs()[file >> 2].path, G_DIR_SEPARATOR_S, name, extensions[file & 3], NULL);
+		}
+	}
+
+	n_misses++;
+
+	return NULL;
+}
+
+void icon_index_add_statistics(GHashTable* stats)
+{
+	notify_stats_set_uint64(stats, "icon-index-names", index_data != NULL ? get_header()->n_names : 0);
+	notify_stats_set_uint64(stats, "icon-index-hits", n_hits);
+	notify_stats_set_uint64(stats, "icon-index-misses", n_misses);
+	notify_stats_set_uint64(stats, "icon-index-load-usec", load_usec);
+	notify_stats_set_uint64(stats, "icon-index-build-usec", build_usec);
+}
@@ -0,0 +1,36 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _ICON_INDEX_H_
+#define _ICON_INDEX_H_
+
+#include <gtk/gtk.h>
+
+/*
+ * Precomputed name -> file index of the active icon theme (and the
+ * themes it inherits from), for 48px icons. The index lives in
+ * $XDG_CACHE_HOME/mate-notification-daemon and is mapped at startup; it
+ * is validated from an idle callback and (re)built in a thread.
+ */
+void icon_index_init(GtkIconTheme* theme);
+gchar* icon_index_lookup(const char* name);
+void icon_index_add_statistics(GHashTable* stats);
+
+#endif /* _ICON_INDEX_H_ */
@@ -0,0 +1,184 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_ENGINE_H_
+#define _NOTIFY_ENGINE_H_
+
+#include <gmodule.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Interface between the daemon and a theme engine. An engine exports
+ * notify_engine_get_vtable(), which is handed the ABI version the daemon
+ * speaks and returns a table that lives as long as the module. New entry
+ * points are only ever appended, so the size field tells the daemon which
+ * of them the engine knows about; anything past it is treated as NULL.
+ */
+#define NOTIFY_ENGINE_ABI_VERSION 2
+
+typedef void (*NotifyEngineUrlClickedCb) (GtkWindow* nw, const char* url);
+
+typedef enum {
+	/* The module must not be unloaded, e.g. it registers GTypes */
+	NOTIFY_ENGINE_FLAG_RESIDENT = 1 << 0
+} NotifyEngineFlags;
+
+/*
+ * Engines ask the screen whether it is composited, unless this key is set
+ * on the GdkScreen to a NotifyEngineCompositing. Benchmarks use it to
+ * measure both composited and shaped windows on the same display.
+ */
+#define NOTIFY_ENGINE_COMPOSITING_KEY "notify-engine-compositing"
+
+typedef enum {
+	NOTIFY_ENGINE_COMPOSITING_AUTO,
+	NOTIFY_ENGINE_COMPOSITING_ON,
+	NOTIFY_ENGINE_COMPOSITING_OFF
+} NotifyEngineCompositing;
+
+typedef struct {
+	const char*  label;
+	const char*  key;
+} NotificationAction;
+
+/*
+ * Parts of a NotificationContent that differ from what the window shows.
+ * A change of action_icons also flags the actions, whose buttons it restyles.
+ */
+typedef enum {
+	NOTIFICATION_CONTENT_TEXT    = 1 << 0,
+	NOTIFICATION_CONTENT_HINTS   = 1 << 1,
+	NOTIFICATION_CONTENT_ACTIONS = 1 << 2,
+	NOTIFICATION_CONTENT_ICON    = 1 << 3,
+	NOTIFICATION_CONTENT_ARROW   = 1 << 4,
+	NOTIFICATION_CONTENT_TIMEOUT = 1 << 5,
+	NOTIFICATION_CONTENT_ALL     = (1 << 6) - 1
+} NotificationContentFields;
+
+/*
+ * Everything a Notify call sets on a window, handed to the engine at once.
+ * Nothing in it outlives the call. Engines only need to apply the fields
+ * flagged in changed, the others are what the window already shows.
+ */
+typedef struct {
+	const char*  summary;
+	const char*  body;
+
+	/* Raw hints, plus the ones every engine cares about already parsed */
+	GHashTable*  hints;
+	guint8       urgency;
+	gboolean     action_icons;
+
+	const NotificationAction* actions;
+	guint        n_actions;
+	GCallback    action_cb;
+
+	GdkPixbuf*   icon;
+
+	gboolean     arrow_visible;
+	int          arrow_x;
+	int          arrow_y;
+
+	/* msec, 0 if the notification doesn't expire */
+	glong        timeout;
+
+	/* NotificationContentFields */
+	guint        changed;
+} NotificationContent;
+
+/*
+ * Paint accounting of an engine, summed over its windows. Moves alone,
+ * like those of stack shifts, are not meant to cause any paints.
+ */
+typedef struct {
+	guint64      paints;             /* window backgrounds drawn */
+	guint64      configure_moves;    /* configure events that only moved a window */
+	guint64      configure_resizes;  /* configure events that resized one */
+	guint64      queued_redraws;     /* redraws the engine queued itself */
+} NotifyEngineRepaintCounts;
+
+typedef struct {
+	gsize        size;
+	guint        abi_version;
+	guint        flags;
+
+	const char*  name;
+	const char*  version;
+	const char*  author;
+	const char*  homepage;
+
+	/* required */
+	GtkWindow*  (*create_notification)         (NotifyEngineUrlClickedCb url_clicked_cb);
+	void        (*set_notification_text)       (GtkWindow* nw, const char* summary, const char* body);
+	void        (*set_notification_icon)       (GtkWindow* nw, GdkPixbuf* pixbuf);
+	void        (*set_notification_arrow)      (GtkWindow* nw, gboolean visible, int x, int y);
+	void        (*add_notification_action)     (GtkWindow* nw, const char* label, const char* key, GCallback cb);
+	void        (*clear_notification_actions)  (GtkWindow* nw);
+	void        (*move_notification)           (GtkWindow* nw, int x, int y);
+
+	/* optional, may be NULL */
+	void        (*destroy_notification)        (GtkWindow* nw);
+	void        (*show_notification)           (GtkWindow* nw);
+	void        (*hide_notification)           (GtkWindow* nw);
+	void        (*set_notification_hints)      (GtkWindow* nw, GHashTable* hints);
+	void        (*set_notification_timeout)    (GtkWindow* nw, glong timeout);
+	void        (*notification_tick)           (GtkWindow* nw, glong remaining);
+	gboolean    (*get_always_stack)            (GtkWindow* nw);
+
+	/* Replaces text, hints, actions, icon, arrow and timeout in one go */
+	void        (*set_notification_content)    (GtkWindow* nw, const NotificationContent* content);
+
+	/* Paint accounting for the daemon's statistics */
+	void        (*get_repaint_counts)          (NotifyEngineRepaintCounts* counts);
+
+	/* Image memory in caches the engine can rebuild, and giving it back */
+	gsize       (*get_cache_size)              (void);
+	gsize       (*release_caches)              (gsize excess);
+} NotifyEngineVTable;
+
+/* Smallest table a v2 engine may return: up to the required entry points */
+#define NOTIFY_ENGINE_VTABLE_MIN_SIZE G_STRUCT_OFFSET(NotifyEngineVTable, destroy_notification)
+
+typedef const NotifyEngineVTable* (*NotifyEngineGetVTableFunc) (guint abi_version);
+
+/*
+ * The bundled engines can also be linked into the daemon
+ * (--enable-builtin-engines). They are then compiled with
+ * NOTIFY_ENGINE_BUILTIN set to their name, which keeps their old entry
+ * points private and gives each vtable getter a name of its own.
+ */
+#ifdef NOTIFY_ENGINE_BUILTIN
+#define NOTIFY_ENGINE_SYMBOL static G_GNUC_UNUSED
+#define NOTIFY_ENGINE_GET_VTABLE NOTIFY_ENGINE_GET_VTABLE_FOR (NOTIFY_ENGINE_BUILTIN)
+#else
+#define NOTIFY_ENGINE_SYMBOL G_MODULE_EXPORT
+#define NOTIFY_ENGINE_GET_VTABLE notify_engine_get_vtable
+#endif
+
+#define NOTIFY_ENGINE_GET_VTABLE_FOR(name) _NOTIFY_ENGINE_GET_VTABLE_FOR (name)
+#define _NOTIFY_ENGINE_GET_VTABLE_FOR(name) notify_engine_get_vtable_##name
+
+G_MODULE_EXPORT const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE (guint abi_version);
+
+G_END_DECLS
+
+#endif /* _NOTIFY_ENGINE_H_ */
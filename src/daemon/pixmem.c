@@ -0,0 +1,382 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <dbus/dbus-glib.h>
+
+#include "daemon.h"
+#include "pixmem.h"
+#include "stats.h"
+
+/* Icons this small are never downsampled, only dropped */
+#define SMALL_ICON_BYTES (24 * 24 * 4)
+
+typedef struct {
+	guint  id;
+	gchar* sender;
+	gint   urgency;
+	gsize  icon_bytes;
+} PixmemEntry;
+
+typedef struct {
+	guint          id;
+	gchar*         name;
+	PixmemSizeFunc size;
+	PixmemTrimFunc trim;
+	gpointer       user_data;
+} PixmemCache;
+
+static GHashTable*       entries = NULL;
+static GList*            caches = NULL;
+static guint             next_cache_id = 1;
+static gsize             budget = 0;
+static gsize             icon_usage = 0;
+static gsize             peak = 0;
+static PixmemReclaimFunc reclaim_func = NULL;
+static gpointer          reclaim_data = NULL;
+static gboolean          enforcing = FALSE;
+static guint             enforce_idle_id = 0;
+
+static guint64           n_cache_trims = 0;
+static guint64           n_downsampled = 0;
+static guint64           n_dropped = 0;
+
+static void free_entry(PixmemEntry* entry)
+{
+	icon_usage -= entry->icon_bytes;
+	g_free(entry->sender);
+	g_free(entry);
+}
+
+static PixmemEntry* lookup_entry(guint id)
+{
+	if (entries == NULL)
+		return NULL;
+
+	return g_hash_table_lookup(entries, GUINT_TO_POINTER(id));
+}
+
+static gsize get_cache_usage(void)
+{
+	gsize bytes = 0;
+	GList* l;
+
+	for (l = caches; l != NULL; l = l->next)
+	{
+		PixmemCache* cache = l->data;
+
+		bytes += cache->size(cache->user_data);
+	}
+
+	return bytes;
+}
+
+/* Caches only report their size when asked, so the peak is sampled here */
+static gsize get_usage(void)
+{
+	gsize usage = icon_usage + get_cache_usage();
+
+	if (usage > peak)
+		peak = usage;
+
+	return usage;
+}
+
+static gboolean enforce_idle(gpointer user_data)
+{
+	enforce_idle_id = 0;
+	pixmem_enforce();
+
+	return FALSE;
+}
+
+/* Apply @delta to an icon counter, keeping the total in sync */
+static void charge(gsize* counter, gssize delta)
+{
+	if (delta < 0 && (gsize) -delta > *counter)
+		delta = - (gssize) *counter;
+
+	*counter += delta;
+	icon_usage += delta;
+
+	if (delta > 0 && budget > 0 && !enforcing && enforce_idle_id == 0 && get_usage() > budget)
+		enforce_idle_id = g_idle_add(enforce_idle, NULL);
+}
+
+void pixmem_set_budget(gsize bytes)
+{
+	budget = bytes;
+	pixmem_enforce();
+}
+
+gsize pixmem_get_budget(void)
+{
+	return budget;
+}
+
+gsize pixmem_get_usage(void)
+{
+	return get_usage();
+}
+
+gsize pixmem_pixbuf_size(GdkPixbuf* pixbuf)
+{
+	if (pixbuf == NULL)
+		return 0;
+
+	return (gsize) gdk_pixbuf_get_rowstride(pixbuf) * gdk_pixbuf_get_height(pixbuf);
+}
+
+void pixmem_track_notification(guint id, const char* sender, gint urgency)
+{
+	PixmemEntry* entry;
+
+	if (entries == NULL)
+		entries = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify) free_entry);
+
+	entry = lookup_entry(id);
+
+	if (entry == NULL)
+	{
+		entry = g_new0(PixmemEntry, 1);
+		entry->id = id;
+		g_hash_table_insert(entries, GUINT_TO_POINTER(id), entry);
+	}
+
+	if (g_strcmp0(entry->sender, sender) != 0)
+	{
+		g_free(entry->sender);
+		entry->sender = g_strdup(sender);
+	}
+
+	entry->urgency = urgency;
+}
+
+void pixmem_untrack_notification(guint id)
+{
+	if (entries != NULL)
+		g_hash_table_remove(entries, GUINT_TO_POINTER(id));
+}
+
+void pixmem_set_notification_icon(guint id, gsize bytes)
+{
+	PixmemEntry* entry = lookup_entry(id);
+
+	if (entry != NULL)
+		charge(&entry->icon_bytes, (gssize) bytes - (gssize) entry->icon_bytes);
+}
+
+void pixmem_set_reclaim_func(PixmemReclaimFunc func, gpointer user_data)
+{
+	reclaim_func = func;
+	reclaim_data = user_data;
+}
+
+guint pixmem_register_cache(const char* name, PixmemSizeFunc size, PixmemTrimFunc trim, gpointer user_data)
+{
+	PixmemCache* cache;
+
+	cache = g_new0(PixmemCache, 1);
+	cache->id = next_cache_id++;
+	cache->name = g_strdup(name);
+	cache->size = size;
+	cache->trim = trim;
+	cache->user_data = user_data;
+
+	caches = g_list_append(caches, cache);
+
+	return cache->id;
+}
+
+static PixmemCache* lookup_cache(guint cache_id)
+{
+	GList* l;
+
+	for (l = caches; l != NULL; l = l->next)
+	{
+		PixmemCache* cache = l->data;
+
+		if (cache->id == cache_id)
+			return cache;
+	}
+
+	return NULL;
+}
+
+void pixmem_unregister_cache(guint cache_id)
+{
+	PixmemCache* cache = lookup_cache(cache_id);
+
+	if (cache == NULL)
+		return;
+
+	caches = g_list_remove(caches, cache);
+	g_free(cache->name);
+	g_free(cache);
+}
+
+static gint compare_icon_bytes(PixmemEntry* a, PixmemEntry* b)
+{
+	if (a->icon_bytes == b->icon_bytes)
+		return 0;
+
+	return a->icon_bytes > b->icon_bytes ? -1 : 1;
+}
+
+/*
+ * Bring usage back under the budget. Caches go first since they can
+ * always be rebuilt, then low urgency icons are halved (largest first)
+ * and, as a last resort, removed. Normal and critical notifications are
+ * never touched.
+ */
+void pixmem_enforce(void)
+{
+	GList* candidates = NULL;
+	GList* l;
+	GHashTableIter iter;
+	PixmemEntry* entry;
+	gsize usage = get_usage();
+
+	if (enforcing || budget == 0 || usage <= budget)
+		return;
+
+	enforcing = TRUE;
+
+	/* trim callbacks must not unregister their cache */
+	for (l = caches; l != NULL && usage > budget; l = l->next)
+	{
+		PixmemCache* cache = l->data;
+		gsize released;
+
+		if (cache->size(cache->user_data) == 0)
+			continue;
+
+		released = cache->trim(usage - budget, cache->user_data);
+
+		if (released > 0)
+		{
+			n_cache_trims++;
+			usage = get_usage();
+		}
+	}
+
+	if (usage > budget && reclaim_func != NULL && entries != NULL)
+	{
+		g_hash_table_iter_init(&iter, entries);
+
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer*) &entry))
+		{
+			if (entry->urgency == URGENCY_LOW && entry->icon_bytes > 0)
+				candidates = g_list_prepend(candidates, GUINT_TO_POINTER(entry->id));
+		}
+
+		for (l = candidates; l != NULL; l = l->next)
+			l->data = lookup_entry(GPOINTER_TO_UINT(l->data));
+
+		candidates = g_list_sort(candidates, (GCompareFunc) compare_icon_bytes);
+
+		for (l = candidates; l != NULL && usage > budget; l = l->next)
+		{
+			entry = l->data;
+
+			if (entry->icon_bytes > SMALL_ICON_BYTES)
+			{
+				reclaim_func(entry->id, FALSE, reclaim_data);
+				n_downsampled++;
+				usage = get_usage();
+			}
+		}
+
+		for (l = candidates; l != NULL && usage > budget; l = l->next)
+		{
+			entry = l->data;
+
+			if (entry->icon_bytes > 0)
+			{
+				reclaim_func(entry->id, TRUE, reclaim_data);
+				n_dropped++;
+				usage = get_usage();
+			}
+		}
+
+		g_list_free(candidates);
+	}
+
+	enforcing = FALSE;
+}
+
+/* Empty every cache, used when the daemon goes idle */
+void pixmem_release_caches(void)
+{
+	GList* l;
+
+	/* Caches without image memory may still have something to give back */
+	for (l = caches; l != NULL; l = l->next)
+	{
+		PixmemCache* cache = l->data;
+
+		if (cache->trim(G_MAXSIZE, cache->user_data) > 0)
+			n_cache_trims++;
+	}
+}
+
+void pixmem_add_statistics(GHashTable* stats)
+{
+	GType map_type = dbus_g_type_get_map("GHashTable", G_TYPE_STRING, G_TYPE_UINT);
+	GHashTable* by_sender;
+	GHashTable* by_notification;
+	GHashTableIter iter;
+	PixmemEntry* entry;
+	gsize icon_bytes = 0;
+
+	by_sender = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	by_notification = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	if (entries != NULL)
+	{
+		g_hash_table_iter_init(&iter, entries);
+
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer*) &entry))
+		{
+			gsize bytes = entry->icon_bytes;
+			const char* sender = entry->sender != NULL ? entry->sender : "";
+
+			bytes += GPOINTER_TO_UINT(g_hash_table_lookup(by_sender, sender));
+			g_hash_table_replace(by_sender, g_strdup(sender), GUINT_TO_POINTER(MIN(bytes, G_MAXUINT)));
+
+			bytes = entry->icon_bytes;
+			g_hash_table_replace(by_notification, g_strdup_printf("%u", entry->id), GUINT_TO_POINTER(MIN(bytes, G_MAXUINT)));
+
+			icon_bytes += entry->icon_bytes;
+		}
+	}
+
+	notify_stats_set_uint64(stats, "pixmem-usage", get_usage());
+	notify_stats_set_uint64(stats, "pixmem-peak", peak);
+	notify_stats_set_uint64(stats, "pixmem-budget", budget);
+	notify_stats_set_uint64(stats, "pixmem-icon-bytes", icon_bytes);
+	notify_stats_set_uint64(stats, "pixmem-cache-bytes", get_cache_usage());
+	notify_stats_set_uint64(stats, "pixmem-cache-trims", n_cache_trims);
+	notify_stats_set_uint64(stats, "pixmem-icons-downsampled", n_downsampled);
+	notify_stats_set_uint64(stats, "pixmem-icons-dropped", n_dropped);
+	notify_stats_take_boxed(stats, "pixmem-by-sender", map_type, by_sender);
+	notify_stats_take_boxed(stats, "pixmem-by-notification", map_type, by_notification);
+}
@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _PIXMEM_H_
+#define _PIXMEM_H_
+
+#include <gtk/gtk.h>
+
+/*
+ * Process-wide accounting of image memory (pixbufs and cairo surfaces).
+ *
+ * Notification icons are charged to their notification id and sender,
+ * caches register themselves and report their own size. When the total
+ * goes over the budget, caches are trimmed first, then oversized icons of
+ * low urgency notifications are downsampled and finally dropped.
+ */
+
+/* Bytes a cache holds right now */
+typedef gsize (*PixmemSizeFunc) (gpointer user_data);
+
+/* Asked to release at least @excess bytes, returns the number released */
+typedef gsize (*PixmemTrimFunc) (gsize excess, gpointer user_data);
+
+/* Asked to shrink (or drop) the icon of notification @id */
+typedef void (*PixmemReclaimFunc) (guint id, gboolean drop, gpointer user_data);
+
+void pixmem_set_budget(gsize bytes);
+gsize pixmem_get_budget(void);
+gsize pixmem_get_usage(void);
+
+gsize pixmem_pixbuf_size(GdkPixbuf* pixbuf);
+
+void pixmem_track_notification(guint id, const char* sender, gint urgency);
+void pixmem_untrack_notification(guint id);
+void pixmem_set_notification_icon(guint id, gsize bytes);
+void pixmem_set_reclaim_func(PixmemReclaimFunc func, gpointer user_data);
+
+guint pixmem_register_cache(const char* name, PixmemSizeFunc size, PixmemTrimFunc trim, gpointer user_data);
+void pixmem_unregister_cache(guint cache_id);
+
+void pixmem_enforce(void);
+void pixmem_release_caches(void);
+void pixmem_add_statistics(GHashTable* stats);
+
+#endif /* _PIXMEM_H_ */
@@ -0,0 +1,166 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "profile.h"
+#include "stats.h"
+
+typedef struct {
+	const char* phase;
+	gint64      time;
+} ProfileMark;
+
+static GArray*  marks = NULL;
+static gint64   exec_time = 0;
+static gboolean verbose = FALSE;
+
+/* How long ago the kernel started this process, 0 if unknown */
+static gint64 get_process_age(void)
+{
+#if defined(__linux__) && defined(CLOCK_BOOTTIME)
+	gchar* contents = NULL;
+	gchar* p;
+	gchar** fields;
+	gint64 age = 0;
+	struct timespec now;
+
+	if (!g_file_get_contents("/proc/self/stat", &contents, NULL, NULL))
+		return 0;
+
+	/* skip "pid (comm) ", comm may contain spaces */
+	p = strrchr(contents, ')');
+
+	if (p != NULL && clock_gettime(CLOCK_BOOTTIME, &now) == 0)
+	{
+		fields = g_strsplit(p + 2, " ", 0);
+
+		/* starttime is field 22 of the whole line, 20 after comm */
+		if (g_strv_length(fields) > 19)
+		{
+			guint64 ticks = g_ascii_strtoull(fields[19], NULL, 10);
+			gint64 start = ticks * G_USEC_PER_SEC / sysconf(_SC_CLK_TCK);
+
+			age = (gint64) now.tv_sec * G_USEC_PER_SEC + now.tv_nsec / 1000 - start;
+		}
+
+		g_strfreev(fields);
+	}
+
+	g_free(contents);
+
+	return MAX(age, 0);
+#else
+	return 0;
+#endif
+}
+
+void profile_init(void)
+{
+	gint64 now = g_get_monotonic_time();
+
+	if (marks != NULL)
+		return;
+
+	marks = g_array_new(FALSE, FALSE, sizeof(ProfileMark));
+	exec_time = now - get_process_age();
+
+	profile_mark("main");
+}
+
+void profile_set_verbose(gboolean value)
+{
+	guint i;
+
+	verbose = value;
+
+	if (!verbose || marks == NULL)
+		return;
+
+	g_printerr("%-24s %10s %10s\n", "phase", "delta ms", "total ms");
+
+	for (i = 0; i < marks->len; i++)
+	{
+		ProfileMark* mark = &g_array_index(marks, ProfileMark, i);
+		gint64 previous = i > 0 ? g_array_index(marks, ProfileMark, i - 1).time : exec_time;
+
+		g_printerr("%-24s %10.2f %10.2f\n", mark->phase, (mark->time - previous) / 1000.0, (mark->time - exec_time) / 1000.0);
+	}
+}
+
+void profile_mark(const char* phase)
+{
+	ProfileMark mark;
+	gint64 previous;
+
+	if (marks == NULL || profile_get_elapsed(phase) >= 0)
+		return;
+
+	previous = marks->len > 0 ? g_array_index(marks, ProfileMark, marks->len - 1).time : exec_time;
+
+	mark.phase = phase;
+	mark.time = g_get_monotonic_time();
+	g_array_append_val(marks, mark);
+
+	if (verbose)
+	{
+		g_printerr("%-24s %10.2f %10.2f\n", phase, (mark.time - previous) / 1000.0, (mark.time - exec_time) / 1000.0);
+	}
+}
+
+gint64 profile_get_elapsed(const char* phase)
+{
+	guint i;
+
+	if (marks == NULL)
+		return -1;
+
+	for (i = 0; i < marks->len; i++)
+	{
+		ProfileMark* mark = &g_array_index(marks, ProfileMark, i);
+
+		if (strcmp(mark->phase, phase) == 0)
+			return mark->time - exec_time;
+	}
+
+	return -1;
+}
+
+void profile_add_statistics(GHashTable* stats)
+{
+	guint i;
+
+	if (marks == NULL)
+		return;
+
+	for (i = 0; i < marks->len; i++)
+	{
+		ProfileMark* mark = &g_array_index(marks, ProfileMark, i);
+		gchar* key = g_strdup_printf("startup-%s-usec", mark->phase);
+
+		notify_stats_set_uint64(stats, key, mark->time - exec_time);
+		g_free(key);
+	}
+}
@@ -0,0 +1,36 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <glib.h>
+
+/*
+ * Startup phase timestamps. Each phase is recorded once, relative to the
+ * time the process was exec'd, and printed as it happens when verbose.
+ */
+void profile_init(void);
+void profile_set_verbose(gboolean verbose);
+void profile_mark(const char* phase);
+gint64 profile_get_elapsed(const char* phase);
+void profile_add_statistics(GHashTable* stats);
+
+#endif /* _PROFILE_H_ */
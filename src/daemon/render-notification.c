@@ -0,0 +1,158 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/*
+ * Renders a notification with any engine into a PNG file, without
+ * showing it:
+ *
+ *   render-notification [-e ENGINE] [-w WIDTH] [-i ICON] [-a KEY:LABEL]...
+ *                       [-t TIMEOUT] -o FILE SUMMARY [BODY]
+ *
+ * ENGINE is a theme name or the path of an engine module.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "daemon.h"
+#include "engines.h"
+#include "render.h"
+
+static void action_invoked_cb(GtkWindow* nw, const char* key)
+{
+}
+
+int main(int argc, char** argv)
+{
+	const char* engine_name = "standard";
+	const char* icon_file = NULL;
+	const char* output = NULL;
+	int width = 300;
+	glong timeout = 0;
+	GArray* actions;
+	NotificationAction action;
+	NotificationContent content;
+	ThemeEngine* engine;
+	GdkPixbuf* icon = NULL;
+	cairo_surface_t* surface;
+	cairo_status_t status;
+	GError* error = NULL;
+	char* sep;
+	int i;
+
+	gtk_init(&argc, &argv);
+
+	actions = g_array_new(FALSE, FALSE, sizeof(NotificationAction));
+
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+	{
+		if (strcmp(argv[i], "-e") == 0)
+		{
+			engine_name = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-w") == 0)
+		{
+			width = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-i") == 0)
+		{
+			icon_file = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			timeout = atol(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			output = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-a") == 0 && (sep = strchr(argv[i + 1], ':')) != NULL)
+		{
+			*sep = '\0';
+			action.key = argv[i + 1];
+			action.label = sep + 1;
+			g_array_append_val(actions, action);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (output == NULL || i >= argc)
+	{
+		g_printerr("Usage: %s [-e ENGINE] [-w WIDTH] [-i ICON] [-a KEY:LABEL]... [-t TIMEOUT] -o FILE SUMMARY [BODY]\n", argv[0]);
+		return 1;
+	}
+
+	engine = theme_engine_open(engine_name);
+
+	if (engine == NULL)
+	{
+		g_printerr("Unable to load theme engine '%s'\n", engine_name);
+		return 1;
+	}
+
+	if (icon_file != NULL)
+	{
+		icon = gdk_pixbuf_new_from_file(icon_file, &error);
+
+		if (icon == NULL)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+	}
+
+	memset(&content, 0, sizeof(content));
+	content.summary = argv[i];
+	content.body = i + 1 < argc ? argv[i + 1] : "";
+	content.urgency = URGENCY_NORMAL;
+	content.actions = (NotificationAction*) actions->data;
+	content.n_actions = actions->len;
+	content.action_cb = G_CALLBACK(action_invoked_cb);
+	content.icon = icon;
+	content.timeout = timeout;
+	content.changed = NOTIFICATION_CONTENT_ALL;
+
+	surface = notify_render_notification(engine, &content, width);
+	status = cairo_surface_write_to_png(surface, output);
+
+	if (status != CAIRO_STATUS_SUCCESS)
+	{
+		g_printerr("%s: %s\n", output, cairo_status_to_string(status));
+	}
+
+	cairo_surface_destroy(surface);
+	theme_engine_close(engine);
+
+	if (icon != NULL)
+	{
+		g_object_unref(icon);
+	}
+
+	g_array_free(actions, TRUE);
+
+	return status == CAIRO_STATUS_SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "render.h"
+
+struct _NotifyRender {
+	GtkWindow* nw;
+	GtkWidget* host;
+	cairo_surface_t* surface;
+	int width;
+	gboolean needs_layout;
+};
+
+static void url_clicked_cb(GtkWindow* nw, const char* url)
+{
+	/* Nothing can be clicked offscreen */
+}
+
+/* What engines paint on their window goes under the contents */
+static gboolean on_host_draw(GtkWidget* host, cairo_t* cr, GtkWindow* nw)
+{
+	gboolean handled = FALSE;
+
+	g_signal_emit_by_name(nw, "draw", cr, &handled);
+
+	return FALSE;
+}
+
+NotifyRender* notify_render_new(ThemeEngine* engine)
+{
+	NotifyRender* render;
+	GtkWidget* child;
+
+	render = g_new0(NotifyRender, 1);
+	render->nw = theme_engine_create_notification(engine, url_clicked_cb);
+	render->needs_layout = TRUE;
+
+	render->host = gtk_offscreen_window_new();
+	gtk_widget_set_visual(render->host, gtk_widget_get_visual(GTK_WIDGET(render->nw)));
+	gtk_widget_set_app_paintable(render->host, TRUE);
+
+	child = gtk_bin_get_child(GTK_BIN(render->nw));
+
+	if (child != NULL)
+	{
+		g_object_ref(child);
+		gtk_container_remove(GTK_CONTAINER(render->nw), child);
+		gtk_container_add(GTK_CONTAINER(render->host), child);
+		g_object_unref(child);
+	}
+
+	g_signal_connect(render->host, "draw", G_CALLBACK(on_host_draw), render->nw);
+
+	/* Offscreen windows are mapped without appearing anywhere */
+	gtk_widget_show(render->host);
+
+	return render;
+}
+
+void notify_render_free(NotifyRender* render)
+{
+	if (render->surface != NULL)
+	{
+		cairo_surface_destroy(render->surface);
+	}
+
+	/* The contents go first, they may still use the engine's window data */
+	gtk_widget_destroy(render->host);
+	theme_destroy_notification(render->nw);
+	g_free(render);
+}
+
+GtkWindow* notify_render_get_window(NotifyRender* render)
+{
+	return render->nw;
+}
+
+void notify_render_set_content(NotifyRender* render, const NotificationContent* content)
+{
+	NotificationContent copy;
+
+	copy = *content;
+	copy.arrow_visible = FALSE;
+
+	theme_set_notification_content(render->nw, &copy);
+	render->needs_layout = TRUE;
+}
+
+void notify_render_layout(NotifyRender* render, int width, int* out_width, int* out_height)
+{
+	GtkRequisition req;
+	GtkAllocation allocation;
+	GdkEvent* event;
+	gboolean handled = FALSE;
+
+	gtk_widget_set_size_request(render->host, width, -1);
+	gtk_widget_get_preferred_size(render->host, &req, NULL);
+
+	allocation.x = 0;
+	allocation.y = 0;
+	allocation.width = req.width;
+	allocation.height = req.height;
+
+	gtk_widget_size_allocate(render->host, &allocation);
+
+	/* Engines size their background from their own window */
+	gtk_widget_get_preferred_size(GTK_WIDGET(render->nw), NULL, NULL);
+	gtk_widget_size_allocate(GTK_WIDGET(render->nw), &allocation);
+
+	/*
+	 * The window is never realized, so no configure event would tell
+	 * the engine that a reused render changed size.
+	 */
+	event = gdk_event_new(GDK_CONFIGURE);
+	event->configure.send_event = TRUE;
+	event->configure.width = req.width;
+	event->configure.height = req.height;
+
+	g_signal_emit_by_name(render->nw, "configure-event", event, &handled);
+
+	gdk_event_free(event);
+
+	if (render->surface != NULL && (cairo_image_surface_get_width(render->surface) != req.width || cairo_image_surface_get_height(render->surface) != req.height))
+	{
+		cairo_surface_destroy(render->surface);
+		render->surface = NULL;
+	}
+
+	render->width = width;
+	render->needs_layout = FALSE;
+
+	if (out_width != NULL)
+	{
+		*out_width = req.width;
+	}
+
+	if (out_height != NULL)
+	{
+		*out_height = req.height;
+	}
+}
+
+cairo_surface_t* notify_render_paint(NotifyRender* render)
+{
+	cairo_t* cr;
+
+	if (render->needs_layout)
+	{
+		notify_render_layout(render, render->width > 0 ? render->width : -1, NULL, NULL);
+	}
+
+	if (render->surface == NULL)
+	{
+		render->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+													 MAX(gtk_widget_get_allocated_width(render->host), 1),
+													 MAX(gtk_widget_get_allocated_height(render->host), 1));
+	}
+
+	cr = cairo_create(render->surface);
+
+	cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint(cr);
+	cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+	gtk_widget_draw(render->host, cr);
+
+	cairo_destroy(cr);
+	cairo_surface_flush(render->surface);
+
+	return render->surface;
+}
+
+cairo_surface_t* notify_render_notification(ThemeEngine* engine, const NotificationContent* content, int width)
+{
+	NotifyRender* render;
+	cairo_surface_t* surface;
+
+	render = notify_render_new(engine);
+	notify_render_set_content(render, content);
+	notify_render_layout(render, width, NULL, NULL);
+
+	surface = cairo_surface_reference(notify_render_paint(render));
+
+	notify_render_free(render);
+
+	return surface;
+}
@@ -0,0 +1,63 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_RENDER_H_
+#define _NOTIFY_RENDER_H_
+
+#include <gtk/gtk.h>
+
+#include "engines.h"
+
+/*
+ * A notification of any engine, laid out at a given width and painted
+ * into an image surface without anything showing up on screen. The
+ * engine's own window is never mapped; what it contains is moved into
+ * an offscreen toplevel, and what the engine paints on the window
+ * itself is forwarded there. GTK still needs a display, Xvfb will do.
+ *
+ * Arrows are not rendered, they depend on where the window would be.
+ */
+typedef struct _NotifyRender NotifyRender;
+
+NotifyRender* notify_render_new(ThemeEngine* engine);
+void notify_render_free(NotifyRender* render);
+
+/* The engine's window, e.g. for theme_notification_tick() */
+GtkWindow* notify_render_get_window(NotifyRender* render);
+
+void notify_render_set_content(NotifyRender* render, const NotificationContent* content);
+
+/*
+ * Lays the notification out at width, or wider if its content doesn't
+ * fit, and returns the size it got.
+ */
+void notify_render_layout(NotifyRender* render, int width, int* out_width, int* out_height);
+
+/*
+ * Paints the notification, laying it out again first if its content
+ * changed. The surface belongs to the render and is reused by the next
+ * paint at the same size.
+ */
+cairo_surface_t* notify_render_paint(NotifyRender* render);
+
+/* All of the above at once; returns a new surface */
+cairo_surface_t* notify_render_notification(ThemeEngine* engine, const NotificationContent* content, int width);
+
+#endif /* _NOTIFY_RENDER_H_ */
@@ -0,0 +1,539 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "sanitize.h"
+
+/* Deeper nesting than this is flattened; nobody needs it */
+#define MAX_OPEN_TAGS 16
+
+/* Room for the longest closing tag, "</a>" */
+#define CLOSE_TAG_BYTES 4
+
+#define ELLIPSIS "\342\200\246"
+
+typedef enum {
+	TAG_B,
+	TAG_I,
+	TAG_U,
+	TAG_A,
+	TAG_IMG,
+	TAG_OTHER
+} TagType;
+
+static const char* const tag_names[] = {
+	"b",
+	"i",
+	"u",
+	"a",
+	"img"
+};
+
+typedef struct {
+	GString* out;
+	gsize max_bytes;
+	guint max_lines;
+	guint n_lines;
+	gboolean full;
+	TagType open[MAX_OPEN_TAGS];
+	guint n_open;
+} Sanitizer;
+
+/* Whether len more bytes fit, keeping room to close the open tags */
+static gboolean has_room(Sanitizer* s, gsize len)
+{
+	if (s->full)
+	{
+		return FALSE;
+	}
+
+	if (s->max_bytes > 0 && s->out->len + len + (s->n_open + 1) * CLOSE_TAG_BYTES + strlen(ELLIPSIS) > s->max_bytes)
+	{
+		s->full = TRUE;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void append(Sanitizer* s, const char* text, gsize len)
+{
+	if (has_room(s, len))
+	{
+		g_string_append_len(s->out, text, len);
+	}
+}
+
+static gboolean is_name_char(char c)
+{
+	return g_ascii_isalnum(c) || c == '-' || c == '_' || c == ':';
+}
+
+/* Whether c is a Char of the XML 1.0 grammar */
+static gboolean is_xml_char(gunichar c)
+{
+	return c == 0x9 || c == 0xA || c == 0xD
+		|| (c >= 0x20 && c <= 0xD7FF)
+		|| (c >= 0xE000 && c <= 0xFFFD)
+		|| (c >= 0x10000 && c <= 0x10FFFF);
+}
+
+/* Length of a character or entity reference at p, or 0 if there is none */
+static gsize entity_length(const char* p)
+{
+	const char* q;
+
+	q = p + 1;
+
+	if (*q == '#')
+	{
+		gunichar c = 0;
+
+		q++;
+
+		/* Clamped past G_MAXUNICODE so that long references can't overflow */
+		if (*q == 'x' || *q == 'X')
+		{
+			q++;
+
+			while (g_ascii_isxdigit(*q))
+			{
+				c = MIN(c * 16 + g_ascii_xdigit_value(*q), G_MAXUNICODE + 1);
+				q++;
+			}
+		}
+		else
+		{
+			while (g_ascii_isdigit(*q))
+			{
+				c = MIN(c * 10 + g_ascii_digit_value(*q), G_MAXUNICODE + 1);
+				q++;
+			}
+		}
+
+		/* Something has to follow the "&#" or "&#x" */
+		if (!g_ascii_isxdigit(q[-1]) || *q != ';')
+		{
+			return 0;
+		}
+
+		/* Pango rejects the whole body for a reference to a non-character */
+		if (!g_unichar_validate(c) || !is_xml_char(c))
+		{
+			return 0;
+		}
+
+		return q - p + 1;
+	}
+
+	if (strncmp(q, "amp;", 4) == 0 || strncmp(q, "quot;", 5) == 0 || strncmp(q, "apos;", 5) == 0)
+	{
+		return strchr(q, ';') - p + 1;
+	}
+
+	if (strncmp(q, "lt;", 3) == 0 || strncmp(q, "gt;", 3) == 0)
+	{
+		return 4;
+	}
+
+	return 0;
+}
+
+/* Whether text other than whitespace follows p, tags aside */
+static gboolean has_text(const char* p)
+{
+	while (*p != '\0')
+	{
+		if (*p == '<' && strchr(p, '>') != NULL)
+		{
+			p = strchr(p, '>') + 1;
+		}
+		else if (g_ascii_isspace(*p))
+		{
+			p++;
+		}
+		else
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*
+ * Copies text up to end, escaping what markup would read as syntax but
+ * keeping well-formed entities. Stops at the last whole character that
+ * fits the budget.
+ */
+static void append_escaped(Sanitizer* s, const char* p, const char* end)
+{
+	const char* next;
+	gsize len;
+
+	while (p < end && !s->full)
+	{
+		switch (*p)
+		{
+			case '&':
+				len = entity_length(p);
+
+				if (len > 0 && p + len <= end)
+				{
+					append(s, p, len);
+					p += len;
+				}
+				else
+				{
+					append(s, "&amp;", 5);
+					p++;
+				}
+				break;
+
+			case '<':
+				append(s, "&lt;", 4);
+				p++;
+				break;
+
+			case '>':
+				append(s, "&gt;", 4);
+				p++;
+				break;
+
+			case '"':
+				append(s, "&quot;", 6);
+				p++;
+				break;
+
+			case '\n':
+				/* Trailing newlines don't make a body too long */
+				if (s->max_lines > 0 && ++s->n_lines == s->max_lines && has_text(p + 1))
+				{
+					s->full = TRUE;
+					break;
+				}
+
+				append(s, p, 1);
+				p++;
+				break;
+
+			default:
+				/* Plain bytes go through a whole character at a time */
+				next = g_utf8_next_char(p);
+
+				if (next > end)
+				{
+					next = end;
+				}
+
+				append(s, p, next - p);
+				p = next;
+				break;
+		}
+	}
+}
+
+static TagType lookup_tag(const char* name, gsize len)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(tag_names); i++)
+	{
+		if (strlen(tag_names[i]) == len && g_ascii_strncasecmp(name, tag_names[i], len) == 0)
+		{
+			return (TagType) i;
+		}
+	}
+
+	return TAG_OTHER;
+}
+
+/*
+ * Looks for attribute wanted in the attribute list of a tag, which runs
+ * from p to end (the closing '>'). Returns FALSE if the list is malformed.
+ */
+static gboolean find_attribute(const char* p, const char* end, const char* wanted, const char** value, const char** value_end)
+{
+	const char* name;
+	const char* value_start;
+	gsize name_len;
+	char quote;
+
+	*value = NULL;
+
+	while (p < end)
+	{
+		while (p < end && g_ascii_isspace(*p))
+		{
+			p++;
+		}
+
+		if (p >= end || *p == '/')
+		{
+			break;
+		}
+
+		name = p;
+
+		while (p < end && is_name_char(*p))
+		{
+			p++;
+		}
+
+		name_len = p - name;
+
+		if (name_len == 0)
+		{
+			return FALSE;
+		}
+
+		while (p < end && g_ascii_isspace(*p))
+		{
+			p++;
+		}
+
+		if (p >= end || *p != '=')
+		{
+			return FALSE;
+		}
+
+		p++;
+
+		while (p < end && g_ascii_isspace(*p))
+		{
+			p++;
+		}
+
+		if (p >= end || (*p != '"' && *p != '\''))
+		{
+			return FALSE;
+		}
+
+		quote = *p++;
+		value_start = p;
+
+		while (p < end && *p != quote)
+		{
+			p++;
+		}
+
+		if (p >= end)
+		{
+			return FALSE;
+		}
+
+		if (strlen(wanted) == name_len && g_ascii_strncasecmp(name, wanted, name_len) == 0)
+		{
+			*value = value_start;
+			*value_end = p;
+		}
+
+		p++;
+	}
+
+	return TRUE;
+}
+
+static void open_tag(Sanitizer* s, TagType type, const char* attrs, const char* end)
+{
+	const char* value;
+	const char* value_end;
+	gsize start;
+
+	if (type == TAG_IMG)
+	{
+		/* Labels can't show images, so show what the image is about */
+		if (find_attribute(attrs, end, "alt", &value, &value_end) && value != NULL)
+		{
+			append_escaped(s, value, value_end);
+		}
+
+		return;
+	}
+
+	if (s->n_open == MAX_OPEN_TAGS || !has_room(s, strlen("<a href=\"\">")))
+	{
+		return;
+	}
+
+	if (type == TAG_A)
+	{
+		/* A link without a target is only text */
+		if (!find_attribute(attrs, end, "href", &value, &value_end) || value == NULL)
+		{
+			return;
+		}
+
+		start = s->out->len;
+
+		append(s, "<a href=\"", 9);
+		append_escaped(s, value, value_end);
+
+		if (s->full)
+		{
+			/* Don't leave half a tag behind */
+			g_string_truncate(s->out, start);
+			return;
+		}
+
+		g_string_append(s->out, "\">");
+	}
+	else
+	{
+		g_string_append_printf(s->out, "<%s>", tag_names[type]);
+	}
+
+	s->open[s->n_open++] = type;
+}
+
+static void close_tag(Sanitizer* s, TagType type)
+{
+	/* Only the innermost open tag can be closed; stray ends are dropped */
+	if (s->n_open == 0 || s->open[s->n_open - 1] != type)
+	{
+		return;
+	}
+
+	s->n_open--;
+	g_string_append_printf(s->out, "</%s>", tag_names[type]);
+}
+
+/*
+ * Handles the tag starting at p, returning where parsing continues, or
+ * NULL if it isn't a whitelisted, well-formed tag.
+ */
+static const char* handle_tag(Sanitizer* s, const char* p)
+{
+	const char* name;
+	const char* end;
+	gboolean closing = FALSE;
+	TagType type;
+
+	p++;
+
+	if (*p == '/')
+	{
+		closing = TRUE;
+		p++;
+	}
+
+	name = p;
+
+	while (g_ascii_isalpha(*p))
+	{
+		p++;
+	}
+
+	type = lookup_tag(name, p - name);
+
+	if (type == TAG_OTHER || (*p != '>' && *p != '/' && !g_ascii_isspace(*p)))
+	{
+		return NULL;
+	}
+
+	/* Attribute values can't contain a raw '<', so neither can the tag */
+	end = p + strcspn(p, "<>");
+
+	if (*end != '>')
+	{
+		return NULL;
+	}
+
+	if (closing)
+	{
+		close_tag(s, type);
+	}
+	else
+	{
+		open_tag(s, type, p, end);
+
+		/* Self-closing form, as in <b/> */
+		if (end > p && end[-1] == '/' && type != TAG_IMG)
+		{
+			close_tag(s, type);
+		}
+	}
+
+	return end + 1;
+}
+
+char* notify_sanitize_markup(const char* body, gsize max_bytes, guint max_lines, gboolean* truncated)
+{
+	Sanitizer s;
+	const char* p;
+	const char* next;
+	gsize len;
+
+	if (body == NULL)
+	{
+		body = "";
+	}
+
+	len = strlen(body);
+
+	s.out = g_string_sized_new(max_bytes > 0 ? MIN(len, max_bytes) + 1 : len + 1);
+	s.max_bytes = max_bytes;
+	s.max_lines = max_lines;
+	s.n_lines = 0;
+	s.full = FALSE;
+	s.n_open = 0;
+
+	p = body;
+
+	while (*p != '\0' && !s.full)
+	{
+		if (*p == '<' && (next = handle_tag(&s, p)) != NULL)
+		{
+			p = next;
+			continue;
+		}
+
+		/* Everything up to the next tag is text */
+		next = strchr(p + 1, '<');
+
+		if (next == NULL)
+		{
+			next = body + len;
+		}
+
+		append_escaped(&s, p, next);
+		p = next;
+	}
+
+	if (s.full)
+	{
+		g_string_append(s.out, ELLIPSIS);
+	}
+
+	while (s.n_open > 0)
+	{
+		close_tag(&s, s.open[s.n_open - 1]);
+	}
+
+	if (truncated != NULL)
+	{
+		*truncated = s.full;
+	}
+
+	return g_string_free(s.out, FALSE);
+}
@@ -0,0 +1,40 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_SANITIZE_H_
+#define _NOTIFY_SANITIZE_H_
+
+#include <glib.h>
+
+/*
+ * Rewrites a notification body into markup every engine can show: the
+ * tags of the notification spec's whitelist (b, i, u, a and img) are
+ * kept, properly nested, and everything else is escaped to plain text.
+ * An img is replaced by its alt text. The result is cut off at a UTF-8
+ * character boundary to stay within max_bytes, including the tags that
+ * have to be closed at the end, and after max_lines lines. A limit of 0
+ * means no limit.
+ *
+ * The body is read in a single pass that stops at the limits; *truncated,
+ * if given, is set when it did not fit.
+ */
+char* notify_sanitize_markup(const char* body, gsize max_bytes, guint max_lines, gboolean* truncated);
+
+#endif /* _NOTIFY_SANITIZE_H_ */
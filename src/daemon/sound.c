@@ -26,6 +26,13 @@
 #include <glib/gi18n.h>
 #include <canberra-gtk.h>
 
+/* Opens the sound backend ahead of the first event */
+void
+sound_init (void)
+{
+        ca_context_open (ca_gtk_context_get ());
+}
+
 void
 sound_play_file (GtkWidget *widget,
                  const char *filename)
@@ -24,6 +24,7 @@
 
 #include <gtk/gtk.h>
 
+void sound_init(void);
 void sound_play_file(GtkWidget* widget, const char* filename);
 
 #endif /* _SOUND_H */
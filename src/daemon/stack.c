@@ -412,6 +412,35 @@ void notify_stack_add_window(NotifyStack* stack, GtkWindow* nw, gboolean new_not
 	}
 }
 
+/*
+ * Put nw in the slot of old_nw, at its position. Returns FALSE if old_nw
+ * isn't in this stack.
+ */
+gboolean notify_stack_replace_window(NotifyStack* stack, GtkWindow* old_nw, GtkWindow* nw)
+{
+	GList* l;
+	gint x, y;
+
+	l = g_list_find(stack->windows, old_nw);
+
+	if (l == NULL)
+	{
+		return FALSE;
+	}
+
+	g_signal_handlers_disconnect_by_func(G_OBJECT(old_nw), notify_stack_remove_window, stack);
+	g_signal_connect_swapped(G_OBJECT(nw), "destroy", G_CALLBACK(notify_stack_remove_window), stack);
+	l->data = nw;
+
+	gtk_window_get_position(old_nw, &x, &y);
+	theme_move_notification(nw, x, y);
+
+	/* The new window may not have the same size */
+	notify_stack_queue_update_position(stack);
+
+	return TRUE;
+}
+
 void notify_stack_remove_window(NotifyStack* stack, GtkWindow* nw)
 {
 	GList* remove_l = NULL;
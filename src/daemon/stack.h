@@ -48,6 +48,7 @@ void notify_stack_destroy(NotifyStack* stack);
 void notify_stack_set_location(NotifyStack* stack, NotifyStackLocation location);
 void notify_stack_add_window(NotifyStack* stack, GtkWindow* nw, gboolean new_notification);
 void notify_stack_remove_window(NotifyStack* stack, GtkWindow* nw);
+gboolean notify_stack_replace_window(NotifyStack* stack, GtkWindow* old_nw, GtkWindow* nw);
 GList* notify_stack_get_windows(NotifyStack* stack);
 void notify_stack_queue_update_position(NotifyStack* stack);
 
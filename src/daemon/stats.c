@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "stats.h"
+
+static void free_stats_value(GValue* value)
+{
+	g_value_unset(value);
+	g_free(value);
+}
+
+GHashTable* notify_stats_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) free_stats_value);
+}
+
+void notify_stats_set_uint64(GHashTable* stats, const char* key, guint64 value)
+{
+	GValue* v = g_new0(GValue, 1);
+
+	g_value_init(v, G_TYPE_UINT64);
+	g_value_set_uint64(v, value);
+	g_hash_table_replace(stats, g_strdup(key), v);
+}
+
+void notify_stats_set_double(GHashTable* stats, const char* key, gdouble value)
+{
+	GValue* v = g_new0(GValue, 1);
+
+	g_value_init(v, G_TYPE_DOUBLE);
+	g_value_set_double(v, value);
+	g_hash_table_replace(stats, g_strdup(key), v);
+}
+
+void notify_stats_take_boxed(GHashTable* stats, const char* key, GType type, gpointer boxed)
+{
+	GValue* v = g_new0(GValue, 1);
+
+	g_value_init(v, type);
+	g_value_take_boxed(v, boxed);
+	g_hash_table_replace(stats, g_strdup(key), v);
+}
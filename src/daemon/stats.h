@@ -0,0 +1,37 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <glib.h>
+#include <glib-object.h>
+
+/*
+ * Helpers to fill the a{sv} dictionary returned by the
+ * org.mate.NotificationDaemon.GetStatistics method. Keys are copied,
+ * values are owned by the table.
+ */
+GHashTable* notify_stats_new(void);
+void notify_stats_set_uint64(GHashTable* stats, const char* key, guint64 value);
+void notify_stats_set_double(GHashTable* stats, const char* key, gdouble value);
+void notify_stats_take_boxed(GHashTable* stats, const char* key, GType type, gpointer boxed);
+
+#endif /* _STATS_H_ */
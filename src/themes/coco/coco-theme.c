@@ -27,6 +27,15 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
+#include "notify-engine.h"
+#include "actions.h"
+#include "cachemem.h"
+#include "markup.h"
+#include "pie.h"
+#include "repaint.h"
+#include "shape.h"
+#include "update.h"
+
 /* Define basic coco types */
 typedef void (*ActionInvokedCb)(GtkWindow *nw, const char *key);
 typedef void (*UrlClickedCb)(GtkWindow *nw, const char *url);
@@ -42,6 +51,7 @@ typedef struct
 	GtkWidget *summary_label;
 	GtkWidget *body_label;
 	GtkWidget *actions_box;
+	NotifyActionPool *actions;
 	GtkWidget *last_sep;
 	GtkWidget *stripe_spacer;
 	GtkWidget *pie_countdown;
@@ -51,8 +61,15 @@ typedef struct
 
 	int width;
 	int height;
-	int last_width;
-	int last_height;
+	NotifyShapeCache shape;
+
+	cairo_surface_t *background;
+	int background_width;
+	int background_height;
+	NotifyPieAtlas pie_atlas;
+	NotifyMarkup *body;
+	int pie_x;
+	int pie_y;
 
 	guchar urgency;
 	glong timeout;
@@ -71,22 +88,22 @@ enum
 	URGENCY_CRITICAL
 };
 
-gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
+NOTIFY_ENGINE_SYMBOL gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
 			  unsigned int micro_ver);
-void get_theme_info(char **theme_name, char **theme_ver, char **author,
+NOTIFY_ENGINE_SYMBOL void get_theme_info(char **theme_name, char **theme_ver, char **author,
 		    char **homepage);
-GtkWindow* create_notification(UrlClickedCb url_clicked);
-void set_notification_text(GtkWindow *nw, const char *summary,
+NOTIFY_ENGINE_SYMBOL GtkWindow* create_notification(UrlClickedCb url_clicked);
+NOTIFY_ENGINE_SYMBOL void set_notification_text(GtkWindow *nw, const char *summary,
 			   const char *body);
-void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
-void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
-void add_notification_action(GtkWindow *nw, const char *text, const char *key,
+NOTIFY_ENGINE_SYMBOL void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
+NOTIFY_ENGINE_SYMBOL void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
+NOTIFY_ENGINE_SYMBOL void add_notification_action(GtkWindow *nw, const char *text, const char *key,
 			     ActionInvokedCb cb);
-void clear_notification_actions(GtkWindow *nw);
-void move_notification(GtkWidget *nw, int x, int y);
-void set_notification_timeout(GtkWindow *nw, glong timeout);
-void set_notification_hints(GtkWindow *nw, GHashTable *hints);
-void notification_tick(GtkWindow *nw, glong remaining);
+NOTIFY_ENGINE_SYMBOL void clear_notification_actions(GtkWindow *nw);
+NOTIFY_ENGINE_SYMBOL void move_notification(GtkWidget *nw, int x, int y);
+NOTIFY_ENGINE_SYMBOL void set_notification_timeout(GtkWindow *nw, glong timeout);
+NOTIFY_ENGINE_SYMBOL void set_notification_hints(GtkWindow *nw, GHashTable *hints);
+NOTIFY_ENGINE_SYMBOL void notification_tick(GtkWindow *nw, glong remaining);
 
 #define STRIPE_WIDTH  32
 #define WIDTH         300
@@ -114,9 +131,26 @@ activate_link (GtkLabel *label, const char *url, WindowData *windata)
 	return TRUE;
 }
 
+static void
+invalidate_background(WindowData *windata)
+{
+	if (windata->background != NULL)
+	{
+		cairo_surface_destroy(windata->background);
+		windata->background = NULL;
+	}
+
+	/* The pie cells are drawn over the same background */
+	notify_pie_atlas_clear(&windata->pie_atlas);
+}
+
 static void
 destroy_windata(WindowData *windata)
 {
+	notify_cache_remove((NotifyCacheReleaseFunc) invalidate_background, windata);
+	invalidate_background(windata);
+	notify_markup_unref(windata->body);
+	notify_action_pool_free(windata->actions);
 	g_free(windata);
 }
 
@@ -134,26 +168,77 @@ nodoka_rounded_rectangle (cairo_t * cr,
 	cairo_arc (cr, x + radius, y + radius, radius, G_PI, G_PI * 1.5);
 }
 
-/* Fill background */
+/*
+ * The background gradient is shared by every notification on a screen.
+ * It is built for a height of 1 and scaled to the window when used, so
+ * it only depends on whether the screen is composited.
+ */
+typedef struct
+{
+	GdkScreen *screen;
+	gboolean valid;
+	gboolean composited;
+	cairo_pattern_t *background;
+} StyleCache;
+
+static StyleCache style_cache;
+
 static void
-fill_background(GtkWidget *widget, WindowData *windata, cairo_t *cr)
+clear_style_cache(void)
+{
+	if (!style_cache.valid)
+		return;
+
+	cairo_pattern_destroy (style_cache.background);
+	style_cache.valid = FALSE;
+}
+
+static const StyleCache *
+get_style_cache(WindowData *windata)
 {
+	GdkScreen *screen;
 	float alpha;
+
+	screen = gtk_widget_get_screen (windata->win);
+
+	if (style_cache.valid &&
+	    style_cache.screen == screen &&
+	    style_cache.composited == windata->composited)
+		return &style_cache;
+
+	clear_style_cache ();
+
 	if (windata->composited)
 		alpha = BACKGROUND_OPACITY;
 	else
 		alpha = 1.0;
 
-	cairo_pattern_t *pattern;
-	pattern = cairo_pattern_create_linear (0, 0, 0, windata->height);
-	cairo_pattern_add_color_stop_rgba (pattern, 0, 
+	style_cache.background = cairo_pattern_create_linear (0, 0, 0, 1);
+	cairo_pattern_add_color_stop_rgba (style_cache.background, 0, 
         19/255.0, 19/255.0, 19/255.0, alpha);
-	cairo_pattern_add_color_stop_rgba (pattern, GRADIENT_CENTER, 
+	cairo_pattern_add_color_stop_rgba (style_cache.background, GRADIENT_CENTER, 
         19/255.0, 19/255.0, 19/255.0, alpha);
-	cairo_pattern_add_color_stop_rgba (pattern, 1, 
+	cairo_pattern_add_color_stop_rgba (style_cache.background, 1, 
         19/255.0, 19/255.0, 19/255.0, alpha);
-	cairo_set_source (cr, pattern);
-	cairo_pattern_destroy (pattern);
+
+	style_cache.screen = screen;
+	style_cache.composited = windata->composited;
+	style_cache.valid = TRUE;
+
+	return &style_cache;
+}
+
+/* Fill background */
+static void
+fill_background(GtkWidget *widget, WindowData *windata, cairo_t *cr)
+{
+	cairo_matrix_t matrix;
+
+	/* Stretch the shared gradient over the window */
+	cairo_get_matrix (cr, &matrix);
+	cairo_scale (cr, 1, MAX (windata->height, 1));
+	cairo_set_source (cr, get_style_cache (windata)->background);
+	cairo_set_matrix (cr, &matrix);
 	
     nodoka_rounded_rectangle (cr, 0, 8, windata->width-8,
         windata->height-8, 6);
@@ -162,12 +247,12 @@ fill_background(GtkWidget *widget, WindowData *windata, cairo_t *cr)
 }
 
 static void
-draw_pie(GtkWidget *pie, WindowData *windata, cairo_t *cr)
+draw_pie(GtkWidget *pie, WindowData *windata, cairo_t *cr, gdouble fraction)
 {
-	if (windata->timeout == 0)
+	if (fraction < 0)
 		return;
 
-	gdouble arc_angle = 1.0 - (gdouble)windata->remaining / (gdouble)windata->timeout;
+	gdouble arc_angle = 1.0 - fraction;
 	cairo_set_source_rgba (cr, 1.0, 0.4, 0.0, 0.3);
 	cairo_move_to(cr, PIE_RADIUS, PIE_RADIUS);
 	cairo_arc_negative(cr, PIE_RADIUS, PIE_RADIUS, PIE_RADIUS,
@@ -178,36 +263,29 @@ draw_pie(GtkWidget *pie, WindowData *windata, cairo_t *cr)
 }
 
 static void
-update_shape_region (cairo_surface_t *surface,
-		     WindowData      *windata)
+update_shape_region (WindowData *windata)
 {
-	if (windata->width == windata->last_width && windata->height == windata->last_height)
+	NotifyShape shape;
+
+	if (windata->composited)
 	{
+		notify_shape_apply (windata->win, &windata->shape, NULL);
 		return;
 	}
 
 	if (windata->width == 0 || windata->height == 0)
 	{
-		GtkAllocation allocation;
-		gtk_widget_get_allocation (windata->win, &allocation);
-
-		windata->width = MAX (allocation.width, 1);
-		windata->height = MAX (allocation.height, 1);
-	}
-
-	if (!windata->composited) {
-		cairo_region_t *region;
-
-		region = gdk_cairo_region_create_from_surface (surface);
-		gtk_widget_shape_combine_region (windata->win, region);
-		cairo_region_destroy (region);
-	} else {
-		gtk_widget_shape_combine_region (windata->win, NULL);
 		return;
 	}
 
-	windata->last_width = windata->width;
-	windata->last_height = windata->height;
+	shape.body.x = 0;
+	shape.body.width = windata->width;
+	shape.body.y = 0;
+	shape.body.height = windata->height;
+	shape.radius = 6;
+	shape.has_arrow = FALSE;
+
+	notify_shape_apply (windata->win, &windata->shape, &shape);
 }
 
 static void
@@ -215,9 +293,10 @@ paint_window (GtkWidget  *widget,
 	      cairo_t    *cr,
 	      WindowData *windata)
 {
-	cairo_surface_t *surface;
 	cairo_t *cr2;
 
+	notify_repaint_count_paint ();
+
 	if (windata->width == 0 || windata->height == 0) {
 		GtkAllocation allocation;
 
@@ -226,33 +305,39 @@ paint_window (GtkWidget  *widget,
 		windata->height = allocation.height;
 	}
 
-	surface = cairo_surface_create_similar(cairo_get_target(cr),
-					       CAIRO_CONTENT_COLOR_ALPHA,
-					       windata->width,
-					       windata->height);
+	/* The background only depends on the size and on compositing, so
+	 * it is rendered once and blitted on every following draw. */
+	if (windata->background == NULL ||
+	    windata->background_width != windata->width ||
+	    windata->background_height != windata->height)
+	{
+		invalidate_background(windata);
 
-	cr2 = cairo_create (surface);
+		windata->background = notify_cache_surface_new(cr, windata->width, windata->height);
+		windata->background_width = windata->width;
+		windata->background_height = windata->height;
 
-	/* transparent background */
-	cairo_rectangle (cr2, 0, 0, windata->width, windata->height);
-	cairo_set_source_rgba (cr2, 0.0, 0.0, 0.0, 0.0);
-	cairo_fill (cr2);
+		cr2 = cairo_create (windata->background);
 
-	nodoka_rounded_rectangle (cr2, 0, 0, windata->width , windata->height, 6);
-	fill_background(widget, windata, cr2);
-	cairo_fill (cr2);
+		/* transparent background */
+		cairo_rectangle (cr2, 0, 0, windata->width, windata->height);
+		cairo_set_source_rgba (cr2, 0.0, 0.0, 0.0, 0.0);
+		cairo_fill (cr2);
 
-	cairo_destroy (cr2);
+		nodoka_rounded_rectangle (cr2, 0, 0, windata->width , windata->height, 6);
+		fill_background(widget, windata, cr2);
+		cairo_fill (cr2);
+
+		cairo_destroy (cr2);
+
+		update_shape_region (windata);
+	}
 
 	cairo_save (cr);
 	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-	cairo_set_source_surface (cr, surface, 0, 0);
+	cairo_set_source_surface (cr, windata->background, 0, 0);
 	cairo_paint (cr);
 	cairo_restore (cr);
-
-	update_shape_region (surface, windata);
-
-	cairo_surface_destroy (surface);
 }
 
 static gboolean
@@ -269,76 +354,62 @@ configure_event_cb(GtkWidget *nw,
 				   GdkEventConfigure *event,
 				   WindowData *windata)
 {
-	windata->width = event->width;
-	windata->height = event->height;
-
-	gtk_widget_queue_draw(nw);
+	/* Moves, like those of stack shifts, leave everything drawn valid */
+	if (notify_repaint_configure(&windata->width, &windata->height, event))
+		notify_repaint_queue(nw, NULL);
 
 	return FALSE;
 }
 
+static void
+draw_countdown_frame(cairo_t *cr,
+					 gdouble fraction,
+					 WindowData *windata)
+{
+	GtkAllocation alloc;
+
+	gtk_widget_get_allocation (windata->pie_countdown, &alloc);
+
+	cairo_translate (cr, -alloc.x, -alloc.y);
+	fill_background (windata->pie_countdown, windata, cr);
+	cairo_translate (cr, alloc.x, alloc.y);
+	draw_pie (windata->pie_countdown, windata, cr, fraction);
+	cairo_fill (cr);
+}
+
 static gboolean
 countdown_expose_cb(GtkWidget *pie,
 					cairo_t *cr,
 					WindowData *windata)
 {
-	cairo_t *cr2;
-	cairo_surface_t *surface;
 	GtkAllocation alloc;
 
 	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 
 	gtk_widget_get_allocation (pie, &alloc);
 
-	surface = cairo_surface_create_similar (cairo_get_target (cr),
-						CAIRO_CONTENT_COLOR_ALPHA,
-						alloc.width,
-						alloc.height);
-
-	cr2 = cairo_create (surface);
-
-	cairo_translate (cr2, -alloc.x, -alloc.y);
-	fill_background (pie, windata, cr2);
-	cairo_translate (cr2, alloc.x, alloc.y);
-	draw_pie (pie, windata, cr2);
-	cairo_fill (cr2);
-
-	cairo_destroy (cr2);
+	/* The cells show the window background behind the pie */
+	if (alloc.x != windata->pie_x || alloc.y != windata->pie_y)
+	{
+		notify_pie_atlas_clear (&windata->pie_atlas);
+		windata->pie_x = alloc.x;
+		windata->pie_y = alloc.y;
+	}
 
-	cairo_save (cr);
-	cairo_set_source_surface (cr, surface, 0, 0);
-	cairo_paint (cr);
-	cairo_restore (cr);
+	notify_pie_atlas_paint (&windata->pie_atlas, cr, alloc.width, alloc.height,
+							notify_pie_get_frame (windata->remaining, windata->timeout),
+							(NotifyPieDrawFunc) draw_countdown_frame, windata);
 
-	cairo_surface_destroy (surface);
 	return TRUE;
 }
 
-static gboolean on_configure_event (GtkWidget* widget, GdkEventConfigure* event, WindowData* windata)
-{
-	windata->width = event->width;
-	windata->height = event->height;
-
-	gtk_widget_queue_draw (widget);
-
-	return FALSE;
-}
-
 static void on_composited_changed (GtkWidget* window, WindowData* windata)
 {
-	windata->composited = gdk_screen_is_composited (gtk_widget_get_screen(window));
-
-	gtk_widget_queue_draw (window);
-}
+	windata->composited = notify_screen_is_composited (gtk_widget_get_screen(window));
 
-static void
-action_clicked_cb(GtkWidget *w, GdkEventButton *event,
-				  ActionInvokedCb action_cb)
-{
-	GtkWindow *nw   = g_object_get_data(G_OBJECT(w), "_nw");
-	const char *key = g_object_get_data(G_OBJECT(w), "_action_key");
+	invalidate_background (windata);
 
-	action_cb(nw, key);
+	gtk_widget_queue_draw (window);
 }
 
 
@@ -396,7 +467,7 @@ create_notification(UrlClickedCb url_clicked)
 	if (visual != NULL)
 	{
 		gtk_widget_set_visual(win, visual);
-		if (gdk_screen_is_composited(screen))
+		if (notify_screen_is_composited(screen))
 			windata->composited = TRUE;
 	}
 
@@ -407,6 +478,7 @@ create_notification(UrlClickedCb url_clicked)
 
 	g_object_set_data_full(G_OBJECT(win), "windata", windata,
 						   (GDestroyNotify)destroy_windata);
+	notify_cache_add((NotifyCacheReleaseFunc) invalidate_background, windata);
 	atk_object_set_role(gtk_widget_get_accessible(win), ATK_ROLE_ALERT);
 
 	g_signal_connect(G_OBJECT(win), "configure_event",
@@ -419,8 +491,6 @@ create_notification(UrlClickedCb url_clicked)
 	g_signal_connect (G_OBJECT (main_vbox), "draw",
 					 G_CALLBACK (on_draw), windata);
 
-	g_signal_connect (G_OBJECT (win), "configure-event", G_CALLBACK (on_configure_event), windata);
-
 	g_signal_connect (G_OBJECT (win), "composited-changed", G_CALLBACK (on_composited_changed), windata);
 
 	windata->main_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
@@ -488,45 +558,81 @@ create_notification(UrlClickedCb url_clicked)
 	gtk_widget_show(windata->actions_box);
 	gtk_box_pack_start(GTK_BOX(vbox), windata->actions_box, FALSE, TRUE, 0);
 
+	windata->actions = notify_action_pool_new(windata->actions_box, GTK_RELIEF_NORMAL);
+
 	return GTK_WINDOW(win);
 }
 
+/* Shared by all windows; the summary is plain text, the body markup */
+static PangoAttrList *summary_attrs = NULL;
+static NotifyMarkupCache *body_cache = NULL;
+
+static void
+init_text_attributes(void)
+{
+	PangoAttrList *body_attrs;
+
+	if (body_cache != NULL)
+		return;
+
+	summary_attrs = pango_attr_list_new ();
+	pango_attr_list_insert (summary_attrs, pango_attr_foreground_new (0xffff, 0xffff, 0xffff));
+	pango_attr_list_insert (summary_attrs, pango_attr_weight_new (PANGO_WEIGHT_BOLD));
+	pango_attr_list_insert (summary_attrs, pango_attr_scale_new (PANGO_SCALE_LARGE));
+
+	body_attrs = pango_attr_list_new ();
+	pango_attr_list_insert (body_attrs, pango_attr_foreground_new (0xeaea, 0xeaea, 0xeaea));
+	body_cache = notify_markup_cache_new (body_attrs);
+	pango_attr_list_unref (body_attrs);
+}
+
+/* Size the icon box and the text for what the window shows */
+static void
+update_size(GtkWindow *nw)
+{
+	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
+	GdkPixbuf *pixbuf;
+	g_assert(windata != NULL);
+
+	pixbuf = gtk_image_get_pixbuf(GTK_IMAGE(windata->icon));
+
+	if (pixbuf != NULL)
+		gtk_widget_set_size_request(windata->iconbox,
+									MAX(BODY_X_OFFSET, gdk_pixbuf_get_width(pixbuf)), -1);
+	else
+		gtk_widget_set_size_request(windata->iconbox, BODY_X_OFFSET, -1);
+
+	gtk_widget_set_size_request(
+		(gtk_widget_get_visible(windata->body_label)
+		 ? windata->body_label : windata->summary_label),
+		WIDTH - (IMAGE_SIZE + IMAGE_PADDING) - 10,
+		-1);
+}
+
 /* Set the notification text */
 void
 set_notification_text(GtkWindow *nw, const char *summary, const char *body)
 {
-	char *str;
-	char* quoted;
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
 	g_assert(windata != NULL);
 
-	quoted = g_markup_escape_text(summary, -1);
-	str = g_strdup_printf(
-        "<span color=\"#FFFFFF\"><big><b>%s</b></big></span>", quoted);
-	g_free(quoted);
-	gtk_label_set_markup(GTK_LABEL(windata->summary_label), str);
-	g_free(str);
+	init_text_attributes();
 
-	if (pango_parse_markup (body, -1, 0, NULL, NULL, NULL, NULL))
+	if (g_strcmp0(gtk_label_get_text(GTK_LABEL(windata->summary_label)), summary) != 0)
 	{
-		str = g_strdup_printf("<span color=\"#EAEAEA\">%s</span>", body);
-		gtk_label_set_markup (GTK_LABEL (windata->body_label), str);
-		g_free(str);
-	}
-	else {
-		gtk_label_set_text (GTK_LABEL (windata->body_label), body);
+		gtk_label_set_text(GTK_LABEL(windata->summary_label), summary);
+		gtk_label_set_attributes(GTK_LABEL(windata->summary_label), summary_attrs);
 	}
 
+	notify_markup_cache_set_label(body_cache, GTK_LABEL(windata->body_label), &windata->body, body);
+
 	if (body == NULL || *body == '\0')
 		gtk_widget_hide(windata->body_label);
 	else
 		gtk_widget_show(windata->body_label);
 
-	gtk_widget_set_size_request(
-		((body != NULL && *body != '\0')
-		 ? windata->body_label : windata->summary_label),
-		WIDTH - (IMAGE_SIZE + IMAGE_PADDING) - 10,
-		-1);
+	if (!notify_update_in_progress(nw))
+		update_size(nw);
 }
 
 /* Set notification icon */
@@ -539,18 +645,12 @@ set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf)
 	gtk_image_set_from_pixbuf(GTK_IMAGE(windata->icon), pixbuf);
 
 	if (pixbuf != NULL)
-	{
-		int pixbuf_width = gdk_pixbuf_get_width(pixbuf);
-
 		gtk_widget_show(windata->icon);
-		gtk_widget_set_size_request(windata->iconbox,
-									MAX(BODY_X_OFFSET, pixbuf_width), -1);
-	}
 	else
-	{
 		gtk_widget_hide(windata->icon);
-		gtk_widget_set_size_request(windata->iconbox, BODY_X_OFFSET, -1);
-	}
+
+	if (!notify_update_in_progress(nw))
+		update_size(nw);
 }
 
 /* Set notification arrow */
@@ -566,84 +666,29 @@ add_notification_action(GtkWindow *nw, const char *text, const char *key,
 						ActionInvokedCb cb)
 {
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
-	GtkWidget *label;
-	GtkWidget *button;
-	GtkWidget *hbox;
-	GdkPixbuf *pixbuf;
-	char *buf;
 
 	g_assert(windata != NULL);
 
-	if (gtk_widget_get_visible(windata->actions_box))
+	if (!gtk_widget_get_visible(windata->actions_box))
 	{
 		gtk_widget_show(windata->actions_box);
-
-		/* Don't try to re-add a pie_countdown */
-		if (!windata->pie_countdown) {
-			windata->pie_countdown = gtk_drawing_area_new();
-			gtk_widget_set_halign (windata->pie_countdown, GTK_ALIGN_END);
-			gtk_widget_show(windata->pie_countdown);
-
-			gtk_box_pack_end (GTK_BOX (windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
-			gtk_widget_set_size_request(windata->pie_countdown,
-						    PIE_WIDTH, PIE_HEIGHT);
-			g_signal_connect(G_OBJECT(windata->pie_countdown), "draw",
-					 G_CALLBACK(countdown_expose_cb), windata);
-		}
-	}
-
-	if (windata->action_icons) {
-		button = gtk_button_new_from_icon_name(key, GTK_ICON_SIZE_BUTTON);
-		goto add_button;
 	}
 
-	button = gtk_button_new();
-
-	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
-	gtk_widget_show(hbox);
-	gtk_container_add(GTK_CONTAINER(button), hbox);
-
-	/* Try to be smart and find a suitable icon. */
-	buf = g_strdup_printf("stock_%s", key);
-	pixbuf = gtk_icon_theme_load_icon(
-		gtk_icon_theme_get_for_screen(
-			gdk_window_get_screen(gtk_widget_get_window(GTK_WIDGET(nw)))),
-		buf, 16, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
-	g_free(buf);
-
-	if (pixbuf != NULL)
-	{
-		GtkWidget *image = gtk_image_new_from_pixbuf(pixbuf);
-		gtk_widget_show(image);
-		gtk_box_pack_start(GTK_BOX(hbox), image, FALSE, FALSE, 0);
-		gtk_widget_set_halign (image, GTK_ALIGN_CENTER);
-		gtk_widget_set_valign (image, GTK_ALIGN_CENTER);
+	/* The pie stays with the buttons when the actions are cleared */
+	if (!windata->pie_countdown) {
+		windata->pie_countdown = gtk_drawing_area_new();
+		gtk_widget_set_halign (windata->pie_countdown, GTK_ALIGN_END);
+		gtk_widget_show(windata->pie_countdown);
+
+		gtk_box_pack_end (GTK_BOX (windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
+		gtk_widget_set_size_request(windata->pie_countdown,
+					    PIE_WIDTH, PIE_HEIGHT);
+		g_signal_connect(G_OBJECT(windata->pie_countdown), "draw",
+				 G_CALLBACK(countdown_expose_cb), windata);
 	}
 
-	label = gtk_label_new(NULL);
-	gtk_widget_show(label);
-	gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
-#if GTK_CHECK_VERSION (3, 16, 0)
-	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
-	gtk_label_set_yalign (GTK_LABEL (label), 0.5);
-#else
-	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
-#endif
-	buf = g_strdup_printf("<small>%s</small>", text);
-	gtk_label_set_markup(GTK_LABEL(label), buf);
-	g_free(buf);
-
-add_button:
-	gtk_widget_show(button);
-	gtk_box_pack_start(GTK_BOX(windata->actions_box), button, FALSE, FALSE, 0);
-
-	g_object_set_data(G_OBJECT(button), "_nw", nw);
-	g_object_set_data_full(G_OBJECT(button),
-						   "_action_key", g_strdup(key), g_free);
-	g_signal_connect(G_OBJECT(button), "button-release-event",
-					 G_CALLBACK(action_clicked_cb), cb);
-
-	gtk_widget_show_all(windata->actions_box);
+	notify_action_pool_add(windata->actions, nw, text, key,
+						   windata->action_icons, (NotifyActionFunc)cb);
 }
 
 /* Clear notification actions */
@@ -652,11 +697,9 @@ clear_notification_actions(GtkWindow *nw)
 {
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
 
-	windata->pie_countdown = NULL;
-
+	/* Buttons are hidden, for the next actions to relabel */
 	gtk_widget_hide(windata->actions_box);
-	gtk_container_foreach(GTK_CONTAINER(windata->actions_box),
-						  (GtkCallback)gtk_widget_destroy, NULL);
+	notify_action_pool_clear(windata->actions);
 }
 
 /* Move notification window */
@@ -725,9 +768,90 @@ notification_tick(GtkWindow *nw, glong remaining)
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
 	windata->remaining = remaining;
 
-	if (windata->pie_countdown != NULL)
+	/* Only redraw when the pie actually moved on to another frame */
+	if (windata->pie_countdown != NULL &&
+		notify_pie_atlas_needs_redraw(&windata->pie_atlas, remaining, windata->timeout))
 	{
-		gtk_widget_queue_draw_area(windata->pie_countdown, 0, 0,
-								   PIE_WIDTH, PIE_HEIGHT);
+		GdkRectangle area = { 0, 0, PIE_WIDTH, PIE_HEIGHT };
+
+		notify_repaint_queue(windata->pie_countdown, &area);
 	}
 }
+
+static void set_content_hints(GtkWindow* nw, guint8 urgency, gboolean action_icons)
+{
+	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
+
+	g_assert(windata != NULL);
+
+	windata->urgency = urgency;
+	windata->action_icons = action_icons;
+	gtk_window_set_title(nw, urgency == URGENCY_CRITICAL ? "Critical Notification" : "Notification");
+}
+
+static const NotifyUpdateFuncs update_funcs = {
+	set_content_hints,
+	set_notification_text,
+	set_notification_icon,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	set_notification_timeout,
+	update_size
+};
+
+static void set_notification_content(GtkWindow* nw, const NotificationContent* content)
+{
+	notify_update_apply(nw, content, &update_funcs);
+}
+
+static const NotifyEngineVTable engine_vtable = {
+	sizeof(NotifyEngineVTable),
+	NOTIFY_ENGINE_ABI_VERSION,
+	0,
+
+	"Coco",
+	PACKAGE_VERSION,
+	"Eduardo Grajeda",
+	"http://github.com/tatofoo/",
+
+	create_notification,
+	set_notification_text,
+	set_notification_icon,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, int, int)) move_notification,
+
+	NULL,
+	NULL,
+	NULL,
+	set_notification_hints,
+	set_notification_timeout,
+	notification_tick,
+	NULL,
+	set_notification_content,
+	notify_repaint_get_counts,
+	notify_cache_get_size,
+	notify_cache_release
+};
+
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE(guint abi_version)
+{
+	return &engine_vtable;
+}
+
+#ifndef NOTIFY_ENGINE_BUILTIN
+/* The shared gradient must not outlive the module */
+G_MODULE_EXPORT void
+g_module_unload(GModule *module)
+{
+	clear_style_cache();
+
+	if (summary_attrs != NULL)
+		pango_attr_list_unref(summary_attrs);
+
+	notify_markup_cache_free(body_cache);
+	notify_action_icon_cache_free();
+}
+#endif
@@ -0,0 +1,303 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "actions.h"
+#include "cachemem.h"
+
+/* Size of the icon beside an action label */
+#define ACTION_ICON_SIZE 16
+
+typedef struct {
+	GtkWidget* button;
+	GtkWidget* image;
+	GtkWidget* label;
+	char* key;
+	char* text;
+	gboolean icon_only;
+	GtkWindow* nw;
+	NotifyActionFunc cb;
+} ActionButton;
+
+struct _NotifyActionPool {
+	GtkWidget* box;
+	GtkReliefStyle relief;
+	GPtrArray* buttons;
+	guint n_used;
+};
+
+/* Key to pixbuf, NULL for a known miss, for icon_theme */
+static GHashTable* icon_cache = NULL;
+static GtkIconTheme* icon_theme = NULL;
+static gulong icon_theme_changed_id = 0;
+
+/* The <small> the labels used to be set with, without parsing it each time */
+static PangoAttrList* label_attrs = NULL;
+
+/* Misses are cached as NULL, which g_object_unref() must not see */
+static gsize get_pixbuf_size(GdkPixbuf* pixbuf)
+{
+	return (gsize) gdk_pixbuf_get_rowstride(pixbuf) * gdk_pixbuf_get_height(pixbuf);
+}
+
+static void free_cached_icon(GdkPixbuf* pixbuf)
+{
+	if (pixbuf != NULL)
+	{
+		notify_cache_charge(- (gssize) get_pixbuf_size(pixbuf));
+		g_object_unref(pixbuf);
+	}
+}
+
+static void on_icon_theme_changed(GtkIconTheme* theme, gpointer user_data)
+{
+	g_hash_table_remove_all(icon_cache);
+}
+
+GdkPixbuf* notify_action_icon_lookup(GtkWidget* widget, const char* key)
+{
+	GtkIconTheme* theme;
+	GdkPixbuf* pixbuf;
+	char* name;
+
+	theme = gtk_icon_theme_get_for_screen(gtk_widget_get_screen(widget));
+
+	if (theme != icon_theme)
+	{
+		notify_action_icon_cache_free();
+
+		icon_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) free_cached_icon);
+		icon_theme = g_object_ref(theme);
+		icon_theme_changed_id = g_signal_connect(theme, "changed", G_CALLBACK(on_icon_theme_changed), NULL);
+		notify_cache_add((NotifyCacheReleaseFunc) g_hash_table_remove_all, icon_cache);
+	}
+
+	if (g_hash_table_lookup_extended(icon_cache, key, NULL, (gpointer*) &pixbuf))
+	{
+		return pixbuf;
+	}
+
+	name = g_strdup_printf("stock_%s", key);
+	pixbuf = gtk_icon_theme_load_icon(theme, name, ACTION_ICON_SIZE, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
+	g_free(name);
+
+	/* Misses are remembered as well, they are the common case */
+	g_hash_table_insert(icon_cache, g_strdup(key), pixbuf);
+
+	if (pixbuf != NULL)
+	{
+		notify_cache_charge(get_pixbuf_size(pixbuf));
+	}
+
+	return pixbuf;
+}
+
+void notify_action_icon_cache_free(void)
+{
+	if (icon_theme != NULL)
+	{
+		g_signal_handler_disconnect(icon_theme, icon_theme_changed_id);
+		g_object_unref(icon_theme);
+		icon_theme = NULL;
+	}
+
+	if (icon_cache != NULL)
+	{
+		notify_cache_remove((NotifyCacheReleaseFunc) g_hash_table_remove_all, icon_cache);
+		g_hash_table_destroy(icon_cache);
+		icon_cache = NULL;
+	}
+
+	if (label_attrs != NULL)
+	{
+		pango_attr_list_unref(label_attrs);
+		label_attrs = NULL;
+	}
+}
+
+static void free_action_button(ActionButton* action)
+{
+	g_free(action->key);
+	g_free(action->text);
+	g_free(action);
+}
+
+static gboolean on_button_release(GtkWidget* button, GdkEventButton* event, ActionButton* action)
+{
+	action->cb(action->nw, action->key);
+
+	return FALSE;
+}
+
+static ActionButton* create_action_button(NotifyActionPool* pool)
+{
+	ActionButton* action;
+	GtkWidget* hbox;
+
+	if (label_attrs == NULL)
+	{
+		label_attrs = pango_attr_list_new();
+		pango_attr_list_insert(label_attrs, pango_attr_scale_new(PANGO_SCALE_SMALL));
+	}
+
+	action = g_new0(ActionButton, 1);
+
+	action->button = gtk_button_new();
+	gtk_button_set_relief(GTK_BUTTON(action->button), pool->relief);
+
+	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+	gtk_widget_show(hbox);
+	gtk_container_add(GTK_CONTAINER(action->button), hbox);
+
+	action->image = gtk_image_new();
+	gtk_widget_set_halign(action->image, GTK_ALIGN_CENTER);
+	gtk_widget_set_valign(action->image, GTK_ALIGN_CENTER);
+	gtk_box_pack_start(GTK_BOX(hbox), action->image, FALSE, FALSE, 0);
+
+	action->label = gtk_label_new(NULL);
+	gtk_label_set_attributes(GTK_LABEL(action->label), label_attrs);
+#if GTK_CHECK_VERSION (3, 16, 0)
+	gtk_label_set_xalign(GTK_LABEL(action->label), 0.0);
+	gtk_label_set_yalign(GTK_LABEL(action->label), 0.5);
+#else
+	gtk_misc_set_alignment(GTK_MISC(action->label), 0.0, 0.5);
+#endif
+	gtk_box_pack_start(GTK_BOX(hbox), action->label, FALSE, FALSE, 0);
+
+	gtk_box_pack_start(GTK_BOX(pool->box), action->button, FALSE, FALSE, 0);
+
+	/* The button owns its state, it may outlive the pool */
+	g_object_set_data_full(G_OBJECT(action->button), "_notify_action", action, (GDestroyNotify) free_action_button);
+	g_signal_connect(action->button, "button-release-event", G_CALLBACK(on_button_release), action);
+
+	g_ptr_array_add(pool->buttons, action);
+
+	return action;
+}
+
+static void set_action_icon(ActionButton* action, gboolean icon_only)
+{
+	GdkPixbuf* pixbuf;
+
+	if (icon_only)
+	{
+		gtk_image_set_from_icon_name(GTK_IMAGE(action->image), action->key, GTK_ICON_SIZE_BUTTON);
+		gtk_widget_show(action->image);
+		gtk_widget_hide(action->label);
+		return;
+	}
+
+	/* Try to be smart and find a suitable icon. */
+	pixbuf = notify_action_icon_lookup(action->button, action->key);
+
+	if (pixbuf != NULL)
+	{
+		gtk_image_set_from_pixbuf(GTK_IMAGE(action->image), pixbuf);
+		gtk_widget_show(action->image);
+	}
+	else
+	{
+		gtk_image_clear(GTK_IMAGE(action->image));
+		gtk_widget_hide(action->image);
+	}
+
+	gtk_widget_show(action->label);
+}
+
+NotifyActionPool* notify_action_pool_new(GtkWidget* box, GtkReliefStyle relief)
+{
+	NotifyActionPool* pool;
+
+	pool = g_new0(NotifyActionPool, 1);
+	pool->box = box;
+	pool->relief = relief;
+	pool->buttons = g_ptr_array_new();
+
+	return pool;
+}
+
+void notify_action_pool_free(NotifyActionPool* pool)
+{
+	if (pool == NULL)
+	{
+		return;
+	}
+
+	g_ptr_array_free(pool->buttons, TRUE);
+	g_free(pool);
+}
+
+void notify_action_pool_clear(NotifyActionPool* pool)
+{
+	guint i;
+
+	for (i = 0; i < pool->n_used; i++)
+	{
+		gtk_widget_hide(((ActionButton*) g_ptr_array_index(pool->buttons, i))->button);
+	}
+
+	pool->n_used = 0;
+}
+
+void notify_action_pool_add(NotifyActionPool* pool, GtkWindow* nw, const char* text, const char* key, gboolean icon_only, NotifyActionFunc cb)
+{
+	ActionButton* action;
+	gboolean key_changed;
+
+	if (pool->n_used < pool->buttons->len)
+	{
+		action = g_ptr_array_index(pool->buttons, pool->n_used);
+	}
+	else
+	{
+		action = create_action_button(pool);
+	}
+
+	pool->n_used++;
+
+	action->nw = nw;
+	action->cb = cb;
+
+	key_changed = g_strcmp0(action->key, key) != 0;
+
+	if (key_changed)
+	{
+		g_free(action->key);
+		action->key = g_strdup(key);
+	}
+
+	if (key_changed || action->icon_only != icon_only)
+	{
+		set_action_icon(action, icon_only);
+		action->icon_only = icon_only;
+	}
+
+	if (g_strcmp0(action->text, text) != 0)
+	{
+		g_free(action->text);
+		action->text = g_strdup(text);
+		gtk_label_set_text(GTK_LABEL(action->label), text);
+	}
+
+	gtk_widget_show(action->button);
+}
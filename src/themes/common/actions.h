@@ -0,0 +1,58 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_THEME_ACTIONS_H_
+#define _NOTIFY_THEME_ACTIONS_H_
+
+#include <gtk/gtk.h>
+
+typedef void (*NotifyActionFunc) (GtkWindow* nw, const char* key);
+
+/*
+ * The action buttons of one notification window. Buttons are kept when
+ * the actions are cleared and relabeled in place by the next ones, so
+ * an update with the same actions does not build any widget.
+ */
+typedef struct _NotifyActionPool NotifyActionPool;
+
+/* Buttons are packed at the start of box */
+NotifyActionPool* notify_action_pool_new(GtkWidget* box, GtkReliefStyle relief);
+void notify_action_pool_free(NotifyActionPool* pool);
+
+/* Hides every button, for the next ones added to reuse */
+void notify_action_pool_clear(NotifyActionPool* pool);
+
+/*
+ * Shows the next button for action key. With icon_only it shows the
+ * icon named key instead of text, as the action-icons hint asks.
+ */
+void notify_action_pool_add(NotifyActionPool* pool, GtkWindow* nw, const char* text, const char* key, gboolean icon_only, NotifyActionFunc cb);
+
+/*
+ * The "stock_<key>" icon shown beside an action label, or NULL when
+ * the icon theme has none. Lookups are remembered until the icon theme
+ * changes; the pixbuf belongs to the cache.
+ */
+GdkPixbuf* notify_action_icon_lookup(GtkWidget* widget, const char* key);
+
+/* Frees the icon cache, when the engine is unloaded */
+void notify_action_icon_cache_free(void);
+
+#endif /* _NOTIFY_THEME_ACTIONS_H_ */
@@ -0,0 +1,116 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include "cachemem.h"
+
+typedef struct {
+	NotifyCacheReleaseFunc release;
+	gpointer data;
+} CacheEntry;
+
+static GSList* cache_entries = NULL;
+static gsize cache_size = 0;
+static cairo_user_data_key_t charge_key;
+
+static void uncharge_surface(gpointer bytes)
+{
+	notify_cache_charge(- (gssize) GPOINTER_TO_SIZE(bytes));
+}
+
+cairo_surface_t* notify_cache_surface_new(cairo_t* cr, int width, int height)
+{
+	cairo_surface_t* surface;
+	gsize bytes;
+
+	surface = cairo_surface_create_similar(cairo_get_target(cr), CAIRO_CONTENT_COLOR_ALPHA, width, height);
+	bytes = (gsize) MAX(width, 0) * MAX(height, 0) * 4;
+
+	/* Error surfaces take no user data, nor memory */
+	if (cairo_surface_set_user_data(surface, &charge_key, GSIZE_TO_POINTER(bytes), uncharge_surface) == CAIRO_STATUS_SUCCESS)
+	{
+		notify_cache_charge(bytes);
+	}
+
+	return surface;
+}
+
+void notify_cache_charge(gssize delta)
+{
+	if (delta < 0 && (gsize) -delta > cache_size)
+	{
+		cache_size = 0;
+	}
+	else
+	{
+		cache_size += delta;
+	}
+}
+
+void notify_cache_add(NotifyCacheReleaseFunc release, gpointer data)
+{
+	CacheEntry* entry;
+
+	entry = g_new(CacheEntry, 1);
+	entry->release = release;
+	entry->data = data;
+
+	cache_entries = g_slist_append(cache_entries, entry);
+}
+
+void notify_cache_remove(NotifyCacheReleaseFunc release, gpointer data)
+{
+	GSList* l;
+
+	for (l = cache_entries; l != NULL; l = l->next)
+	{
+		CacheEntry* entry = l->data;
+
+		if (entry->release == release && entry->data == data)
+		{
+			cache_entries = g_slist_delete_link(cache_entries, l);
+			g_free(entry);
+			return;
+		}
+	}
+}
+
+gsize notify_cache_get_size(void)
+{
+	return cache_size;
+}
+
+/* Release functions must not add or remove caches */
+gsize notify_cache_release(gsize excess)
+{
+	gsize before = cache_size;
+	GSList* l;
+
+	for (l = cache_entries; l != NULL && before - cache_size < excess; l = l->next)
+	{
+		CacheEntry* entry = l->data;
+
+		entry->release(entry->data);
+	}
+
+	return before - cache_size;
+}
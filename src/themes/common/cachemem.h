@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef _NOTIFY_THEME_CACHEMEM_H_
+#define _NOTIFY_THEME_CACHEMEM_H_
+
+#include <gtk/gtk.h>
+
+/*
+ * Image memory an engine keeps in caches it can rebuild at any time:
+ * window backgrounds, countdown pies and action icons. The daemon reads
+ * the total for its memory budget and has the caches released when it
+ * is over budget or idle.
+ */
+
+/* Drops whatever data caches, it is rebuilt when next needed */
+typedef void (*NotifyCacheReleaseFunc) (gpointer data);
+
+/*
+ * An ARGB surface like the target of cr, charged to the caches for as
+ * long as it lives, wherever its pixels are kept.
+ */
+cairo_surface_t* notify_cache_surface_new(cairo_t* cr, int width, int height);
+
+void notify_cache_charge(gssize delta);
+
+void notify_cache_add(NotifyCacheReleaseFunc release, gpointer data);
+void notify_cache_remove(NotifyCacheReleaseFunc release, gpointer data);
+
+gsize notify_cache_get_size(void);
+
+/* Releases caches until at least excess bytes went, returns the bytes released */
+gsize notify_cache_release(gsize excess);
+
+#endif /* _NOTIFY_THEME_CACHEMEM_H_ */
@@ -0,0 +1,183 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "cachemem.h"
+#include "markup.h"
+
+/* Parsed bodies kept around; the table is simply emptied when full */
+#define MAX_CACHED_MARKUP 64
+
+struct _NotifyMarkupCache {
+	GHashTable* entries;
+	PangoAttrList* base_attrs;
+};
+
+static NotifyMarkup* notify_markup_ref(NotifyMarkup* markup)
+{
+	g_atomic_int_inc(&markup->ref_count);
+
+	return markup;
+}
+
+void notify_markup_unref(NotifyMarkup* markup)
+{
+	if (markup == NULL || !g_atomic_int_dec_and_test(&markup->ref_count))
+	{
+		return;
+	}
+
+	if (markup->attrs != NULL)
+	{
+		pango_attr_list_unref(markup->attrs);
+	}
+
+	g_free(markup->text);
+	g_free(markup);
+}
+
+NotifyMarkupCache* notify_markup_cache_new(PangoAttrList* base_attrs)
+{
+	NotifyMarkupCache* cache;
+
+	cache = g_new0(NotifyMarkupCache, 1);
+	cache->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) notify_markup_unref);
+
+	/* Holds no image memory, but goes when the daemon trims its caches */
+	notify_cache_add((NotifyCacheReleaseFunc) g_hash_table_remove_all, cache->entries);
+
+	if (base_attrs != NULL)
+	{
+		cache->base_attrs = pango_attr_list_ref(base_attrs);
+	}
+
+	return cache;
+}
+
+void notify_markup_cache_free(NotifyMarkupCache* cache)
+{
+	if (cache == NULL)
+	{
+		return;
+	}
+
+	notify_cache_remove((NotifyCacheReleaseFunc) g_hash_table_remove_all, cache->entries);
+	g_hash_table_destroy(cache->entries);
+
+	if (cache->base_attrs != NULL)
+	{
+		pango_attr_list_unref(cache->base_attrs);
+	}
+
+	g_free(cache);
+}
+
+static gboolean prepend_attribute(PangoAttribute* attr, gpointer user_data)
+{
+	pango_attr_list_insert_before((PangoAttrList*) user_data, pango_attribute_copy(attr));
+
+	return FALSE;
+}
+
+static NotifyMarkup* parse_markup(NotifyMarkupCache* cache, const char* markup)
+{
+	NotifyMarkup* result;
+
+	result = g_new0(NotifyMarkup, 1);
+	result->ref_count = 1;
+
+	if (!pango_parse_markup(markup, -1, 0, &result->attrs, &result->text, NULL, NULL))
+	{
+		/* Pango doesn't know links, but the label does */
+		result->text = g_strdup(markup);
+		result->has_links = strstr(markup, "<a ") != NULL;
+		result->attrs = cache->base_attrs != NULL ? pango_attr_list_ref(cache->base_attrs) : NULL;
+
+		return result;
+	}
+
+	/* Base attributes go first so the markup's own spans override them */
+	if (cache->base_attrs != NULL)
+	{
+		pango_attr_list_filter(cache->base_attrs, prepend_attribute, result->attrs);
+	}
+
+	return result;
+}
+
+NotifyMarkup* notify_markup_cache_lookup(NotifyMarkupCache* cache, const char* markup)
+{
+	NotifyMarkup* result;
+
+	if (markup == NULL)
+	{
+		markup = "";
+	}
+
+	result = g_hash_table_lookup(cache->entries, markup);
+
+	if (result == NULL)
+	{
+		if (g_hash_table_size(cache->entries) >= MAX_CACHED_MARKUP)
+		{
+			g_hash_table_remove_all(cache->entries);
+		}
+
+		result = parse_markup(cache, markup);
+		g_hash_table_insert(cache->entries, g_strdup(markup), result);
+	}
+
+	return notify_markup_ref(result);
+}
+
+void notify_markup_apply(const NotifyMarkup* markup, GtkLabel* label)
+{
+	if (markup->has_links)
+	{
+		gtk_label_set_markup(label, markup->text);
+	}
+	else
+	{
+		gtk_label_set_text(label, markup->text);
+	}
+
+	gtk_label_set_attributes(label, markup->attrs);
+}
+
+void notify_markup_cache_set_label(NotifyMarkupCache* cache, GtkLabel* label, NotifyMarkup** current, const char* markup)
+{
+	NotifyMarkup* result;
+
+	result = notify_markup_cache_lookup(cache, markup);
+
+	if (result == *current)
+	{
+		notify_markup_unref(result);
+		return;
+	}
+
+	notify_markup_apply(result, label);
+
+	notify_markup_unref(*current);
+	*current = result;
+}
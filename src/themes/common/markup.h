@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_THEME_MARKUP_H_
+#define _NOTIFY_THEME_MARKUP_H_
+
+#include <gtk/gtk.h>
+
+/*
+ * A notification body parsed once into plain text and attributes. When
+ * the body is not valid markup it is shown as is, unless it only failed
+ * for its links; then text is the markup, for the label to parse.
+ */
+typedef struct {
+	gint ref_count;
+	char* text;
+	gboolean has_links;
+	PangoAttrList* attrs;
+} NotifyMarkup;
+
+typedef struct _NotifyMarkupCache NotifyMarkupCache;
+
+/* base_attrs, if any, apply under whatever the markup itself sets */
+NotifyMarkupCache* notify_markup_cache_new(PangoAttrList* base_attrs);
+void notify_markup_cache_free(NotifyMarkupCache* cache);
+
+/* Returns a new reference; identical bodies give the same NotifyMarkup */
+NotifyMarkup* notify_markup_cache_lookup(NotifyMarkupCache* cache, const char* markup);
+void notify_markup_unref(NotifyMarkup* markup);
+
+void notify_markup_apply(const NotifyMarkup* markup, GtkLabel* label);
+
+/*
+ * Shows markup in a label through the cache. *current holds the markup
+ * the label shows now; when it comes out the same the label is left
+ * alone, so it does not have to be laid out again.
+ */
+void notify_markup_cache_set_label(NotifyMarkupCache* cache, GtkLabel* label, NotifyMarkup** current, const char* markup);
+
+#endif /* _NOTIFY_THEME_MARKUP_H_ */
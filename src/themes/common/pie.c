@@ -0,0 +1,109 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "cachemem.h"
+#include "pie.h"
+
+int notify_pie_get_frame(glong remaining, glong timeout)
+{
+	if (timeout <= 0)
+	{
+		return NOTIFY_PIE_NO_COUNTDOWN;
+	}
+
+	remaining = CLAMP(remaining, 0, timeout);
+
+	/* Round to the nearest step; frame 0 is empty, the last one full */
+	return (int) ((remaining * (NOTIFY_PIE_FRAMES - 1) + timeout / 2) / timeout);
+}
+
+gboolean notify_pie_atlas_needs_redraw(const NotifyPieAtlas* atlas, glong remaining, glong timeout)
+{
+	return atlas->surface == NULL || atlas->frame != notify_pie_get_frame(remaining, timeout);
+}
+
+void notify_pie_atlas_paint(NotifyPieAtlas* atlas, cairo_t* cr, int width, int height, int frame, NotifyPieDrawFunc draw_func, gpointer user_data)
+{
+	cairo_t* cr2;
+
+	g_return_if_fail(frame >= 0 && frame <= NOTIFY_PIE_NO_COUNTDOWN);
+
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	if (atlas->surface != NULL && (atlas->width != width || atlas->height != height))
+	{
+		notify_pie_atlas_clear(atlas);
+	}
+
+	if (atlas->surface == NULL)
+	{
+		atlas->surface = notify_cache_surface_new(cr, width * (NOTIFY_PIE_FRAMES + 1), height);
+		atlas->width = width;
+		atlas->height = height;
+	}
+
+	if (!atlas->rendered[frame])
+	{
+		cr2 = cairo_create(atlas->surface);
+
+		cairo_rectangle(cr2, frame * width, 0, width, height);
+		cairo_clip(cr2);
+		cairo_translate(cr2, frame * width, 0);
+
+		if (frame == NOTIFY_PIE_NO_COUNTDOWN)
+		{
+			draw_func(cr2, -1.0, user_data);
+		}
+		else
+		{
+			draw_func(cr2, (gdouble) frame / (NOTIFY_PIE_FRAMES - 1), user_data);
+		}
+
+		cairo_destroy(cr2);
+
+		atlas->rendered[frame] = TRUE;
+	}
+
+	cairo_save(cr);
+	cairo_set_source_surface(cr, atlas->surface, -frame * width, 0);
+	cairo_rectangle(cr, 0, 0, width, height);
+	cairo_fill(cr);
+	cairo_restore(cr);
+
+	atlas->frame = frame;
+}
+
+void notify_pie_atlas_clear(NotifyPieAtlas* atlas)
+{
+	if (atlas->surface != NULL)
+	{
+		cairo_surface_destroy(atlas->surface);
+		atlas->surface = NULL;
+	}
+
+	memset(atlas->rendered, 0, sizeof(atlas->rendered));
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_THEME_PIE_H_
+#define _NOTIFY_THEME_PIE_H_
+
+#include <gtk/gtk.h>
+
+/* Quantized countdown steps, plus one extra cell for "no countdown" */
+#define NOTIFY_PIE_FRAMES 64
+#define NOTIFY_PIE_NO_COUNTDOWN NOTIFY_PIE_FRAMES
+
+/*
+ * Draws one countdown cell at the origin. fraction is the part of the
+ * timeout still remaining, from 0.0 to 1.0, or negative when the
+ * notification has no timeout.
+ */
+typedef void (*NotifyPieDrawFunc) (cairo_t* cr, gdouble fraction, gpointer user_data);
+
+/*
+ * Every frame of a countdown pie, rendered on first use into one strip
+ * and blitted from there afterwards.
+ */
+typedef struct {
+	cairo_surface_t* surface;
+	int width;
+	int height;
+	gboolean rendered[NOTIFY_PIE_FRAMES + 1];
+	int frame;
+} NotifyPieAtlas;
+
+int notify_pie_get_frame(glong remaining, glong timeout);
+
+/* Whether a tick moved the pie to a frame that is not on screen yet */
+gboolean notify_pie_atlas_needs_redraw(const NotifyPieAtlas* atlas, glong remaining, glong timeout);
+
+void notify_pie_atlas_paint(NotifyPieAtlas* atlas, cairo_t* cr, int width, int height, int frame, NotifyPieDrawFunc draw_func, gpointer user_data);
+
+/* Drops all cells, for when the colors or the size of the pie change */
+void notify_pie_atlas_clear(NotifyPieAtlas* atlas);
+
+#endif /* _NOTIFY_THEME_PIE_H_ */
@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include "repaint.h"
+
+static NotifyEngineRepaintCounts counts;
+
+void notify_repaint_count_paint(void)
+{
+	counts.paints++;
+}
+
+gboolean notify_repaint_configure(int* width, int* height, const GdkEventConfigure* event)
+{
+	if (event->width == *width && event->height == *height)
+	{
+		counts.configure_moves++;
+		return FALSE;
+	}
+
+	*width = event->width;
+	*height = event->height;
+	counts.configure_resizes++;
+
+	return TRUE;
+}
+
+void notify_repaint_queue(GtkWidget* widget, const GdkRectangle* area)
+{
+	counts.queued_redraws++;
+
+	if (area == NULL)
+	{
+		gtk_widget_queue_draw(widget);
+	}
+	else
+	{
+		gtk_widget_queue_draw_area(widget, area->x, area->y, area->width, area->height);
+	}
+}
+
+void notify_repaint_get_counts(NotifyEngineRepaintCounts* result)
+{
+	*result = counts;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef _NOTIFY_THEME_REPAINT_H_
+#define _NOTIFY_THEME_REPAINT_H_
+
+#include <gtk/gtk.h>
+
+#include "notify-engine.h"
+
+/* Counts a paint of a notification window's background */
+void notify_repaint_count_paint(void);
+
+/*
+ * Records a ConfigureNotify of a window last known to be width x height,
+ * and stores its new size there. Returns whether the size changed; a pure
+ * move, as in stack shifts, leaves everything drawn valid.
+ */
+gboolean notify_repaint_configure(int* width, int* height, const GdkEventConfigure* event);
+
+/* Queues area of widget for redrawing, all of it when area is NULL */
+void notify_repaint_queue(GtkWidget* widget, const GdkRectangle* area);
+
+/* Counts of the engine, summed over all of its windows */
+void notify_repaint_get_counts(NotifyEngineRepaintCounts* counts);
+
+#endif /* _NOTIFY_THEME_REPAINT_H_ */
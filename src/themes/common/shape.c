@@ -0,0 +1,194 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "notify-engine.h"
+#include "shape.h"
+
+/*
+ * Columns to leave out on a row of a corner, for the row at distance
+ * dy (measured from pixel centers) from the corner's arc center. A
+ * pixel is kept when its center lies within the arc.
+ */
+static int get_corner_inset(int radius, double dy)
+{
+	int inset;
+	double dx;
+
+	for (inset = 0; inset < radius; inset++)
+	{
+		dx = radius - inset - 0.5;
+
+		if (dx * dx + dy * dy <= (double) radius * radius)
+		{
+			break;
+		}
+	}
+
+	return inset;
+}
+
+static void add_rounded_rectangle(cairo_region_t* region, const cairo_rectangle_int_t* body, int radius)
+{
+	cairo_rectangle_int_t span;
+	int row;
+	int inset;
+
+	radius = CLAMP(radius, 0, MIN(body->width, body->height) / 2);
+
+	span.x = body->x;
+	span.y = body->y + radius;
+	span.width = body->width;
+	span.height = body->height - 2 * radius;
+	cairo_region_union_rectangle(region, &span);
+
+	/* The corners, one span per row and mirrored top to bottom */
+	span.height = 1;
+
+	for (row = 0; row < radius; row++)
+	{
+		inset = get_corner_inset(radius, radius - row - 0.5);
+
+		span.x = body->x + inset;
+		span.width = body->width - 2 * inset;
+
+		span.y = body->y + row;
+		cairo_region_union_rectangle(region, &span);
+
+		span.y = body->y + body->height - 1 - row;
+		cairo_region_union_rectangle(region, &span);
+	}
+}
+
+static void add_arrow(cairo_region_t* region, const GdkPoint* arrow)
+{
+	cairo_rectangle_int_t span;
+	int base_y;
+	int tip_y;
+	int row;
+	double t;
+	double left;
+	double right;
+
+	base_y = arrow[0].y;
+	tip_y = arrow[1].y;
+
+	if (base_y == tip_y)
+	{
+		return;
+	}
+
+	span.height = 1;
+
+	for (row = MIN(base_y, tip_y); row < MAX(base_y, tip_y); row++)
+	{
+		/* How far along from the base toward the tip this row is */
+		t = (row + 0.5 - base_y) / (double) (tip_y - base_y);
+
+		left = arrow[0].x + t * (arrow[1].x - arrow[0].x);
+		right = arrow[2].x + t * (arrow[1].x - arrow[2].x);
+
+		span.x = (int) MIN(left, right);
+		span.width = (int) (MAX(left, right) + 0.5) - span.x;
+		span.y = row;
+
+		if (span.width > 0)
+		{
+			cairo_region_union_rectangle(region, &span);
+		}
+	}
+}
+
+cairo_region_t* notify_shape_create_region(const NotifyShape* shape)
+{
+	cairo_region_t* region;
+
+	region = cairo_region_create();
+
+	add_rounded_rectangle(region, &shape->body, shape->radius);
+
+	if (shape->has_arrow)
+	{
+		add_arrow(region, shape->arrow);
+	}
+
+	return region;
+}
+
+void notify_shape_apply(GtkWidget* window, NotifyShapeCache* cache, const NotifyShape* shape)
+{
+	NotifyShape key;
+	cairo_region_t* region;
+
+	if (shape == NULL)
+	{
+		if (!cache->valid || cache->shaped)
+		{
+			gtk_widget_shape_combine_region(window, NULL);
+
+			cache->valid = TRUE;
+			cache->shaped = FALSE;
+		}
+
+		return;
+	}
+
+	/* Arrow points are meaningless without an arrow; don't compare them */
+	memset(&key, 0, sizeof(NotifyShape));
+	key.body = shape->body;
+	key.radius = shape->radius;
+	key.has_arrow = shape->has_arrow;
+
+	if (shape->has_arrow)
+	{
+		memcpy(key.arrow, shape->arrow, sizeof(key.arrow));
+	}
+
+	if (cache->valid && cache->shaped && memcmp(&key, &cache->shape, sizeof(NotifyShape)) == 0)
+	{
+		return;
+	}
+
+	region = notify_shape_create_region(&key);
+	gtk_widget_shape_combine_region(window, region);
+	cairo_region_destroy(region);
+
+	cache->shape = key;
+	cache->valid = TRUE;
+	cache->shaped = TRUE;
+}
+
+gboolean notify_screen_is_composited(GdkScreen* screen)
+{
+	switch (GPOINTER_TO_INT(g_object_get_data(G_OBJECT(screen), NOTIFY_ENGINE_COMPOSITING_KEY)))
+	{
+		case NOTIFY_ENGINE_COMPOSITING_ON:
+			return TRUE;
+
+		case NOTIFY_ENGINE_COMPOSITING_OFF:
+			return FALSE;
+
+		default:
+			return gdk_screen_is_composited(screen);
+	}
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _NOTIFY_THEME_SHAPE_H_
+#define _NOTIFY_THEME_SHAPE_H_
+
+#include <gtk/gtk.h>
+
+/*
+ * Window shape of a notification: a rounded rectangle, optionally with
+ * an arrow triangle whose base rests on one of its edges. Arrow points
+ * are begin, tip and end, in window coordinates.
+ */
+typedef struct {
+	cairo_rectangle_int_t body;
+	int radius;
+	gboolean has_arrow;
+	GdkPoint arrow[3];
+} NotifyShape;
+
+/* The shape last set on a window, so unchanged geometry is not reapplied */
+typedef struct {
+	NotifyShape shape;
+	gboolean valid;
+	gboolean shaped;
+} NotifyShapeCache;
+
+cairo_region_t* notify_shape_create_region(const NotifyShape* shape);
+
+/* Passing a NULL shape removes any shape from the window */
+void notify_shape_apply(GtkWidget* window, NotifyShapeCache* cache, const NotifyShape* shape);
+
+/*
+ * Whether windows on screen are composited, so they can be translucent
+ * instead of shaped. Honors NOTIFY_ENGINE_COMPOSITING_KEY.
+ */
+gboolean notify_screen_is_composited(GdkScreen* screen);
+
+#endif /* _NOTIFY_THEME_SHAPE_H_ */
@@ -0,0 +1,88 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include "update.h"
+
+static GQuark update_quark = 0;
+
+gboolean notify_update_in_progress(GtkWindow* nw)
+{
+	return update_quark != 0 && g_object_get_qdata(G_OBJECT(nw), update_quark) != NULL;
+}
+
+void notify_update_apply(GtkWindow* nw, const NotificationContent* content, const NotifyUpdateFuncs* funcs)
+{
+	guint i;
+
+	if (content->changed == 0)
+	{
+		return;
+	}
+
+	if (update_quark == 0)
+	{
+		update_quark = g_quark_from_static_string("notify-update-in-progress");
+	}
+
+	g_object_set_qdata(G_OBJECT(nw), update_quark, GINT_TO_POINTER(TRUE));
+
+	if (content->changed & NOTIFICATION_CONTENT_HINTS)
+	{
+		funcs->set_hints(nw, content->urgency, content->action_icons);
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_ICON)
+	{
+		funcs->set_icon(nw, content->icon);
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_TEXT)
+	{
+		funcs->set_text(nw, content->summary, content->body);
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_ACTIONS)
+	{
+		funcs->clear_actions(nw);
+
+		for (i = 0; i < content->n_actions; i++)
+		{
+			funcs->add_action(nw, content->actions[i].label, content->actions[i].key, content->action_cb);
+		}
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_ARROW)
+	{
+		funcs->set_arrow(nw, content->arrow_visible, content->arrow_x, content->arrow_y);
+	}
+
+	if (content->changed & NOTIFICATION_CONTENT_TIMEOUT)
+	{
+		funcs->set_timeout(nw, content->timeout);
+	}
+
+	g_object_set_qdata(G_OBJECT(nw), update_quark, NULL);
+
+	/* The icon box, the labels and what is visible are all known now */
+	funcs->update_size(nw);
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+ *
+ * Copyright (C) 2026 MATE Developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef _NOTIFY_THEME_UPDATE_H_
+#define _NOTIFY_THEME_UPDATE_H_
+
+#include <gtk/gtk.h>
+
+#include "notify-engine.h"
+
+/*
+ * The setters of an engine, for applying a whole NotificationContent.
+ * While notify_update_apply() runs them, notify_update_in_progress() is
+ * TRUE and the setters leave sizing to update_size, which is run once
+ * when everything is in place.
+ */
+typedef struct {
+	void (*set_hints)     (GtkWindow* nw, guint8 urgency, gboolean action_icons);
+	void (*set_text)      (GtkWindow* nw, const char* summary, const char* body);
+	void (*set_icon)      (GtkWindow* nw, GdkPixbuf* pixbuf);
+	void (*clear_actions) (GtkWindow* nw);
+	void (*add_action)    (GtkWindow* nw, const char* label, const char* key, GCallback cb);
+	void (*set_arrow)     (GtkWindow* nw, gboolean visible, int x, int y);
+	void (*set_timeout)   (GtkWindow* nw, glong timeout);
+	void (*update_size)   (GtkWindow* nw);
+} NotifyUpdateFuncs;
+
+void notify_update_apply(GtkWindow* nw, const NotificationContent* content, const NotifyUpdateFuncs* funcs);
+
+gboolean notify_update_in_progress(GtkWindow* nw);
+
+#endif /* _NOTIFY_THEME_UPDATE_H_ */
@@ -25,8 +25,19 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
+
+#include "notify-engine.h"
+#include "actions.h"
+#include "cachemem.h"
+#include "markup.h"
+#include "pie.h"
+#include "repaint.h"
+#include "shape.h"
+#include "update.h"
 #include <gdk/gdkx.h>
 
 /* Define basic nodoka types */
@@ -46,6 +57,20 @@ typedef struct
 
 } ArrowParameters;
 
+/* Everything the cached background is drawn from */
+typedef struct
+{
+	int width;
+	int height;
+	int urgency;
+	int composited;
+	int has_arrow;
+	GdkPoint point_begin;
+	GdkPoint point_middle;
+	GdkPoint point_end;
+
+} BackgroundKey;
+
 typedef struct
 {
 	GtkWidget *win;
@@ -58,6 +83,7 @@ typedef struct
 	GtkWidget *summary_label;
 	GtkWidget *body_label;
 	GtkWidget *actions_box;
+	NotifyActionPool *actions;
 	GtkWidget *last_sep;
 	GtkWidget *stripe_spacer;
 	GtkWidget *pie_countdown;
@@ -69,8 +95,14 @@ typedef struct
 
 	int width;
 	int height;
-	int last_width;
-	int last_height;
+	NotifyShapeCache shape;
+
+	cairo_surface_t *background;
+	BackgroundKey background_key;
+	NotifyPieAtlas pie_atlas;
+	NotifyMarkup *body;
+	int pie_x;
+	int pie_y;
 
 	guchar urgency;
 	glong timeout;
@@ -88,22 +120,22 @@ enum
 	URGENCY_CRITICAL
 };
 
-gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
+NOTIFY_ENGINE_SYMBOL gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
 			  unsigned int micro_ver);
-void get_theme_info(char **theme_name, char **theme_ver, char **author,
+NOTIFY_ENGINE_SYMBOL void get_theme_info(char **theme_name, char **theme_ver, char **author,
 		    char **homepage);
-GtkWindow* create_notification(UrlClickedCb url_clicked);
-void set_notification_text(GtkWindow *nw, const char *summary,
+NOTIFY_ENGINE_SYMBOL GtkWindow* create_notification(UrlClickedCb url_clicked);
+NOTIFY_ENGINE_SYMBOL void set_notification_text(GtkWindow *nw, const char *summary,
 			   const char *body);
-void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
-void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
-void add_notification_action(GtkWindow *nw, const char *text, const char *key,
+NOTIFY_ENGINE_SYMBOL void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
+NOTIFY_ENGINE_SYMBOL void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
+NOTIFY_ENGINE_SYMBOL void add_notification_action(GtkWindow *nw, const char *text, const char *key,
 			     ActionInvokedCb cb);
-void clear_notification_actions(GtkWindow *nw);
-void move_notification(GtkWidget *nw, int x, int y);
-void set_notification_timeout(GtkWindow *nw, glong timeout);
-void set_notification_hints(GtkWindow *nw, GHashTable *hints);
-void notification_tick(GtkWindow *nw, glong remaining);
+NOTIFY_ENGINE_SYMBOL void clear_notification_actions(GtkWindow *nw);
+NOTIFY_ENGINE_SYMBOL void move_notification(GtkWidget *nw, int x, int y);
+NOTIFY_ENGINE_SYMBOL void set_notification_timeout(GtkWindow *nw, glong timeout);
+NOTIFY_ENGINE_SYMBOL void set_notification_hints(GtkWindow *nw, GHashTable *hints);
+NOTIFY_ENGINE_SYMBOL void notification_tick(GtkWindow *nw, glong remaining);
 
 #define STRIPE_WIDTH  32
 #define WIDTH         400
@@ -238,9 +270,26 @@ set_arrow_parameters (WindowData *windata)
 	gtk_window_move(GTK_WINDOW(windata->win), x, y);
 }
 
+static void
+invalidate_background(WindowData *windata)
+{
+	if (windata->background != NULL)
+	{
+		cairo_surface_destroy(windata->background);
+		windata->background = NULL;
+	}
+
+	/* The pie cells are drawn over the same background */
+	notify_pie_atlas_clear(&windata->pie_atlas);
+}
+
 static void
 destroy_windata(WindowData *windata)
 {
+	notify_cache_remove((NotifyCacheReleaseFunc) invalidate_background, windata);
+	invalidate_background(windata);
+	notify_markup_unref(windata->body);
+	notify_action_pool_free(windata->actions);
 	g_free(windata);
 }
 
@@ -363,53 +412,33 @@ nodoka_rounded_rectangle_with_arrow (cairo_t * cr,
 
 }
 
-/* Fill background */
-static void
-fill_background(GtkWidget *widget, WindowData *windata, cairo_t *cr)
+/*
+ * Gradients shared by every notification on a screen. They are built for
+ * a height of 1 and scaled to the window when set as the source, so they
+ * only depend on whether the screen is composited.
+ */
+typedef struct
 {
-	float alpha;
-	if (windata->composited)
-		alpha = BACKGROUND_OPACITY;
-	else
-		alpha = 1.0;
+	GdkScreen *screen;
+	gboolean valid;
+	gboolean composited;
+	cairo_pattern_t *background;
+	cairo_pattern_t *border;
+	cairo_pattern_t *stripe[URGENCY_CRITICAL + 1];
 
-	cairo_pattern_t *pattern;
-	pattern = cairo_pattern_create_linear (0, 0, 0, windata->height);
-	cairo_pattern_add_color_stop_rgba (pattern, 0, 0.996, 0.996, 0.89, alpha);
-	cairo_pattern_add_color_stop_rgba (pattern, GRADIENT_CENTER, 0.988, 0.988, 0.714, alpha);
-	cairo_pattern_add_color_stop_rgba (pattern, 1, 0.984, 0.984, 0.663, alpha);
-	cairo_set_source (cr, pattern);
-	cairo_pattern_destroy (pattern);
-	
-	if (windata->arrow.has_arrow)
-		nodoka_rounded_rectangle_with_arrow (cr, 0, 0, 
-			windata->width, windata->height, 6, & (windata->arrow));
-	else
-		nodoka_rounded_rectangle (cr, 0, 0, windata->width, 
-			windata->height, 6);
-	cairo_fill (cr);	
-}
+} StyleCache;
 
+static StyleCache style_cache;
 
-static void
-draw_stripe(GtkWidget *widget, WindowData *windata, cairo_t *cr)
+static cairo_pattern_t *
+create_stripe_pattern(int urgency, float alpha)
 {
-	cairo_save (cr);
-	cairo_rectangle (cr, 0, 0, STRIPE_WIDTH, windata->height);
-	cairo_clip (cr);
-
 	gdouble  color_mult = 1.0;
 	GdkRGBA  top_color;
 	GdkRGBA  center_color;
 	GdkRGBA  bottom_color;
 
-	float alpha;
-	if (windata->composited)
-		alpha = BACKGROUND_OPACITY;
-	else
-		alpha = 1.0;
-
-	switch (windata->urgency)
+	switch (urgency)
 	{
 		case URGENCY_LOW: // LOW
 			alpha = alpha * 0.5;
@@ -452,12 +481,114 @@ draw_stripe(GtkWidget *widget, WindowData *windata, cairo_t *cr)
 
 
 	cairo_pattern_t *pattern;
-	pattern = cairo_pattern_create_linear (0, 0, 0, windata->height);
+	pattern = cairo_pattern_create_linear (0, 0, 0, 1);
 	cairo_pattern_add_color_stop_rgba (pattern, 0, top_color.red / color_mult, top_color.green / color_mult, top_color.blue / color_mult, alpha);
 	cairo_pattern_add_color_stop_rgba (pattern, GRADIENT_CENTER, bottom_color.red / color_mult, bottom_color.green / color_mult, bottom_color.blue / color_mult, alpha);
 	cairo_pattern_add_color_stop_rgba (pattern, 1, bottom_color.red / color_mult, bottom_color.green / color_mult, bottom_color.blue / color_mult, alpha);
+
+	return pattern;
+}
+
+static void
+clear_style_cache(void)
+{
+	int i;
+
+	if (!style_cache.valid)
+		return;
+
+	cairo_pattern_destroy (style_cache.background);
+	cairo_pattern_destroy (style_cache.border);
+
+	for (i = 0; i <= URGENCY_CRITICAL; i++)
+		cairo_pattern_destroy (style_cache.stripe[i]);
+
+	style_cache.valid = FALSE;
+}
+
+static const StyleCache *
+get_style_cache(WindowData *windata)
+{
+	GdkScreen *screen;
+	float alpha;
+	int i;
+
+	screen = gtk_widget_get_screen (windata->win);
+
+	if (style_cache.valid &&
+	    style_cache.screen == screen &&
+	    style_cache.composited == windata->composited)
+		return &style_cache;
+
+	clear_style_cache ();
+
+	if (windata->composited)
+		alpha = BACKGROUND_OPACITY;
+	else
+		alpha = 1.0;
+
+	style_cache.background = cairo_pattern_create_linear (0, 0, 0, 1);
+	cairo_pattern_add_color_stop_rgba (style_cache.background, 0, 0.996, 0.996, 0.89, alpha);
+	cairo_pattern_add_color_stop_rgba (style_cache.background, GRADIENT_CENTER, 0.988, 0.988, 0.714, alpha);
+	cairo_pattern_add_color_stop_rgba (style_cache.background, 1, 0.984, 0.984, 0.663, alpha);
+
+	style_cache.border = cairo_pattern_create_linear (0, 0, 0, 1);
+	cairo_pattern_add_color_stop_rgba (style_cache.border, 0, 0.62, 0.584, 0.341, alpha);
+	cairo_pattern_add_color_stop_rgba (style_cache.border, 1, 0.776, 0.757, 0.596, alpha);
+
+	for (i = 0; i <= URGENCY_CRITICAL; i++)
+		style_cache.stripe[i] = create_stripe_pattern (i, alpha);
+
+	style_cache.screen = screen;
+	style_cache.composited = windata->composited;
+	style_cache.valid = TRUE;
+
+	return &style_cache;
+}
+
+/* Set a shared gradient, stretched over the height of the window */
+static void
+set_source_gradient(cairo_t *cr, cairo_pattern_t *pattern, int height)
+{
+	cairo_matrix_t matrix;
+
+	cairo_get_matrix (cr, &matrix);
+	cairo_scale (cr, 1, MAX (height, 1));
 	cairo_set_source (cr, pattern);
-	cairo_pattern_destroy (pattern);
+	cairo_set_matrix (cr, &matrix);
+}
+
+/* Fill background */
+static void
+fill_background(GtkWidget *widget, WindowData *windata, cairo_t *cr)
+{
+	set_source_gradient (cr, get_style_cache (windata)->background, windata->height);
+	
+	if (windata->arrow.has_arrow)
+		nodoka_rounded_rectangle_with_arrow (cr, 0, 0, 
+			windata->width, windata->height, 6, & (windata->arrow));
+	else
+		nodoka_rounded_rectangle (cr, 0, 0, windata->width, 
+			windata->height, 6);
+	cairo_fill (cr);	
+}
+
+
+static void
+draw_stripe(GtkWidget *widget, WindowData *windata, cairo_t *cr)
+{
+	int urgency;
+
+	cairo_save (cr);
+	cairo_rectangle (cr, 0, 0, STRIPE_WIDTH, windata->height);
+	cairo_clip (cr);
+
+	urgency = windata->urgency;
+
+	if (urgency > URGENCY_CRITICAL)
+		urgency = URGENCY_NORMAL;
+
+	set_source_gradient (cr, get_style_cache (windata)->stripe[urgency], windata->height);
 
 	if (windata->arrow.has_arrow)
 		nodoka_rounded_rectangle_with_arrow (cr, 1, 1, 
@@ -473,18 +604,7 @@ draw_stripe(GtkWidget *widget, WindowData *windata, cairo_t *cr)
 static void
 draw_border(GtkWidget *widget, WindowData *windata, cairo_t *cr)
 {
-	float alpha;
-	if (windata->composited)
-		alpha = BACKGROUND_OPACITY;
-	else
-		alpha = 1.0;
-
-	cairo_pattern_t *pattern;
-	pattern = cairo_pattern_create_linear (0, 0, 0, windata->height);
-	cairo_pattern_add_color_stop_rgba (pattern, 0, 0.62, 0.584, 0.341, alpha);
-	cairo_pattern_add_color_stop_rgba (pattern, 1, 0.776, 0.757, 0.596, alpha);
-	cairo_set_source (cr, pattern);
-	cairo_pattern_destroy (pattern);
+	set_source_gradient (cr, get_style_cache (windata)->border, windata->height);
 	
 	if (windata->arrow.has_arrow)
 		nodoka_rounded_rectangle_with_arrow (cr, 0.5, 0.5, 
@@ -498,12 +618,12 @@ draw_border(GtkWidget *widget, WindowData *windata, cairo_t *cr)
 }
 
 static void
-draw_pie(GtkWidget *pie, WindowData *windata, cairo_t *cr)
+draw_pie(GtkWidget *pie, WindowData *windata, cairo_t *cr, gdouble fraction)
 {
-	if (windata->timeout == 0)
+	if (fraction < 0)
 		return;
 
-	gdouble arc_angle = 1.0 - (gdouble)windata->remaining / (gdouble)windata->timeout;
+	gdouble arc_angle = 1.0 - fraction;
 	cairo_set_source_rgba (cr, 1.0, 0.4, 0.0, 0.3);
 	cairo_move_to(cr, PIE_RADIUS, PIE_RADIUS);
 	cairo_arc_negative(cr, PIE_RADIUS, PIE_RADIUS, PIE_RADIUS,
@@ -514,36 +634,60 @@ draw_pie(GtkWidget *pie, WindowData *windata, cairo_t *cr)
 }
 
 static void
-update_shape_region (cairo_surface_t *surface,
-		     WindowData      *windata)
+update_shape_region (WindowData *windata)
 {
-	if (windata->width == windata->last_width && windata->height == windata->last_height)
+	NotifyShape shape;
+
+	if (windata->composited)
 	{
+		notify_shape_apply (windata->win, &windata->shape, NULL);
 		return;
 	}
 
 	if (windata->width == 0 || windata->height == 0)
 	{
-		GtkAllocation allocation;
-		gtk_widget_get_allocation (windata->win, &allocation);
-
-		windata->width = MAX (allocation.width, 1);
-		windata->height = MAX (allocation.height, 1);
+		return;
 	}
 
-	if (!windata->composited) {
-		cairo_region_t *region;
+	shape.body.x = 0;
+	shape.body.width = windata->width;
+	shape.body.y = 0;
+	shape.body.height = windata->height;
+	shape.radius = 6;
+	shape.has_arrow = windata->arrow.has_arrow;
 
-		region = gdk_cairo_region_create_from_surface (surface);
-		gtk_widget_shape_combine_region (windata->win, region);
-		cairo_region_destroy (region);
-	} else {
-		gtk_widget_shape_combine_region (windata->win, NULL);
-		return;
+	/* Same geometry as nodoka_rounded_rectangle_with_arrow() */
+	if (windata->arrow.has_arrow)
+	{
+		if (windata->arrow.point_begin.y > windata->arrow.point_middle.y)
+			shape.body.y = DEFAULT_ARROW_HEIGHT;
+
+		shape.body.height -= DEFAULT_ARROW_HEIGHT;
+		shape.arrow[0] = windata->arrow.point_begin;
+		shape.arrow[1] = windata->arrow.point_middle;
+		shape.arrow[2] = windata->arrow.point_end;
 	}
 
-	windata->last_width = windata->width;
-	windata->last_height = windata->height;
+	notify_shape_apply (windata->win, &windata->shape, &shape);
+}
+
+static void
+get_background_key (WindowData *windata, BackgroundKey *key)
+{
+	memset (key, 0, sizeof (BackgroundKey));
+
+	key->width = windata->width;
+	key->height = windata->height;
+	key->urgency = windata->urgency;
+	key->composited = windata->composited;
+	key->has_arrow = windata->arrow.has_arrow;
+
+	if (windata->arrow.has_arrow)
+	{
+		key->point_begin = windata->arrow.point_begin;
+		key->point_middle = windata->arrow.point_middle;
+		key->point_end = windata->arrow.point_end;
+	}
 }
 
 static void
@@ -552,8 +696,10 @@ paint_window (GtkWidget  *widget,
 	      WindowData *windata)
 {
 	cairo_t *cr2;
-	cairo_surface_t *surface;
 	GtkAllocation allocation;
+	BackgroundKey key;
+
+	notify_repaint_count_paint ();
 
 	if (windata->width == 0 || windata->height == 0) {
 		gtk_widget_get_allocation (windata->win, &allocation);
@@ -564,48 +710,52 @@ paint_window (GtkWidget  *widget,
 	if (windata->arrow.has_arrow)
 		set_arrow_parameters (windata);
 
-	surface = cairo_surface_create_similar (cairo_get_target (cr),
-						CAIRO_CONTENT_COLOR_ALPHA,
-						windata->width,
-						windata->height);
-
-	cr2 = cairo_create (surface);
-
-        /* transparent background */
-        cairo_rectangle (cr2, 0, 0, windata->width, windata->height);
-        cairo_set_source_rgba (cr2, 0.0, 0.0, 0.0, 0.0);
-        cairo_fill (cr2);
-
-	if (windata->arrow.has_arrow) {
-		nodoka_rounded_rectangle_with_arrow (cr2, 0, 0,
-						     windata->width,
-						     windata->height,
-						     6,
-						     & (windata->arrow));
-	} else {
-		nodoka_rounded_rectangle (cr2, 0, 0,
-					  windata->width,
-					  windata->height,
-					  6);
-	}
+	get_background_key (windata, &key);
+
+	if (windata->background == NULL ||
+	    memcmp (&key, &windata->background_key, sizeof (BackgroundKey)) != 0)
+	{
+		invalidate_background (windata);
+
+		windata->background = notify_cache_surface_new (cr, windata->width, windata->height);
+		windata->background_key = key;
+
+		cr2 = cairo_create (windata->background);
+
+		/* transparent background */
+		cairo_rectangle (cr2, 0, 0, windata->width, windata->height);
+		cairo_set_source_rgba (cr2, 0.0, 0.0, 0.0, 0.0);
+		cairo_fill (cr2);
+
+		if (windata->arrow.has_arrow) {
+			nodoka_rounded_rectangle_with_arrow (cr2, 0, 0,
+							     windata->width,
+							     windata->height,
+							     6,
+							     & (windata->arrow));
+		} else {
+			nodoka_rounded_rectangle (cr2, 0, 0,
+						  windata->width,
+						  windata->height,
+						  6);
+		}
 
-	cairo_fill (cr2);
+		cairo_fill (cr2);
 
-	fill_background(widget, windata, cr2);
-	draw_border(widget, windata, cr2);
-	draw_stripe(widget, windata, cr2);
+		fill_background(widget, windata, cr2);
+		draw_border(widget, windata, cr2);
+		draw_stripe(widget, windata, cr2);
 
-	cairo_destroy (cr2);
+		cairo_destroy (cr2);
+
+		update_shape_region (windata);
+	}
 
 	cairo_save (cr);
 	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-	cairo_set_source_surface (cr, surface, 0, 0);
+	cairo_set_source_surface (cr, windata->background, 0, 0);
 	cairo_paint (cr);
 	cairo_restore (cr);
-
-	update_shape_region (surface, windata);
-
-	cairo_surface_destroy (surface);
 }
 
 static gboolean
@@ -622,68 +772,66 @@ configure_event_cb(GtkWidget *nw,
 				   GdkEventConfigure *event,
 				   WindowData *windata)
 {
-	windata->width = event->width;
-	windata->height = event->height;
+	/* Moves, like those of stack shifts, leave everything drawn valid */
+	if (!notify_repaint_configure(&windata->width, &windata->height, event))
+		return FALSE;
 
+	/* The arrow side depends on the height */
 	update_spacers(nw);
-	gtk_widget_queue_draw(nw);
+	notify_repaint_queue(nw, NULL);
 
 	return FALSE;
 }
 
 static void on_composited_changed (GtkWidget* window, WindowData* windata)
 {
-	windata->composited = gdk_screen_is_composited (gtk_widget_get_screen(window));
+	windata->composited = notify_screen_is_composited (gtk_widget_get_screen(window));
 
 	gtk_widget_queue_draw (window);
 }
 
+static void
+draw_countdown_frame(cairo_t *cr,
+		     gdouble fraction,
+		     WindowData *windata)
+{
+	GtkAllocation alloc;
+
+	gtk_widget_get_allocation (windata->pie_countdown, &alloc);
+
+	cairo_translate (cr, -alloc.x, -alloc.y);
+	fill_background (windata->pie_countdown, windata, cr);
+	cairo_translate (cr, alloc.x, alloc.y);
+	draw_pie (windata->pie_countdown, windata, cr, fraction);
+	cairo_fill (cr);
+}
+
 static gboolean
 countdown_expose_cb(GtkWidget *pie,
 		    cairo_t *cr,
 		    WindowData *windata)
 {
-	cairo_t *cr2;
-	cairo_surface_t *surface;
 	GtkAllocation alloc;
 
 	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
 
 	gtk_widget_get_allocation (pie, &alloc);
 
-	surface = cairo_surface_create_similar (cairo_get_target (cr),
-					        CAIRO_CONTENT_COLOR_ALPHA,
-						alloc.width,
-						alloc.height);
-	cr2 = cairo_create (surface);
-
-	cairo_translate (cr2, -alloc.x, -alloc.y);
-	fill_background (pie, windata, cr2);
-	cairo_translate (cr2, alloc.x, alloc.y);
-	draw_pie (pie, windata, cr2);
-	cairo_fill (cr2);
+	/* The cells show the window background behind the pie */
+	if (alloc.x != windata->pie_x || alloc.y != windata->pie_y)
+	{
+		notify_pie_atlas_clear (&windata->pie_atlas);
+		windata->pie_x = alloc.x;
+		windata->pie_y = alloc.y;
+	}
 
-	cairo_destroy (cr2);
+	notify_pie_atlas_paint (&windata->pie_atlas, cr, alloc.width, alloc.height,
+							notify_pie_get_frame (windata->remaining, windata->timeout),
+							(NotifyPieDrawFunc) draw_countdown_frame, windata);
 
-	cairo_save (cr);
-	cairo_set_source_surface (cr, surface, 0, 0);
-	cairo_paint (cr);
-	cairo_restore (cr);
-
-	cairo_surface_destroy (surface);
 	return TRUE;
 }
 
-static void
-action_clicked_cb(GtkWidget *w, GdkEventButton *event,
-				  ActionInvokedCb action_cb)
-{
-	GtkWindow *nw   = g_object_get_data(G_OBJECT(w), "_nw");
-	const char *key = g_object_get_data(G_OBJECT(w), "_action_key");
-
-	action_cb(nw, key);
-}
-
 
 
 /* Required functions */
@@ -742,7 +890,7 @@ create_notification(UrlClickedCb url_clicked)
 	if (visual != NULL)
 	{
 		gtk_widget_set_visual(win, visual);
-		if (gdk_screen_is_composited(screen))
+		if (notify_screen_is_composited(screen))
 			windata->composited = TRUE;
 	}
 
@@ -754,6 +902,7 @@ create_notification(UrlClickedCb url_clicked)
 
 	g_object_set_data_full(G_OBJECT(win), "windata", windata,
 						   (GDestroyNotify)destroy_windata);
+	notify_cache_add((NotifyCacheReleaseFunc) invalidate_background, windata);
 	atk_object_set_role(gtk_widget_get_accessible(win), ATK_ROLE_ALERT);
 
 	g_signal_connect(G_OBJECT(win), "configure_event",
@@ -874,47 +1023,83 @@ create_notification(UrlClickedCb url_clicked)
 	gtk_widget_show(windata->actions_box);
 	gtk_box_pack_start(GTK_BOX(vbox), windata->actions_box, FALSE, TRUE, 0);
 
+	windata->actions = notify_action_pool_new(windata->actions_box, GTK_RELIEF_NORMAL);
+
 	return GTK_WINDOW(win);
 }
 
+/* Shared by all windows; the summary is plain text, the body markup */
+static PangoAttrList *summary_attrs = NULL;
+static NotifyMarkupCache *body_cache = NULL;
+
+static void
+init_text_attributes(void)
+{
+	PangoAttrList *body_attrs;
+
+	if (body_cache != NULL)
+		return;
+
+	summary_attrs = pango_attr_list_new ();
+	pango_attr_list_insert (summary_attrs, pango_attr_foreground_new (0, 0, 0));
+	pango_attr_list_insert (summary_attrs, pango_attr_weight_new (PANGO_WEIGHT_BOLD));
+	pango_attr_list_insert (summary_attrs, pango_attr_scale_new (PANGO_SCALE_LARGE));
+
+	body_attrs = pango_attr_list_new ();
+	pango_attr_list_insert (body_attrs, pango_attr_foreground_new (0, 0, 0));
+	body_cache = notify_markup_cache_new (body_attrs);
+	pango_attr_list_unref (body_attrs);
+}
+
+/* Size the icon box and the text for what the window shows */
+static void
+update_size(GtkWindow *nw)
+{
+	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
+	GdkPixbuf *pixbuf;
+	g_assert(windata != NULL);
+
+	pixbuf = gtk_image_get_pixbuf(GTK_IMAGE(windata->icon));
+
+	if (pixbuf != NULL)
+		gtk_widget_set_size_request(windata->iconbox,
+									MAX(BODY_X_OFFSET, gdk_pixbuf_get_width(pixbuf)), -1);
+	else
+		gtk_widget_set_size_request(windata->iconbox, BODY_X_OFFSET, -1);
+
+	update_content_hbox_visibility(windata);
+
+	gtk_widget_set_size_request(
+		(!gtk_widget_get_visible(windata->body_label)
+		 ? windata->body_label : windata->summary_label),
+		WIDTH - (IMAGE_SIZE + IMAGE_PADDING) - 10,
+		-1);
+}
+
 /* Set the notification text */
 void
 set_notification_text(GtkWindow *nw, const char *summary, const char *body)
 {
-	char *str;
-	char* quoted;
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
 	g_assert(windata != NULL);
 
-	quoted = g_markup_escape_text(summary, -1);
-	str = g_strdup_printf(
-		"<span color=\"#000000\"><b><big>%s</big></b></span>", quoted);
-	g_free(quoted);
-	gtk_label_set_markup(GTK_LABEL(windata->summary_label), str);
-	g_free(str);
+	init_text_attributes();
 
-	if (pango_parse_markup (body, -1, 0, NULL, NULL, NULL, NULL))
+	if (g_strcmp0(gtk_label_get_text(GTK_LABEL(windata->summary_label)), summary) != 0)
 	{
-		str = g_strdup_printf("<span color=\"#000000\">%s</span>", body);
-		gtk_label_set_markup (GTK_LABEL (windata->body_label), str);
-		g_free(str);
-	}
-	else {
-		gtk_label_set_text (GTK_LABEL (windata->body_label), body);
+		gtk_label_set_text(GTK_LABEL(windata->summary_label), summary);
+		gtk_label_set_attributes(GTK_LABEL(windata->summary_label), summary_attrs);
 	}
 
+	notify_markup_cache_set_label(body_cache, GTK_LABEL(windata->body_label), &windata->body, body);
+
 	if (body == NULL || *body == '\0')
 		gtk_widget_hide(windata->body_label);
 	else
 		gtk_widget_show(windata->body_label);
 
-	update_content_hbox_visibility(windata);
-
-	gtk_widget_set_size_request(
-		((body != NULL && *body == '\0')
-		 ? windata->body_label : windata->summary_label),
-		WIDTH - (IMAGE_SIZE + IMAGE_PADDING) - 10,
-		-1);
+	if (!notify_update_in_progress(nw))
+		update_size(nw);
 }
 
 /* Set notification icon */
@@ -927,20 +1112,12 @@ set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf)
 	gtk_image_set_from_pixbuf(GTK_IMAGE(windata->icon), pixbuf);
 
 	if (pixbuf != NULL)
-	{
-		int pixbuf_width = gdk_pixbuf_get_width(pixbuf);
-
 		gtk_widget_show(windata->icon);
-		gtk_widget_set_size_request(windata->iconbox,
-									MAX(BODY_X_OFFSET, pixbuf_width), -1);
-	}
 	else
-	{
 		gtk_widget_hide(windata->icon);
-		gtk_widget_set_size_request(windata->iconbox, BODY_X_OFFSET, -1);
-	}
 
-	update_content_hbox_visibility(windata);
+	if (!notify_update_in_progress(nw))
+		update_size(nw);
 }
 
 /* Set notification arrow */
@@ -948,13 +1125,21 @@ void
 set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y)
 {
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
+	gboolean changed;
 	g_assert(windata != NULL);
 
+	changed = windata->arrow.has_arrow != visible ||
+		(visible && (windata->arrow.position.x != x || windata->arrow.position.y != y));
+
 	windata->arrow.has_arrow = visible;
 	windata->arrow.position.x = x;
 	windata->arrow.position.y = y;
 
 	update_spacers(nw);
+
+	/* The border and the shape follow the arrow */
+	if (changed)
+		notify_repaint_queue(nw, NULL);
 }
 
 /* Add notification action */
@@ -963,85 +1148,30 @@ add_notification_action(GtkWindow *nw, const char *text, const char *key,
 						ActionInvokedCb cb)
 {
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
-	GtkWidget *label;
-	GtkWidget *button;
-	GtkWidget *hbox;
-	GdkPixbuf *pixbuf;
-	char *buf;
 
 	g_assert(windata != NULL);
 
-	if (gtk_widget_get_visible(windata->actions_box))
+	if (!gtk_widget_get_visible(windata->actions_box))
 	{
 		gtk_widget_show(windata->actions_box);
 		update_content_hbox_visibility(windata);
-
-		/* Don't try to re-add a pie_countdown */
-		if (!windata->pie_countdown) {
-			windata->pie_countdown = gtk_drawing_area_new();
-			gtk_widget_set_halign (windata->pie_countdown, GTK_ALIGN_END);
-			gtk_widget_show(windata->pie_countdown);
-
-			gtk_box_pack_end (GTK_BOX (windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
-			gtk_widget_set_size_request(windata->pie_countdown,
-						    PIE_WIDTH, PIE_HEIGHT);
-			g_signal_connect(G_OBJECT(windata->pie_countdown), "draw",
-					 G_CALLBACK(countdown_expose_cb), windata);
-		}
-	}
-
-	if (windata->action_icons) {
-		button = gtk_button_new_from_icon_name(key, GTK_ICON_SIZE_BUTTON);
-		goto add_button;
 	}
 
-	button = gtk_button_new();
-
-	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
-	gtk_widget_show(hbox);
-	gtk_container_add(GTK_CONTAINER(button), hbox);
-
-	/* Try to be smart and find a suitable icon. */
-	buf = g_strdup_printf("stock_%s", key);
-	pixbuf = gtk_icon_theme_load_icon(
-		gtk_icon_theme_get_for_screen(
-			gdk_window_get_screen(gtk_widget_get_window(GTK_WIDGET(nw)))),
-		buf, 16, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
-	g_free(buf);
-
-	if (pixbuf != NULL)
-	{
-		GtkWidget *image = gtk_image_new_from_pixbuf(pixbuf);
-		gtk_widget_show(image);
-		gtk_box_pack_start(GTK_BOX(hbox), image, FALSE, FALSE, 0);
-		gtk_widget_set_halign (image, GTK_ALIGN_CENTER);
-		gtk_widget_set_valign (image, GTK_ALIGN_CENTER);
+	/* The pie stays with the buttons when the actions are cleared */
+	if (!windata->pie_countdown) {
+		windata->pie_countdown = gtk_drawing_area_new();
+		gtk_widget_set_halign (windata->pie_countdown, GTK_ALIGN_END);
+		gtk_widget_show(windata->pie_countdown);
+
+		gtk_box_pack_end (GTK_BOX (windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
+		gtk_widget_set_size_request(windata->pie_countdown,
+					    PIE_WIDTH, PIE_HEIGHT);
+		g_signal_connect(G_OBJECT(windata->pie_countdown), "draw",
+				 G_CALLBACK(countdown_expose_cb), windata);
 	}
 
-	label = gtk_label_new(NULL);
-	gtk_widget_show(label);
-	gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
-#if GTK_CHECK_VERSION (3, 16, 0)
-	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
-	gtk_label_set_yalign (GTK_LABEL (label), 0.5);
-#else
-	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
-#endif
-	buf = g_strdup_printf("<small>%s</small>", text);
-	gtk_label_set_markup(GTK_LABEL(label), buf);
-	g_free(buf);
-
-add_button:
-	gtk_widget_show(button);
-	gtk_box_pack_start(GTK_BOX(windata->actions_box), button, FALSE, FALSE, 0);
-
-	g_object_set_data(G_OBJECT(button), "_nw", nw);
-	g_object_set_data_full(G_OBJECT(button),
-						   "_action_key", g_strdup(key), g_free);
-	g_signal_connect(G_OBJECT(button), "button-release-event",
-					 G_CALLBACK(action_clicked_cb), cb);
-
-	gtk_widget_show_all(windata->actions_box);
+	notify_action_pool_add(windata->actions, nw, text, key,
+						   windata->action_icons, (NotifyActionFunc)cb);
 }
 
 /* Clear notification actions */
@@ -1050,11 +1180,9 @@ clear_notification_actions(GtkWindow *nw)
 {
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
 
-	windata->pie_countdown = NULL;
-
+	/* Buttons are hidden, for the next actions to relabel */
 	gtk_widget_hide(windata->actions_box);
-	gtk_container_foreach(GTK_CONTAINER(windata->actions_box),
-						  (GtkCallback)gtk_widget_destroy, NULL);
+	notify_action_pool_clear(windata->actions);
 }
 
 /* Move notification window */
@@ -1130,9 +1258,90 @@ notification_tick(GtkWindow *nw, glong remaining)
 	WindowData *windata = g_object_get_data(G_OBJECT(nw), "windata");
 	windata->remaining = remaining;
 
-	if (windata->pie_countdown != NULL)
+	/* Only redraw when the pie actually moved on to another frame */
+	if (windata->pie_countdown != NULL &&
+		notify_pie_atlas_needs_redraw(&windata->pie_atlas, remaining, windata->timeout))
 	{
-		gtk_widget_queue_draw_area(windata->pie_countdown, 0, 0,
-								   PIE_WIDTH, PIE_HEIGHT);
+		GdkRectangle area = { 0, 0, PIE_WIDTH, PIE_HEIGHT };
+
+		notify_repaint_queue(windata->pie_countdown, &area);
 	}
 }
+
+static void set_content_hints(GtkWindow* nw, guint8 urgency, gboolean action_icons)
+{
+	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
+
+	g_assert(windata != NULL);
+
+	windata->urgency = urgency;
+	windata->action_icons = action_icons;
+	gtk_window_set_title(nw, urgency == URGENCY_CRITICAL ? "Critical Notification" : "Notification");
+}
+
+static const NotifyUpdateFuncs update_funcs = {
+	set_content_hints,
+	set_notification_text,
+	set_notification_icon,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	set_notification_timeout,
+	update_size
+};
+
+static void set_notification_content(GtkWindow* nw, const NotificationContent* content)
+{
+	notify_update_apply(nw, content, &update_funcs);
+}
+
+static const NotifyEngineVTable engine_vtable = {
+	sizeof(NotifyEngineVTable),
+	NOTIFY_ENGINE_ABI_VERSION,
+	0,
+
+	"Nodoka",
+	PACKAGE_VERSION,
+	"Martin Sourada",
+	"https://nodoka.fedorahosted.org/",
+
+	create_notification,
+	set_notification_text,
+	set_notification_icon,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, int, int)) move_notification,
+
+	NULL,
+	NULL,
+	NULL,
+	set_notification_hints,
+	set_notification_timeout,
+	notification_tick,
+	NULL,
+	set_notification_content,
+	notify_repaint_get_counts,
+	notify_cache_get_size,
+	notify_cache_release
+};
+
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE(guint abi_version)
+{
+	return &engine_vtable;
+}
+
+#ifndef NOTIFY_ENGINE_BUILTIN
+/* The shared gradients must not outlive the module */
+G_MODULE_EXPORT void
+g_module_unload(GModule *module)
+{
+	clear_style_cache();
+
+	if (summary_attrs != NULL)
+		pango_attr_list_unref(summary_attrs);
+
+	notify_markup_cache_free(body_cache);
+	notify_action_icon_cache_free();
+}
+#endif
@@ -25,6 +25,15 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
+#include "notify-engine.h"
+#include "actions.h"
+#include "cachemem.h"
+#include "markup.h"
+#include "pie.h"
+#include "repaint.h"
+#include "shape.h"
+#include "update.h"
+
 typedef void (*ActionInvokedCb) (GtkWindow* nw, const char* key);
 typedef void (*UrlClickedCb) (GtkWindow* nw, const char* url);
 
@@ -37,6 +46,7 @@ typedef struct {
 	GtkWidget* close_button;
 	GtkWidget* body_label;
 	GtkWidget* actions_box;
+	NotifyActionPool* actions;
 	GtkWidget* last_sep;
 	GtkWidget* pie_countdown;
 
@@ -46,8 +56,13 @@ typedef struct {
 
 	int width;
 	int height;
-	int last_width;
-	int last_height;
+	NotifyShapeCache shape;
+
+	cairo_surface_t* background;
+	int background_width;
+	int background_height;
+	NotifyPieAtlas pie_atlas;
+	NotifyMarkup* body;
 
 	guchar urgency;
 	glong timeout;
@@ -62,23 +77,23 @@ enum {
 	URGENCY_CRITICAL
 };
 
-gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
+NOTIFY_ENGINE_SYMBOL gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
 			  unsigned int micro_ver);
-void get_theme_info(char **theme_name, char **theme_ver, char **author,
+NOTIFY_ENGINE_SYMBOL void get_theme_info(char **theme_name, char **theme_ver, char **author,
 		    char **homepage);
-GtkWindow* create_notification(UrlClickedCb url_clicked);
-void set_notification_text(GtkWindow *nw, const char *summary,
+NOTIFY_ENGINE_SYMBOL GtkWindow* create_notification(UrlClickedCb url_clicked);
+NOTIFY_ENGINE_SYMBOL void set_notification_text(GtkWindow *nw, const char *summary,
 			   const char *body);
-void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
-void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
-void add_notification_action(GtkWindow *nw, const char *text, const char *key,
+NOTIFY_ENGINE_SYMBOL void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
+NOTIFY_ENGINE_SYMBOL void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
+NOTIFY_ENGINE_SYMBOL void add_notification_action(GtkWindow *nw, const char *text, const char *key,
 			     ActionInvokedCb cb);
-void clear_notification_actions(GtkWindow *nw);
-void move_notification(GtkWidget *nw, int x, int y);
-void set_notification_timeout(GtkWindow *nw, glong timeout);
-void set_notification_hints(GtkWindow *nw, GHashTable *hints);
-void notification_tick(GtkWindow *nw, glong remaining);
-gboolean get_always_stack(GtkWidget* nw);
+NOTIFY_ENGINE_SYMBOL void clear_notification_actions(GtkWindow *nw);
+NOTIFY_ENGINE_SYMBOL void move_notification(GtkWidget *nw, int x, int y);
+NOTIFY_ENGINE_SYMBOL void set_notification_timeout(GtkWindow *nw, glong timeout);
+NOTIFY_ENGINE_SYMBOL void set_notification_hints(GtkWindow *nw, GHashTable *hints);
+NOTIFY_ENGINE_SYMBOL void notification_tick(GtkWindow *nw, glong remaining);
+NOTIFY_ENGINE_SYMBOL gboolean get_always_stack(GtkWidget* nw);
 
 #define WIDTH          400
 #define DEFAULT_X0     0
@@ -142,111 +157,189 @@ get_background_color (GtkStyleContext *context,
     gdk_rgba_free (c);
 }
 
-static void fill_background(GtkWidget* widget, WindowData* windata, cairo_t* cr)
-{
-	GtkAllocation allocation;
-	GtkStyleContext *context;
-	GdkRGBA fg;
-	GdkRGBA bg;
+typedef struct {
+	GdkRGBA background;
+	GdkRGBA foreground;
+} WidgetColors;
 
-	gtk_widget_get_allocation(widget, &allocation);
+/*
+ * Theme colors are the same for every notification on a screen, so they
+ * are resolved once and shared until the next style-updated.
+ */
+typedef struct {
+	GdkScreen* screen;
+	gboolean valid;
+	WidgetColors window;
+	GdkRGBA pie;
+	gboolean pie_box_valid;
+	WidgetColors pie_box;
+} StyleCache;
 
-	draw_round_rect(cr, 1.0f, DEFAULT_X0 + 1, DEFAULT_Y0 + 1, DEFAULT_RADIUS, allocation.width - 2, allocation.height - 2);
+static StyleCache style_cache;
+
+static void get_widget_colors(GtkWidget* widget, WidgetColors* colors)
+{
+	GtkStyleContext *context;
 
 	context = gtk_widget_get_style_context(widget);
 
 	gtk_style_context_save (context);
 	gtk_style_context_set_state (context, GTK_STATE_FLAG_NORMAL);
 
-	get_background_color (context, GTK_STATE_FLAG_NORMAL, &bg);
-	gtk_style_context_get_color (context, GTK_STATE_FLAG_NORMAL, &fg);
+	get_background_color (context, GTK_STATE_FLAG_NORMAL, &colors->background);
+	gtk_style_context_get_color (context, GTK_STATE_FLAG_NORMAL, &colors->foreground);
 
 	gtk_style_context_restore (context);
+}
+
+static const StyleCache* get_style_cache(WindowData* windata)
+{
+	GtkStyleContext* context;
+	GdkScreen* screen;
+
+	screen = gtk_widget_get_screen(windata->win);
+
+	if (!style_cache.valid || style_cache.screen != screen)
+	{
+		get_widget_colors(windata->win, &style_cache.window);
+
+		context = gtk_widget_get_style_context(windata->win);
+
+		gtk_style_context_save (context);
+		gtk_style_context_set_state (context, GTK_STATE_FLAG_SELECTED);
+		get_background_color (context, GTK_STATE_FLAG_SELECTED, &style_cache.pie);
+		gtk_style_context_restore (context);
+
+		style_cache.screen = screen;
+		style_cache.valid = TRUE;
+		style_cache.pie_box_valid = FALSE;
+	}
 
-	cairo_set_source_rgba(cr, bg.red, bg.green, bg.blue, BACKGROUND_ALPHA);
+	/* The box around the pie takes the colors of the pie's own widget */
+	if (!style_cache.pie_box_valid && windata->pie_countdown != NULL)
+	{
+		get_widget_colors(windata->pie_countdown, &style_cache.pie_box);
+		style_cache.pie_box_valid = TRUE;
+	}
+
+	return &style_cache;
+}
+
+static void fill_background(GtkWidget* widget, const WidgetColors* colors, cairo_t* cr)
+{
+	GtkAllocation allocation;
+	const GdkRGBA* fg = &colors->foreground;
+	const GdkRGBA* bg = &colors->background;
+
+	gtk_widget_get_allocation(widget, &allocation);
+
+	draw_round_rect(cr, 1.0f, DEFAULT_X0 + 1, DEFAULT_Y0 + 1, DEFAULT_RADIUS, allocation.width - 2, allocation.height - 2);
+
+	cairo_set_source_rgba(cr, bg->red, bg->green, bg->blue, BACKGROUND_ALPHA);
 	cairo_fill_preserve(cr);
 
 	/* Should we show urgency somehow?  Probably doesn't
 	 * have any meaningful value to the user... */
 
-	cairo_set_source_rgba(cr, fg.red, fg.green, fg.blue, BACKGROUND_ALPHA);
+	cairo_set_source_rgba(cr, fg->red, fg->green, fg->blue, BACKGROUND_ALPHA);
 	cairo_set_line_width(cr, 1);
 	cairo_stroke(cr);
 }
 
 static void
-update_shape_region (cairo_surface_t *surface,
-                     WindowData      *windata)
+update_shape_region (WindowData *windata)
 {
-	if (windata->width == windata->last_width && windata->height == windata->last_height)
+	NotifyShape shape;
+
+	if (windata->composited)
 	{
+		notify_shape_apply (windata->win, &windata->shape, NULL);
 		return;
 	}
 
 	if (windata->width == 0 || windata->height == 0)
 	{
-		GtkAllocation allocation;
-		gtk_widget_get_allocation (windata->win, &allocation);
-
-		windata->width = MAX (allocation.width, 1);
-		windata->height = MAX (allocation.height, 1);
+		return;
 	}
 
-	if (!windata->composited) {
-		cairo_region_t *region;
+	shape.body.x = 0;
+	shape.body.width = windata->width;
+	shape.body.y = 0;
+	shape.body.height = windata->height;
+	/* The border is stroked half a pixel outside the drawn corner */
+	shape.radius = DEFAULT_RADIUS + 1;
+	shape.has_arrow = FALSE;
 
-		region = gdk_cairo_region_create_from_surface (surface);
-		gtk_widget_shape_combine_region (windata->win, region);
-		cairo_region_destroy (region);
-	} else {
-		gtk_widget_shape_combine_region (windata->win, NULL);
-		return;
+	notify_shape_apply (windata->win, &windata->shape, &shape);
+}
+
+static void invalidate_background(WindowData* windata)
+{
+	if (windata->background != NULL)
+	{
+		cairo_surface_destroy(windata->background);
+		windata->background = NULL;
 	}
 
-	windata->last_width = windata->width;
-	windata->last_height = windata->height;
+	/* The pie cells are drawn over the same background */
+	notify_pie_atlas_clear(&windata->pie_atlas);
 }
 
 static void paint_window (GtkWidget  *widget,
 			  cairo_t    *cr,
 			  WindowData *windata)
 {
-	cairo_surface_t *surface;
 	cairo_t *cr2;
 		GtkAllocation allocation;
 
 		gtk_widget_get_allocation (windata->win, &allocation);
 
+	notify_repaint_count_paint();
+
 	if (windata->width == 0 || windata->height == 0)
 	{
 		windata->width = MAX (allocation.width, 1);
 		windata->height = MAX (allocation.height, 1);
 	}
 
-	surface = cairo_surface_create_similar (cairo_get_target (cr),
-						CAIRO_CONTENT_COLOR_ALPHA,
-						windata->width,
-						windata->height);
+	/* Rebuilt on size changes here, and dropped on style or
+	 * compositing changes by the signal handlers below. */
+	if (windata->background == NULL ||
+	    windata->background_width != windata->width ||
+	    windata->background_height != windata->height)
+	{
+		invalidate_background (windata);
+
+		windata->background = notify_cache_surface_new (cr, windata->width, windata->height);
+		windata->background_width = windata->width;
+		windata->background_height = windata->height;
 
-	cr2 = cairo_create (surface);
+		cr2 = cairo_create (windata->background);
 
-	/* transparent background */
-	cairo_rectangle (cr2, 0, 0, windata->width, windata->height);
-	cairo_set_source_rgba (cr2, 0.0, 0.0, 0.0, 0.0);
-	cairo_fill (cr2);
+		/* transparent background */
+		cairo_rectangle (cr2, 0, 0, windata->width, windata->height);
+		cairo_set_source_rgba (cr2, 0.0, 0.0, 0.0, 0.0);
+		cairo_fill (cr2);
 
-	fill_background (widget, windata, cr2);
+		fill_background (widget, &get_style_cache (windata)->window, cr2);
 
-	cairo_destroy(cr2);
+		cairo_destroy(cr2);
+
+		update_shape_region (windata);
+	}
 
 	cairo_save (cr);
 	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-	cairo_set_source_surface(cr, surface, 0, 0);
+	cairo_set_source_surface(cr, windata->background, 0, 0);
 	cairo_paint(cr);
-	update_shape_region (surface, windata);
 	cairo_restore (cr);
+}
 
-	cairo_surface_destroy(surface);
+static gboolean activate_link(GtkLabel* label, const char* url, WindowData* windata)
+{
+	windata->url_clicked(GTK_WINDOW(windata->win), url);
+
+	return TRUE;
 }
 
 static gboolean on_window_map(GtkWidget* widget, GdkEvent* event, WindowData* windata)
@@ -266,6 +359,10 @@ on_draw (GtkWidget  *widget,
 
 static void destroy_windata(WindowData* windata)
 {
+	notify_cache_remove((NotifyCacheReleaseFunc) invalidate_background, windata);
+	invalidate_background(windata);
+	notify_markup_unref(windata->body);
+	notify_action_pool_free(windata->actions);
 	g_free(windata);
 }
 
@@ -283,10 +380,11 @@ static void update_content_hbox_visibility(WindowData* windata)
 
 static gboolean on_configure_event(GtkWidget* widget, GdkEventConfigure* event, WindowData* windata)
 {
-	windata->width = event->width;
-	windata->height = event->height;
-
-	gtk_widget_queue_draw(widget);
+	/* Moves, like those of stack shifts, leave everything drawn valid */
+	if (notify_repaint_configure(&windata->width, &windata->height, event))
+	{
+		notify_repaint_queue(widget, NULL);
+	}
 
 	return FALSE;
 }
@@ -298,7 +396,17 @@ static void on_window_realize(GtkWidget* widget, WindowData* windata)
 
 static void on_composited_changed(GtkWidget* window, WindowData* windata)
 {
-	windata->composited = gdk_screen_is_composited(gtk_widget_get_screen(window));
+	windata->composited = notify_screen_is_composited(gtk_widget_get_screen(window));
+
+	invalidate_background(windata);
+
+	gtk_widget_queue_draw (windata->win);
+}
+
+static void on_style_updated(GtkWidget* window, WindowData* windata)
+{
+	style_cache.valid = FALSE;
+	invalidate_background(windata);
 
 	gtk_widget_queue_draw (windata->win);
 }
@@ -337,19 +445,21 @@ GtkWindow* create_notification(UrlClickedCb url_clicked)
 	{
 		gtk_widget_set_visual(win, visual);
 
-		if (gdk_screen_is_composited(screen))
+		if (notify_screen_is_composited(screen))
 		{
 			windata->composited = TRUE;
 		}
 	}
 
 	g_signal_connect(win, "composited-changed", G_CALLBACK(on_composited_changed), windata);
+	g_signal_connect(win, "style-updated", G_CALLBACK(on_style_updated), windata);
 
 	gtk_window_set_title(GTK_WINDOW(win), "Notification");
 	gtk_window_set_type_hint(GTK_WINDOW(win), GDK_WINDOW_TYPE_HINT_NOTIFICATION);
 	gtk_widget_add_events(win, GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK);
 
 	g_object_set_data_full(G_OBJECT(win), "windata", windata, (GDestroyNotify) destroy_windata);
+	notify_cache_add((NotifyCacheReleaseFunc) invalidate_background, windata);
 	atk_object_set_role(gtk_widget_get_accessible(win), ATK_ROLE_ALERT);
 
 	g_signal_connect(G_OBJECT(win), "configure-event", G_CALLBACK(on_configure_event), windata);
@@ -437,7 +547,7 @@ GtkWindow* create_notification(UrlClickedCb url_clicked)
 	gtk_label_set_line_wrap(GTK_LABEL(windata->body_label), TRUE);
 	gtk_label_set_line_wrap_mode (GTK_LABEL (windata->body_label), PANGO_WRAP_WORD_CHAR);
     gtk_label_set_max_width_chars (GTK_LABEL (windata->body_label), 50);
-	g_signal_connect_swapped(G_OBJECT(windata->body_label), "activate-link", G_CALLBACK(windata->url_clicked), win);
+	g_signal_connect(G_OBJECT(windata->body_label), "activate-link", G_CALLBACK(activate_link), windata);
 
 	atkobj = gtk_widget_get_accessible(windata->body_label);
 	atk_object_set_description (atkobj, _("Notification body text."));
@@ -448,6 +558,8 @@ GtkWindow* create_notification(UrlClickedCb url_clicked)
 
 	gtk_box_pack_start (GTK_BOX (vbox), windata->actions_box, FALSE, TRUE, 0);
 
+	windata->actions = notify_action_pool_new(windata->actions_box, GTK_RELIEF_NONE);
+
 	return GTK_WINDOW(win);
 }
 
@@ -494,46 +606,52 @@ void notification_tick(GtkWindow* nw, glong remaining)
 
 	windata->remaining = remaining;
 
-	if (windata->pie_countdown != NULL)
+	/* Only redraw when the pie actually moved on to another frame */
+	if (windata->pie_countdown != NULL && notify_pie_atlas_needs_redraw(&windata->pie_atlas, remaining, windata->timeout))
 	{
-		gtk_widget_queue_draw_area(windata->pie_countdown, 0, 0, PIE_WIDTH, PIE_HEIGHT);
+		GdkRectangle area = { 0, 0, PIE_WIDTH, PIE_HEIGHT };
+
+		notify_repaint_queue(windata->pie_countdown, &area);
 	}
 }
 
-void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
+/* Shared by all windows; the summary is plain text, the body markup */
+static PangoAttrList* summary_attrs = NULL;
+static NotifyMarkupCache* body_cache = NULL;
+
+static void init_text_attributes(void)
 {
-	char* str;
-	char* quoted;
-	GtkRequisition req;
-	WindowData* windata;
-	int summary_width;
+	if (body_cache != NULL)
+	{
+		return;
+	}
 
-	windata = g_object_get_data(G_OBJECT(nw), "windata");
+	summary_attrs = pango_attr_list_new();
+	pango_attr_list_insert(summary_attrs, pango_attr_weight_new(PANGO_WEIGHT_BOLD));
+	pango_attr_list_insert(summary_attrs, pango_attr_scale_new(PANGO_SCALE_LARGE));
 
-	g_assert(windata != NULL);
+	body_cache = notify_markup_cache_new(NULL);
+}
 
-	quoted = g_markup_escape_text(summary, -1);
-	str = g_strdup_printf("<b><big>%s</big></b>", quoted);
-	g_free(quoted);
+/* Sizes the icon and the labels for what the window shows */
+static void update_size(GtkWindow* nw)
+{
+	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
+	GtkRequisition req;
+	GdkPixbuf* pixbuf;
+	int summary_width;
 
-	gtk_label_set_markup(GTK_LABEL(windata->summary_label), str);
-	g_free(str);
+	g_assert(windata != NULL);
 
-	if (pango_parse_markup (body, -1, 0, NULL, NULL, NULL, NULL))
-	{
-		gtk_label_set_markup (GTK_LABEL (windata->body_label), body);
-	}
-	else {
-		gtk_label_set_text (GTK_LABEL (windata->body_label), body);
-	}
+	pixbuf = gtk_image_get_pixbuf(GTK_IMAGE(windata->icon));
 
-	if (body == NULL || *body == '\0')
+	if (pixbuf != NULL)
 	{
-		gtk_widget_hide(windata->body_label);
+		gtk_widget_set_size_request(windata->icon, MAX(BODY_X_OFFSET, gdk_pixbuf_get_width(pixbuf)), -1);
 	}
 	else
 	{
-		gtk_widget_show(windata->body_label);
+		gtk_widget_set_size_request(windata->icon, BODY_X_OFFSET, -1);
 	}
 
 	update_content_hbox_visibility(windata);
@@ -544,7 +662,7 @@ void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
 	   -6: spacing for hbox */
 	summary_width = WIDTH - (1 * 2) - (10 * 2) - BODY_X_OFFSET - req.width - (6 * 2);
 
-	if (body != NULL && *body != '\0')
+	if (gtk_widget_get_visible(windata->body_label))
 	{
 		gtk_widget_set_size_request(windata->body_label, summary_width, -1);
 	}
@@ -552,6 +670,39 @@ void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
 	gtk_widget_set_size_request(windata->summary_label, summary_width, -1);
 }
 
+void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
+{
+	WindowData* windata;
+
+	windata = g_object_get_data(G_OBJECT(nw), "windata");
+
+	g_assert(windata != NULL);
+
+	init_text_attributes();
+
+	if (g_strcmp0(gtk_label_get_text(GTK_LABEL(windata->summary_label)), summary) != 0)
+	{
+		gtk_label_set_text(GTK_LABEL(windata->summary_label), summary);
+		gtk_label_set_attributes(GTK_LABEL(windata->summary_label), summary_attrs);
+	}
+
+	notify_markup_cache_set_label(body_cache, GTK_LABEL(windata->body_label), &windata->body, body);
+
+	if (body == NULL || *body == '\0')
+	{
+		gtk_widget_hide(windata->body_label);
+	}
+	else
+	{
+		gtk_widget_show(windata->body_label);
+	}
+
+	if (!notify_update_in_progress(nw))
+	{
+		update_size(nw);
+	}
+}
+
 static GdkPixbuf* scale_pixbuf(GdkPixbuf* pixbuf, int max_width, int max_height, gboolean no_stretch_hint)
 {
 	float scale_factor_x = 1.0;
@@ -608,20 +759,18 @@ void set_notification_icon(GtkWindow* nw, GdkPixbuf* pixbuf)
 
 	if (scaled != NULL)
 	{
-		int pixbuf_width = gdk_pixbuf_get_width(scaled);
-
 		gtk_widget_show(windata->icon);
-		gtk_widget_set_size_request(windata->icon, MAX(BODY_X_OFFSET, pixbuf_width), -1);
 		g_object_unref(scaled);
 	}
 	else
 	{
 		gtk_widget_hide(windata->icon);
-
-		gtk_widget_set_size_request(windata->icon, BODY_X_OFFSET, -1);
 	}
 
-	update_content_hbox_visibility(windata);
+	if (!notify_update_in_progress(nw))
+	{
+		update_size(nw);
+	}
 }
 
 void set_notification_arrow(GtkWidget* nw, gboolean visible, int x, int y)
@@ -632,56 +781,42 @@ void set_notification_arrow(GtkWidget* nw, gboolean visible, int x, int y)
 }
 
 static void
-paint_countdown (GtkWidget  *pie,
-                 cairo_t* cr,
-                 WindowData* windata)
+draw_countdown_frame (cairo_t* cr,
+                      gdouble fraction,
+                      WindowData* windata)
 {
-	GtkStyleContext* context;
-	GdkRGBA bg;
-	GtkAllocation allocation;
-	cairo_t* cr2;
-	cairo_surface_t* surface;
+	const StyleCache* style;
 
-	context = gtk_widget_get_style_context(windata->win);
+	style = get_style_cache (windata);
 
-	gtk_style_context_save (context);
-	gtk_style_context_set_state (context, GTK_STATE_FLAG_SELECTED);
-
-	get_background_color (context, GTK_STATE_FLAG_SELECTED, &bg);
-
-	gtk_style_context_restore (context);
+	fill_background (windata->pie_countdown, &style->pie_box, cr);
 
-	gtk_widget_get_allocation(pie, &allocation);
-	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-	surface = cairo_surface_create_similar(cairo_get_target(cr),
-                                           CAIRO_CONTENT_COLOR_ALPHA,
-                                           allocation.width,
-                                           allocation.height);
-
-	cr2 = cairo_create (surface);
-
-	fill_background (pie, windata, cr2);
-
-	if (windata->timeout > 0)
+	if (fraction < 0)
 	{
-		gdouble pct = (gdouble) windata->remaining / (gdouble) windata->timeout;
+		return;
+	}
 
-		gdk_cairo_set_source_rgba (cr2, &bg);
+	gdk_cairo_set_source_rgba (cr, &style->pie);
 
-		cairo_move_to (cr2, PIE_RADIUS, PIE_RADIUS);
-		cairo_arc_negative (cr2, PIE_RADIUS, PIE_RADIUS, PIE_RADIUS, -G_PI_2, -(pct * G_PI * 2) - G_PI_2);
-		cairo_line_to (cr2, PIE_RADIUS, PIE_RADIUS);
-		cairo_fill (cr2);
-	}
+	cairo_move_to (cr, PIE_RADIUS, PIE_RADIUS);
+	cairo_arc_negative (cr, PIE_RADIUS, PIE_RADIUS, PIE_RADIUS, -G_PI_2, -(fraction * G_PI * 2) - G_PI_2);
+	cairo_line_to (cr, PIE_RADIUS, PIE_RADIUS);
+	cairo_fill (cr);
+}
 
-	cairo_destroy(cr2);
+static void
+paint_countdown (GtkWidget  *pie,
+                 cairo_t* cr,
+                 WindowData* windata)
+{
+	GtkAllocation allocation;
 
-	cairo_save (cr);
-	cairo_set_source_surface (cr, surface, 0, 0);
-	cairo_paint (cr);
-	cairo_restore (cr);
+	gtk_widget_get_allocation(pie, &allocation);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
 
-	cairo_surface_destroy(surface);
+	notify_pie_atlas_paint (&windata->pie_atlas, cr, allocation.width, allocation.height,
+	                        notify_pie_get_frame (windata->remaining, windata->timeout),
+	                        (NotifyPieDrawFunc) draw_countdown_frame, windata);
 }
 
 static gboolean
@@ -692,22 +827,9 @@ on_countdown_draw (GtkWidget *widget, cairo_t *cr, WindowData *windata)
 	return FALSE;
 }
 
-static void on_action_clicked(GtkWidget* w, GdkEventButton *event, ActionInvokedCb action_cb)
-{
-	GtkWindow* nw = g_object_get_data(G_OBJECT(w), "_nw");
-	const char* key = g_object_get_data(G_OBJECT(w), "_action_key");
-
-	action_cb(nw, key);
-}
-
 void add_notification_action(GtkWindow* nw, const char* text, const char* key, ActionInvokedCb cb)
 {
 	WindowData* windata;
-	GtkWidget* label;
-	GtkWidget* button;
-	GtkWidget* hbox;
-	GdkPixbuf* pixbuf;
-	char* buf;
 
 	windata = g_object_get_data(G_OBJECT(nw), "windata");
 
@@ -717,82 +839,31 @@ void add_notification_action(GtkWindow* nw, const char* text, const char* key, A
 	{
 		gtk_widget_show(windata->actions_box);
 		update_content_hbox_visibility(windata);
-
-		/* Don't try to re-add a pie_countdown */
-		if (!windata->pie_countdown) {
-			windata->pie_countdown = gtk_drawing_area_new();
-			gtk_widget_set_halign (windata->pie_countdown, GTK_ALIGN_END);
-			gtk_widget_set_valign (windata->pie_countdown, GTK_ALIGN_CENTER);
-			gtk_widget_show(windata->pie_countdown);
-
-			gtk_box_pack_end (GTK_BOX (windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
-			gtk_widget_set_size_request(windata->pie_countdown,
-						    PIE_WIDTH, PIE_HEIGHT);
-			g_signal_connect(G_OBJECT(windata->pie_countdown), "draw",
-					 G_CALLBACK(on_countdown_draw), windata);
-		}
 	}
 
-	if (windata->action_icons) {
-		button = gtk_button_new_from_icon_name(key, GTK_ICON_SIZE_BUTTON);
-		goto add_button;
-	}
-
-	button = gtk_button_new();
-	gtk_widget_show(button);
-
-	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
-	gtk_widget_show(hbox);
-	gtk_container_add(GTK_CONTAINER(button), hbox);
-
-	/* Try to be smart and find a suitable icon. */
-	buf = g_strdup_printf("stock_%s", key);
-	pixbuf = gtk_icon_theme_load_icon(gtk_icon_theme_get_for_screen(gdk_window_get_screen(gtk_widget_get_window(GTK_WIDGET(nw)))),
-									  buf, 16, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
-	g_free(buf);
-
-	if (pixbuf != NULL)
+	/* The pie stays with the buttons when the actions are cleared */
+	if (windata->pie_countdown == NULL)
 	{
-		GtkWidget* image = gtk_image_new_from_pixbuf(pixbuf);
-		gtk_widget_show(image);
-		gtk_box_pack_start(GTK_BOX(hbox), image, FALSE, FALSE, 0);
-		gtk_widget_set_halign (image, GTK_ALIGN_CENTER);
-		gtk_widget_set_valign (image, GTK_ALIGN_CENTER);
+		windata->pie_countdown = gtk_drawing_area_new();
+		gtk_widget_set_halign(windata->pie_countdown, GTK_ALIGN_END);
+		gtk_widget_set_valign(windata->pie_countdown, GTK_ALIGN_CENTER);
+		gtk_widget_show(windata->pie_countdown);
+
+		gtk_box_pack_end(GTK_BOX(windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
+		gtk_widget_set_size_request(windata->pie_countdown, PIE_WIDTH, PIE_HEIGHT);
+		g_signal_connect(G_OBJECT(windata->pie_countdown), "draw", G_CALLBACK(on_countdown_draw), windata);
 	}
 
-	label = gtk_label_new(NULL);
-	gtk_widget_show(label);
-	gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
-#if GTK_CHECK_VERSION (3, 16, 0)
-	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
-	gtk_label_set_yalign (GTK_LABEL (label), 0.5);
-#else
-	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
-#endif
-	buf = g_strdup_printf("<small>%s</small>", text);
-	gtk_label_set_markup(GTK_LABEL(label), buf);
-	g_free(buf);
-
-add_button:
-	gtk_box_pack_start(GTK_BOX(windata->actions_box), button, FALSE, FALSE, 0);
-	gtk_button_set_relief(GTK_BUTTON(button), GTK_RELIEF_NONE);
-	gtk_container_set_border_width(GTK_CONTAINER(button), 0);
-
-	g_object_set_data(G_OBJECT(button), "_nw", nw);
-	g_object_set_data_full(G_OBJECT(button), "_action_key", g_strdup(key), g_free);
-	g_signal_connect(G_OBJECT(button), "button-release-event", G_CALLBACK(on_action_clicked), cb);
-
-	gtk_widget_show_all(windata->actions_box);
+	notify_action_pool_add(windata->actions, nw, text, key, windata->action_icons, (NotifyActionFunc) cb);
 }
 
 void clear_notification_actions(GtkWindow* nw)
 {
 	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
 
-	windata->pie_countdown = NULL;
-
+	/* Buttons are hidden, for the next actions to relabel */
 	gtk_widget_hide(windata->actions_box);
-	gtk_container_foreach(GTK_CONTAINER(windata->actions_box), (GtkCallback) gtk_widget_destroy, NULL);
+	notify_action_pool_clear(windata->actions);
 }
 
 void move_notification(GtkWidget* widget, int x, int y)
@@ -821,3 +892,80 @@ gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver, unsign
 {
 	return major_ver == NOTIFICATION_DAEMON_MAJOR_VERSION && minor_ver == NOTIFICATION_DAEMON_MINOR_VERSION && micro_ver == NOTIFICATION_DAEMON_MICRO_VERSION;
 }
+
+static void set_content_hints(GtkWindow* nw, guint8 urgency, gboolean action_icons)
+{
+	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
+
+	g_assert(windata != NULL);
+
+	windata->urgency = urgency;
+	windata->action_icons = action_icons;
+	gtk_window_set_title(nw, urgency == URGENCY_CRITICAL ? "Critical Notification" : "Notification");
+}
+
+static const NotifyUpdateFuncs update_funcs = {
+	set_content_hints,
+	set_notification_text,
+	set_notification_icon,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	set_notification_timeout,
+	update_size
+};
+
+static void set_notification_content(GtkWindow* nw, const NotificationContent* content)
+{
+	notify_update_apply(nw, content, &update_funcs);
+}
+
+static const NotifyEngineVTable engine_vtable = {
+	sizeof(NotifyEngineVTable),
+	NOTIFY_ENGINE_ABI_VERSION,
+	0,
+
+	"Slider",
+	PACKAGE_VERSION,
+	"William Jon McCann",
+	"http://www.gnome.org/",
+
+	create_notification,
+	set_notification_text,
+	set_notification_icon,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, int, int)) move_notification,
+
+	NULL,
+	NULL,
+	NULL,
+	set_notification_hints,
+	set_notification_timeout,
+	notification_tick,
+	(gboolean (*) (GtkWindow*)) get_always_stack,
+	set_notification_content,
+	notify_repaint_get_counts,
+	notify_cache_get_size,
+	notify_cache_release
+};
+
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE(guint abi_version)
+{
+	return &engine_vtable;
+}
+
+#ifndef NOTIFY_ENGINE_BUILTIN
+/* The shared text attributes must not outlive the module */
+G_MODULE_EXPORT void g_module_unload(GModule* module)
+{
+	if (summary_attrs != NULL)
+	{
+		pango_attr_list_unref(summary_attrs);
+	}
+
+	notify_markup_cache_free(body_cache);
+	notify_action_icon_cache_free();
+}
+#endif
@@ -21,12 +21,39 @@
  */
 #include "config.h"
 
+#include <string.h>
+
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
+#include "notify-engine.h"
+#include "actions.h"
+#include "cachemem.h"
+#include "markup.h"
+#include "pie.h"
+#include "repaint.h"
+#include "shape.h"
+#include "update.h"
+
 typedef void (*ActionInvokedCb) (GtkWindow* nw, const char* key);
 typedef void (*UrlClickedCb) (GtkWindow* nw, const char* url);
 
+/* Everything the cached background depends on, apart from the style
+ * colors, which drop the cache through style-updated instead. */
+typedef struct {
+	int width;
+	int height;
+	int stripe_x;
+	int stripe_y;
+	int stripe_height;
+	int rtl;
+	int has_arrow;
+	int point_x;
+	int point_y;
+	int urgency;
+	int composited;
+} BackgroundKey;
+
 typedef struct {
 	GtkWidget* win;
 	GtkWidget* top_spacer;
@@ -39,6 +66,7 @@ typedef struct {
 	GtkWidget* close_button;
 	GtkWidget* body_label;
 	GtkWidget* actions_box;
+	NotifyActionPool* actions;
 	GtkWidget* last_sep;
 	GtkWidget* stripe_spacer;
 	GtkWidget* pie_countdown;
@@ -63,7 +91,12 @@ typedef struct {
 	GdkPoint* border_points;
 	size_t num_border_points;
 
-	cairo_region_t *window_region;
+	NotifyShapeCache shape;
+
+	cairo_surface_t* background;
+	BackgroundKey background_key;
+	NotifyPieAtlas pie_atlas;
+	NotifyMarkup* body;
 
 	guchar urgency;
 	glong timeout;
@@ -79,22 +112,22 @@ enum {
 	URGENCY_CRITICAL
 };
 
-gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
+NOTIFY_ENGINE_SYMBOL gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver,
 			  unsigned int micro_ver);
-void get_theme_info(char **theme_name, char **theme_ver, char **author,
+NOTIFY_ENGINE_SYMBOL void get_theme_info(char **theme_name, char **theme_ver, char **author,
 		    char **homepage);
-GtkWindow* create_notification(UrlClickedCb url_clicked);
-void set_notification_text(GtkWindow *nw, const char *summary,
+NOTIFY_ENGINE_SYMBOL GtkWindow* create_notification(UrlClickedCb url_clicked);
+NOTIFY_ENGINE_SYMBOL void set_notification_text(GtkWindow *nw, const char *summary,
 			   const char *body);
-void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
-void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
-void add_notification_action(GtkWindow *nw, const char *text, const char *key,
+NOTIFY_ENGINE_SYMBOL void set_notification_icon(GtkWindow *nw, GdkPixbuf *pixbuf);
+NOTIFY_ENGINE_SYMBOL void set_notification_arrow(GtkWidget *nw, gboolean visible, int x, int y);
+NOTIFY_ENGINE_SYMBOL void add_notification_action(GtkWindow *nw, const char *text, const char *key,
 			     ActionInvokedCb cb);
-void clear_notification_actions(GtkWindow *nw);
-void move_notification(GtkWidget *nw, int x, int y);
-void set_notification_timeout(GtkWindow *nw, glong timeout);
-void set_notification_hints(GtkWindow *nw, GHashTable *hints);
-void notification_tick(GtkWindow *nw, glong remaining);
+NOTIFY_ENGINE_SYMBOL void clear_notification_actions(GtkWindow *nw);
+NOTIFY_ENGINE_SYMBOL void move_notification(GtkWidget *nw, int x, int y);
+NOTIFY_ENGINE_SYMBOL void set_notification_timeout(GtkWindow *nw, glong timeout);
+NOTIFY_ENGINE_SYMBOL void set_notification_hints(GtkWindow *nw, GHashTable *hints);
+NOTIFY_ENGINE_SYMBOL void notification_tick(GtkWindow *nw, glong remaining);
 
 //#define ENABLE_GRADIENT_LOOK
 
@@ -136,10 +169,73 @@ get_background_color (GtkStyleContext *context,
         gdk_rgba_free (c);
 }
 
+/*
+ * Theme colors are the same for every notification on a screen, so they
+ * are resolved once and shared until the next style-updated.
+ */
+typedef struct {
+	GdkScreen* screen;
+	gboolean valid;
+	GdkRGBA background;
+	GdkRGBA stripe_low;
+	GdkRGBA stripe_normal;
+	GdkRGBA stripe_critical;
+	GdkRGBA pie;
+} StyleCache;
+
+static StyleCache style_cache;
+
+static const StyleCache* get_style_cache(WindowData* windata)
+{
+	GtkStyleContext* context;
+	GdkScreen* screen;
+
+	screen = gtk_widget_get_screen(windata->win);
+
+	if (style_cache.valid && style_cache.screen == screen)
+	{
+		return &style_cache;
+	}
+
+	context = gtk_widget_get_style_context(windata->win);
+
+	gtk_style_context_save(context);
+	gtk_style_context_set_state(context, GTK_STATE_FLAG_NORMAL);
+	get_background_color(context, GTK_STATE_FLAG_NORMAL, &style_cache.background);
+	gtk_style_context_restore(context);
+
+	gtk_style_context_save(context);
+	gtk_style_context_set_state(context, GTK_STATE_FLAG_SELECTED);
+	get_background_color(context, GTK_STATE_FLAG_SELECTED, &style_cache.pie);
+	gtk_style_context_restore(context);
+
+	/* The stripe is drawn on the main box, in the view style */
+	context = gtk_widget_get_style_context(gtk_bin_get_child(GTK_BIN(windata->win)));
+
+	gtk_style_context_save(context);
+	gtk_style_context_set_state(context, GTK_STATE_FLAG_NORMAL);
+	gtk_style_context_add_class(context, GTK_STYLE_CLASS_VIEW);
+	get_background_color(context, GTK_STATE_FLAG_NORMAL, &style_cache.stripe_low);
+	gtk_style_context_restore(context);
+
+	gtk_style_context_save(context);
+	gtk_style_context_set_state(context, GTK_STATE_FLAG_SELECTED);
+	gtk_style_context_add_class(context, GTK_STYLE_CLASS_VIEW);
+	get_background_color(context, GTK_STATE_FLAG_SELECTED, &style_cache.stripe_normal);
+	gtk_style_context_restore(context);
+
+	gdk_rgba_parse(&style_cache.stripe_critical, "#CC0000");
+
+	style_cache.screen = screen;
+	style_cache.valid = TRUE;
+
+	return &style_cache;
+}
+
 static void fill_background(GtkWidget* widget, WindowData* windata, cairo_t* cr)
 {
-    GtkStyleContext *context;
-    GdkRGBA bg;
+    const StyleCache* style;
+    const GdkRGBA* bg;
 
     GtkAllocation allocation;
 
@@ -154,22 +250,16 @@ static void fill_background(GtkWidget* widget, WindowData* windata, cairo_t* cr)
 
     #endif
 
-    context = gtk_widget_get_style_context (windata->win);
-
-    gtk_style_context_save (context);
-    gtk_style_context_set_state (context, GTK_STATE_FLAG_NORMAL);
-
-    get_background_color (context, GTK_STATE_FLAG_NORMAL, &bg);
-
-    gtk_style_context_restore (context);
+    style = get_style_cache (windata);
+    bg = &style->background;
 
     if (windata->composited)
     {
-        cairo_set_source_rgba(cr, bg.red, bg.green, bg.blue, BACKGROUND_OPACITY);
+        cairo_set_source_rgba(cr, bg->red, bg->green, bg->blue, BACKGROUND_OPACITY);
     }
     else
     {
-        gdk_cairo_set_source_rgba (cr, &bg);
+        gdk_cairo_set_source_rgba (cr, bg);
     }
 
     cairo_rectangle(cr, 0, 0, allocation.width, allocation.height);
@@ -191,7 +281,7 @@ static void fill_background(GtkWidget* widget, WindowData* windata, cairo_t* cr)
 
 static void draw_stripe(GtkWidget* widget, WindowData* windata, cairo_t* cr)
 {
-	GtkStyleContext* context;
+	const StyleCache* style;
 	GdkRGBA bg;
 	int              stripe_x;
 	int              stripe_y;
@@ -201,9 +291,7 @@ static void draw_stripe(GtkWidget* widget, WindowData* windata, cairo_t* cr)
 		double           r, g, b;
 	#endif
 
-	context = gtk_widget_get_style_context (widget);
-
-	gtk_style_context_save (context);
+	style = get_style_cache(windata);
 
 	GtkAllocation alloc;
 	gtk_widget_get_allocation(windata->main_hbox, &alloc);
@@ -221,27 +309,19 @@ static void draw_stripe(GtkWidget* widget, WindowData* windata, cairo_t* cr)
 	switch (windata->urgency)
 	{
 		case URGENCY_LOW: // LOW
-			gtk_style_context_set_state (context, GTK_STATE_FLAG_NORMAL);
-			gtk_style_context_add_class (context, GTK_STYLE_CLASS_VIEW);
-			get_background_color (context, GTK_STATE_FLAG_NORMAL, &bg);
-			gdk_cairo_set_source_rgba (cr, &bg);
+			bg = style->stripe_low;
 			break;
 
 		case URGENCY_CRITICAL: // CRITICAL
-			gdk_rgba_parse (&bg, "#CC0000");
+			bg = style->stripe_critical;
 			break;
 
 		case URGENCY_NORMAL: // NORMAL
 		default:
-			gtk_style_context_set_state (context, GTK_STATE_FLAG_SELECTED);
-			gtk_style_context_add_class (context, GTK_STYLE_CLASS_VIEW);
-			get_background_color (context, GTK_STATE_FLAG_SELECTED, &bg);
-			gdk_cairo_set_source_rgba (cr, &bg);
+			bg = style->stripe_normal;
 			break;
 	}
 
-	gtk_style_context_restore (context);
-
 	cairo_rectangle(cr, stripe_x, stripe_y, STRIPE_WIDTH, stripe_height);
 
 	#ifdef ENABLE_GRADIENT_LOOK
@@ -295,12 +375,10 @@ static GtkArrowType get_notification_arrow_type(GtkWidget* nw)
 	}
 }
 
-#define ADD_POINT(_x, _y, shapeoffset_x, shapeoffset_y) \
+#define ADD_POINT(_x, _y) \
 	G_STMT_START { \
 		windata->border_points[i].x = (_x); \
 		windata->border_points[i].y = (_y); \
-		shape_points[i].x = (_x) + (shapeoffset_x); \
-		shape_points[i].y = (_y) + (shapeoffset_y); \
 		i++;\
 	} G_STMT_END
 
@@ -316,7 +394,7 @@ static void create_border_with_arrow(GtkWidget* nw, WindowData* windata)
 	int             arrow_side1_width = DEFAULT_ARROW_WIDTH / 2;
 	int             arrow_side2_width = DEFAULT_ARROW_WIDTH / 2;
 	int             arrow_offset = DEFAULT_ARROW_OFFSET;
-	GdkPoint*       shape_points = NULL;
+	NotifyShape     shape;
 	int             i = 0;
 #if GTK_CHECK_VERSION (3, 22, 0)
 	GdkMonitor*     monitor;
@@ -394,7 +472,6 @@ static void create_border_with_arrow(GtkWidget* nw, WindowData* windata)
 			#endif
 
 			windata->border_points = g_new0(GdkPoint, windata->num_border_points);
-			shape_points = g_new0(GdkPoint, windata->num_border_points);
 
 			windata->drawn_arrow_begin_x = arrow_offset;
 			windata->drawn_arrow_middle_x = arrow_offset + arrow_side1_width;
@@ -408,28 +485,28 @@ static void create_border_with_arrow(GtkWidget* nw, WindowData* windata)
 
 				if (arrow_side1_width == 0)
 				{
-					ADD_POINT(0, 0, 0, 0);
+					ADD_POINT(0, 0);
 				}
 				else
 				{
-					ADD_POINT(0, DEFAULT_ARROW_HEIGHT, 0, 0);
+					ADD_POINT(0, DEFAULT_ARROW_HEIGHT);
 
 					if (arrow_offset > 0)
 					{
-						ADD_POINT(arrow_offset - (arrow_side2_width > 0 ? 0 : 1), DEFAULT_ARROW_HEIGHT, 0, 0);
+						ADD_POINT(arrow_offset - (arrow_side2_width > 0 ? 0 : 1), DEFAULT_ARROW_HEIGHT);
 					}
 
-					ADD_POINT(arrow_offset + arrow_side1_width - (arrow_side2_width > 0 ? 0 : 1), 0, 0, 0);
+					ADD_POINT(arrow_offset + arrow_side1_width - (arrow_side2_width > 0 ? 0 : 1), 0);
 				}
 
 				if (arrow_side2_width > 0)
 				{
-					ADD_POINT(windata->drawn_arrow_end_x, windata->drawn_arrow_end_y, 1, 0);
-					ADD_POINT(width - 1, DEFAULT_ARROW_HEIGHT, 1, 0);
+					ADD_POINT(windata->drawn_arrow_end_x, windata->drawn_arrow_end_y);
+					ADD_POINT(width - 1, DEFAULT_ARROW_HEIGHT);
 				}
 
-				ADD_POINT(width - 1, height - 1, 1, 1);
-				ADD_POINT(0, height - 1, 0, 1);
+				ADD_POINT(width - 1, height - 1);
+				ADD_POINT(0, height - 1);
 
 				y = windata->point_y;
 			}
@@ -439,29 +516,29 @@ static void create_border_with_arrow(GtkWidget* nw, WindowData* windata)
 				windata->drawn_arrow_middle_y = height;
 				windata->drawn_arrow_end_y = height - DEFAULT_ARROW_HEIGHT;
 
-				ADD_POINT(0, 0, 0, 0);
-				ADD_POINT(width - 1, 0, 1, 0);
+				ADD_POINT(0, 0);
+				ADD_POINT(width - 1, 0);
 
 				if (arrow_side2_width == 0)
 				{
-					ADD_POINT(width - 1, height, (arrow_side1_width > 0 ? 0 : 1), 0);
+					ADD_POINT(width - 1, height);
 				}
 				else
 				{
-					ADD_POINT(width - 1, height - DEFAULT_ARROW_HEIGHT, 1, 1);
+					ADD_POINT(width - 1, height - DEFAULT_ARROW_HEIGHT);
 
 					if (arrow_offset < width - arrow_side1_width)
 					{
-						ADD_POINT(arrow_offset + arrow_side1_width + arrow_side2_width, height - DEFAULT_ARROW_HEIGHT, 0, 1);
+						ADD_POINT(arrow_offset + arrow_side1_width + arrow_side2_width, height - DEFAULT_ARROW_HEIGHT);
 					}
 
-					ADD_POINT(arrow_offset + arrow_side1_width, height, 0, 1);
+					ADD_POINT(arrow_offset + arrow_side1_width, height);
 				}
 
 				if (arrow_side1_width > 0)
 				{
-					ADD_POINT(windata->drawn_arrow_begin_x - (arrow_side2_width > 0 ? 0 : 1), windata->drawn_arrow_begin_y, 0, 0);
-					ADD_POINT(0, height - DEFAULT_ARROW_HEIGHT, 0, 1);
+					ADD_POINT(windata->drawn_arrow_begin_x - (arrow_side2_width > 0 ? 0 : 1), windata->drawn_arrow_begin_y);
+					ADD_POINT(0, height - DEFAULT_ARROW_HEIGHT);
 				}
 
 				y = windata->point_y - height;
@@ -495,11 +572,23 @@ static void create_border_with_arrow(GtkWidget* nw, WindowData* windata)
 			g_assert_not_reached();
 	}
 
-	g_assert(shape_points != NULL);
-
-	/* FIXME won't work with GTK+3, need a replacement */
-	/*windata->window_region = gdk_region_polygon(shape_points, windata->num_border_points, GDK_EVEN_ODD_RULE);*/
-	g_free(shape_points);
+	g_assert(windata->border_points != NULL);
+
+	/* The body without the arrow strip, plus the arrow itself */
+	shape.body.x = 0;
+	shape.body.y = (arrow_type == GTK_ARROW_UP ? DEFAULT_ARROW_HEIGHT : 0);
+	shape.body.width = width;
+	shape.body.height = height - DEFAULT_ARROW_HEIGHT;
+	shape.radius = 0;
+	shape.has_arrow = TRUE;
+	shape.arrow[0].x = windata->drawn_arrow_begin_x;
+	shape.arrow[0].y = windata->drawn_arrow_begin_y;
+	shape.arrow[1].x = windata->drawn_arrow_middle_x;
+	shape.arrow[1].y = windata->drawn_arrow_middle_y;
+	shape.arrow[2].x = windata->drawn_arrow_end_x;
+	shape.arrow[2].y = windata->drawn_arrow_end_y;
+
+	notify_shape_apply(windata->win, &windata->shape, &shape);
 }
 
 static void draw_border(GtkWidget* widget, WindowData *windata, cairo_t* cr)
@@ -521,27 +610,69 @@ static void draw_border(GtkWidget* widget, WindowData *windata, cairo_t* cr)
 		}
 
 		cairo_close_path(cr);
-		/* FIXME window_region is not set up anyway, see previous fixme */
-		/*gdk_window_shape_combine_region (gtk_widget_get_window (windata->win), windata->window_region, 0, 0);*/
 		g_free(windata->border_points);
 		windata->border_points = NULL;
 	}
 	else
 	{
 		cairo_rectangle(cr, 0.5, 0.5, windata->width - 0.5, windata->height - 0.5);
+
+		notify_shape_apply(windata->win, &windata->shape, NULL);
 	}
 
 	cairo_stroke(cr);
 }
 
+static void invalidate_background(WindowData* windata)
+{
+	if (windata->background != NULL)
+	{
+		cairo_surface_destroy(windata->background);
+		windata->background = NULL;
+	}
+
+	/* The pie cells are drawn over the same background */
+	notify_pie_atlas_clear(&windata->pie_atlas);
+}
+
+static void get_background_key(GtkWidget* widget, WindowData* windata, BackgroundKey* key)
+{
+	GtkAllocation allocation;
+
+	memset(key, 0, sizeof(BackgroundKey));
+
+	gtk_widget_get_allocation(widget, &allocation);
+	key->width = allocation.width;
+	key->height = allocation.height;
+
+	gtk_widget_get_allocation(windata->main_hbox, &allocation);
+	key->stripe_x = allocation.x;
+	key->stripe_y = allocation.y;
+	key->stripe_height = allocation.height;
+
+	key->rtl = gtk_widget_get_direction(widget) == GTK_TEXT_DIR_RTL;
+	key->has_arrow = windata->has_arrow;
+
+	if (windata->has_arrow)
+	{
+		key->point_x = windata->point_x;
+		key->point_y = windata->point_y;
+	}
+
+	key->urgency = windata->urgency;
+	key->composited = windata->composited;
+}
+
 static void
 paint_window (GtkWidget  *widget,
 	      cairo_t    *cr,
 	      WindowData *windata)
 {
 	cairo_t*         cr2;
-	cairo_surface_t* surface;
 	GtkAllocation    allocation;
+	BackgroundKey    key;
+
+	notify_repaint_count_paint();
 
 	gtk_widget_get_allocation(windata->win, &allocation);
 
@@ -551,26 +682,27 @@ paint_window (GtkWidget  *widget,
 			windata->height = allocation.height;
 	}
 
-	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	get_background_key(widget, windata, &key);
 
-	gtk_widget_get_allocation(widget, &allocation);
+	if (windata->background == NULL || memcmp(&key, &windata->background_key, sizeof(BackgroundKey)) != 0)
+	{
+		invalidate_background(windata);
 
-	surface = cairo_surface_create_similar (cairo_get_target (cr),
-						CAIRO_CONTENT_COLOR_ALPHA,
-						allocation.width,
-						allocation.height);
+		windata->background = notify_cache_surface_new (cr, key.width, key.height);
+		windata->background_key = key;
 
-	cr2 = cairo_create (surface);
+		cr2 = cairo_create (windata->background);
 
-	fill_background(widget, windata, cr2);
-	draw_border(widget, windata, cr2);
-	draw_stripe(widget, windata, cr2);
-	cairo_fill (cr2);
-	cairo_destroy (cr2);
+		fill_background(widget, windata, cr2);
+		draw_border(widget, windata, cr2);
+		draw_stripe(widget, windata, cr2);
+		cairo_fill (cr2);
+		cairo_destroy (cr2);
+	}
 
-	cairo_set_source_surface (cr, surface, 0, 0);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_surface (cr, windata->background, 0, 0);
 	cairo_paint(cr);
-	cairo_surface_destroy(surface);
 }
 
 static gboolean
@@ -583,10 +715,10 @@ on_draw (GtkWidget *widget, cairo_t *cr, WindowData *windata)
 
 static void destroy_windata(WindowData* windata)
 {
-	if (windata->window_region != NULL)
-	{
-		cairo_region_destroy(windata->window_region);
-	}
+	notify_cache_remove((NotifyCacheReleaseFunc) invalidate_background, windata);
+	invalidate_background(windata);
+	notify_markup_unref(windata->body);
+	notify_action_pool_free(windata->actions);
 
 	g_free(windata);
 }
@@ -640,15 +772,26 @@ static void update_content_hbox_visibility(WindowData* windata)
 
 static gboolean configure_event_cb(GtkWidget* nw, GdkEventConfigure* event, WindowData* windata)
 {
-	windata->width = event->width;
-	windata->height = event->height;
+	/* Moves, like those of stack shifts, leave everything drawn valid */
+	if (!notify_repaint_configure(&windata->width, &windata->height, event))
+	{
+		return FALSE;
+	}
 
+	/* The arrow side depends on the height */
 	update_spacers(nw);
-	gtk_widget_queue_draw(nw);
+	notify_repaint_queue(nw, NULL);
 
 	return FALSE;
 }
 
+static void style_updated_cb(GtkWidget* nw, WindowData* windata)
+{
+	style_cache.valid = FALSE;
+	invalidate_background(windata);
+	gtk_widget_queue_draw(nw);
+}
+
 static gboolean activate_link(GtkLabel* label, const char* url, WindowData* windata)
 {
 	windata->url_clicked(GTK_WINDOW(windata->win), url);
@@ -690,7 +833,7 @@ GtkWindow* create_notification(UrlClickedCb url_clicked)
 	{
 		gtk_widget_set_visual(win, visual);
 
-		if (gdk_screen_is_composited(screen))
+		if (notify_screen_is_composited(screen))
 		{
 			windata->composited = TRUE;
 		}
@@ -703,9 +846,11 @@ GtkWindow* create_notification(UrlClickedCb url_clicked)
 	gtk_widget_set_size_request(win, WIDTH, -1);
 
 	g_object_set_data_full(G_OBJECT(win), "windata", windata, (GDestroyNotify) destroy_windata);
+	notify_cache_add((NotifyCacheReleaseFunc) invalidate_background, windata);
 	atk_object_set_role(gtk_widget_get_accessible(win), ATK_ROLE_ALERT);
 
 	g_signal_connect(G_OBJECT(win), "configure_event", G_CALLBACK(configure_event_cb), windata);
+	g_signal_connect(G_OBJECT(win), "style-updated", G_CALLBACK(style_updated_cb), windata);
 
 	main_vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
 	gtk_widget_show(main_vbox);
@@ -816,6 +961,8 @@ GtkWindow* create_notification(UrlClickedCb url_clicked)
 	gtk_widget_show(windata->actions_box);
 	gtk_box_pack_start(GTK_BOX(vbox), windata->actions_box, FALSE, TRUE, 0);
 
+	windata->actions = notify_action_pool_new(windata->actions_box, GTK_RELIEF_NORMAL);
+
 	return GTK_WINDOW(win);
 }
 
@@ -862,49 +1009,56 @@ void notification_tick(GtkWindow* nw, glong remaining)
 
 	windata->remaining = remaining;
 
-	if (windata->pie_countdown != NULL)
+	/* Only redraw when the pie actually moved on to another frame */
+	if (windata->pie_countdown != NULL && notify_pie_atlas_needs_redraw(&windata->pie_atlas, remaining, windata->timeout))
+	{
+		GdkRectangle area = { 0, 0, PIE_WIDTH, PIE_HEIGHT };
+
+		notify_repaint_queue(windata->pie_countdown, &area);
+	}
+}
+
+/* Shared by all windows; the summary is plain text, the body markup */
+static PangoAttrList* summary_attrs = NULL;
+static NotifyMarkupCache* body_cache = NULL;
+
+static void init_text_attributes(void)
+{
+	if (body_cache != NULL)
 	{
-		gtk_widget_queue_draw_area(windata->pie_countdown, 0, 0, PIE_WIDTH, PIE_HEIGHT);
+		return;
 	}
+
+	summary_attrs = pango_attr_list_new();
+	pango_attr_list_insert(summary_attrs, pango_attr_weight_new(PANGO_WEIGHT_BOLD));
+	pango_attr_list_insert(summary_attrs, pango_attr_scale_new(PANGO_SCALE_LARGE));
+
+	body_cache = notify_markup_cache_new(NULL);
 }
 
-void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
+/* Sizes the icon box and the labels for what the window shows */
+static void update_size(GtkWindow* nw)
 {
-	char* str;
-	char* quoted;
+	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
 	GtkRequisition req;
-	WindowData* windata;
+	GdkPixbuf* pixbuf;
 
-	windata = g_object_get_data(G_OBJECT(nw), "windata");
 	g_assert(windata != NULL);
 
-	quoted = g_markup_escape_text(summary, -1);
-	str = g_strdup_printf("<b><big>%s</big></b>", quoted);
-	g_free(quoted);
+	pixbuf = gtk_image_get_pixbuf(GTK_IMAGE(windata->icon));
 
-	gtk_label_set_markup(GTK_LABEL(windata->summary_label), str);
-	g_free(str);
-
-	if (pango_parse_markup (body, -1, 0, NULL, NULL, NULL, NULL))
-	{
-		gtk_label_set_markup (GTK_LABEL (windata->body_label), body);
-	}
-	else {
-		gtk_label_set_text (GTK_LABEL (windata->body_label), body);
-	}
-
-	if (body == NULL || *body == '\0')
+	if (pixbuf != NULL)
 	{
-		gtk_widget_hide(windata->body_label);
+		gtk_widget_set_size_request(windata->iconbox, MAX(BODY_X_OFFSET, gdk_pixbuf_get_width(pixbuf)), -1);
 	}
 	else
 	{
-		gtk_widget_show(windata->body_label);
+		gtk_widget_set_size_request(windata->iconbox, BODY_X_OFFSET, -1);
 	}
 
 	update_content_hbox_visibility(windata);
 
-	if (body != NULL && *body != '\0')
+	if (gtk_widget_get_visible(windata->body_label))
 	{
 		gtk_widget_get_preferred_size (windata->iconbox, NULL, &req);
 		/* -1: border width for
@@ -912,13 +1066,45 @@ void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
 		gtk_widget_set_size_request(windata->body_label, WIDTH - (1 * 2) - (10 * 2) - req.width - 6, -1);
 	}
 
-		gtk_widget_get_preferred_size (windata->close_button, NULL, &req);
+	gtk_widget_get_preferred_size (windata->close_button, NULL, &req);
 	/* -1: main_vbox border width
 	 * -10: vbox border width
 	 * -6: spacing for hbox */
 	gtk_widget_set_size_request(windata->summary_label, WIDTH - (1 * 2) - (10 * 2) - SPACER_LEFT - req.width - (6 * 2), -1);
 }
 
+void set_notification_text(GtkWindow* nw, const char* summary, const char* body)
+{
+	WindowData* windata;
+
+	windata = g_object_get_data(G_OBJECT(nw), "windata");
+	g_assert(windata != NULL);
+
+	init_text_attributes();
+
+	if (g_strcmp0(gtk_label_get_text(GTK_LABEL(windata->summary_label)), summary) != 0)
+	{
+		gtk_label_set_text(GTK_LABEL(windata->summary_label), summary);
+		gtk_label_set_attributes(GTK_LABEL(windata->summary_label), summary_attrs);
+	}
+
+	notify_markup_cache_set_label(body_cache, GTK_LABEL(windata->body_label), &windata->body, body);
+
+	if (body == NULL || *body == '\0')
+	{
+		gtk_widget_hide(windata->body_label);
+	}
+	else
+	{
+		gtk_widget_show(windata->body_label);
+	}
+
+	if (!notify_update_in_progress(nw))
+	{
+		update_size(nw);
+	}
+}
+
 void set_notification_icon(GtkWindow* nw, GdkPixbuf* pixbuf)
 {
 	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
@@ -929,84 +1115,74 @@ void set_notification_icon(GtkWindow* nw, GdkPixbuf* pixbuf)
 
 	if (pixbuf != NULL)
 	{
-		int pixbuf_width = gdk_pixbuf_get_width(pixbuf);
-
 		gtk_widget_show(windata->icon);
-		gtk_widget_set_size_request(windata->iconbox, MAX(BODY_X_OFFSET, pixbuf_width), -1);
 	}
 	else
 	{
 		gtk_widget_hide(windata->icon);
-		gtk_widget_set_size_request(windata->iconbox, BODY_X_OFFSET, -1);
 	}
 
-	update_content_hbox_visibility(windata);
+	if (!notify_update_in_progress(nw))
+	{
+		update_size(nw);
+	}
 }
 
 void set_notification_arrow(GtkWidget* nw, gboolean visible, int x, int y)
 {
 	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
+	gboolean changed;
 
 	g_assert(windata != NULL);
 
+	changed = windata->has_arrow != visible || (visible && (windata->point_x != x || windata->point_y != y));
+
 	windata->has_arrow = visible;
 	windata->point_x = x;
 	windata->point_y = y;
 
 	update_spacers(nw);
+
+	/* The border and the shape follow the arrow */
+	if (changed)
+	{
+		notify_repaint_queue(nw, NULL);
+	}
 }
 
 static void
-paint_countdown (GtkWidget  *pie,
-                 cairo_t    *cr,
-                 WindowData *windata)
+draw_countdown_frame (cairo_t    *cr,
+                      gdouble     fraction,
+                      WindowData *windata)
 {
-    GtkStyleContext *context;
-    GdkRGBA bg;
-    GtkAllocation alloc;
-    cairo_t* cr2;
-    cairo_surface_t* surface;
+    fill_background (windata->pie_countdown, windata, cr);
 
-    context = gtk_widget_get_style_context (windata->win);
+    if (fraction < 0)
+    {
+        return;
+    }
 
-    gtk_style_context_save (context);
-    gtk_style_context_set_state (context, GTK_STATE_FLAG_SELECTED);
+    gdk_cairo_set_source_rgba (cr, &get_style_cache (windata)->pie);
 
-    get_background_color (context, GTK_STATE_FLAG_SELECTED, &bg);
+    cairo_move_to (cr, PIE_RADIUS, PIE_RADIUS);
+    cairo_arc_negative (cr, PIE_RADIUS, PIE_RADIUS, PIE_RADIUS, -G_PI_2, -(fraction * G_PI * 2) - G_PI_2);
+    cairo_line_to (cr, PIE_RADIUS, PIE_RADIUS);
+    cairo_fill (cr);
+}
 
-    gtk_style_context_restore (context);
+static void
+paint_countdown (GtkWidget  *pie,
+                 cairo_t    *cr,
+                 WindowData *windata)
+{
+    GtkAllocation alloc;
 
     gtk_widget_get_allocation(pie, &alloc);
     cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-    surface = cairo_surface_create_similar (cairo_get_target(cr),
-                                            CAIRO_CONTENT_COLOR_ALPHA,
-                                            alloc.width,
-                                            alloc.height);
-
-    cr2 = cairo_create (surface);
-
-    fill_background (pie, windata, cr2);
-
-    if (windata->timeout > 0)
-    {
-        gdouble pct = (gdouble) windata->remaining / (gdouble) windata->timeout;
-
-        gdk_cairo_set_source_rgba (cr2, &bg);
 
-        cairo_move_to (cr2, PIE_RADIUS, PIE_RADIUS);
-        cairo_arc_negative (cr2, PIE_RADIUS, PIE_RADIUS, PIE_RADIUS, -G_PI_2, -(pct * G_PI * 2) - G_PI_2);
-        cairo_line_to (cr2, PIE_RADIUS, PIE_RADIUS);
-        cairo_fill (cr2);
-    }
-
-    cairo_destroy(cr2);
-
-    cairo_save (cr);
-    cairo_set_source_surface (cr, surface, 0, 0);
-    cairo_paint (cr);
-    cairo_restore (cr);
-
-    cairo_surface_destroy(surface);
+    notify_pie_atlas_paint (&windata->pie_atlas, cr, alloc.width, alloc.height,
+                            notify_pie_get_frame (windata->remaining, windata->timeout),
+                            (NotifyPieDrawFunc) draw_countdown_frame, windata);
 }
 
 static gboolean
@@ -1017,104 +1193,42 @@ on_countdown_draw (GtkWidget *widget, cairo_t *cr, WindowData *windata)
 	return FALSE;
 }
 
-static void action_clicked_cb(GtkWidget* w, GdkEventButton* event, ActionInvokedCb action_cb)
-{
-	GtkWindow* nw;
-	const char* key;
-	nw = g_object_get_data(G_OBJECT(w), "_nw");
-	key = g_object_get_data(G_OBJECT(w), "_action_key");
-	action_cb(nw, key);
-}
-
 void add_notification_action(GtkWindow* nw, const char* text, const char* key, ActionInvokedCb cb)
 {
 	WindowData* windata;
-	GtkWidget* label;
-	GtkWidget* button;
-	GtkWidget* hbox;
-	GdkPixbuf* pixbuf;
-	char* buf;
 
 	windata = g_object_get_data(G_OBJECT(nw), "windata");
 
 	g_assert(windata != NULL);
 
-	if (gtk_widget_get_visible(windata->actions_box))
+	if (!gtk_widget_get_visible(windata->actions_box))
 	{
 		gtk_widget_show(windata->actions_box);
 		update_content_hbox_visibility(windata);
-
-		/* Don't try to re-add a pie_countdown */
-		if (!windata->pie_countdown) {
-			windata->pie_countdown = gtk_drawing_area_new();
-			gtk_widget_set_halign (windata->pie_countdown, GTK_ALIGN_END);
-			gtk_widget_show(windata->pie_countdown);
-
-			gtk_box_pack_end (GTK_BOX (windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
-			gtk_widget_set_size_request(windata->pie_countdown,
-						    PIE_WIDTH, PIE_HEIGHT);
-			g_signal_connect(G_OBJECT(windata->pie_countdown), "draw",
-					 G_CALLBACK(on_countdown_draw), windata);
-		}
-	}
-
-	if (windata->action_icons) {
-		button = gtk_button_new_from_icon_name(key, GTK_ICON_SIZE_BUTTON);
-		goto add_button;
 	}
 
-	button = gtk_button_new();
-	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
-	gtk_widget_show(hbox);
-	gtk_container_add(GTK_CONTAINER(button), hbox);
-
-	/* Try to be smart and find a suitable icon. */
-	buf = g_strdup_printf("stock_%s", key);
-	pixbuf = gtk_icon_theme_load_icon(gtk_icon_theme_get_for_screen(gdk_window_get_screen(gtk_widget_get_window(GTK_WIDGET(nw)))),
-																	buf, 16, GTK_ICON_LOOKUP_USE_BUILTIN, NULL);
-	g_free(buf);
-
-	if (pixbuf != NULL)
+	/* The pie stays with the buttons when the actions are cleared */
+	if (windata->pie_countdown == NULL)
 	{
-		GtkWidget* image = gtk_image_new_from_pixbuf(pixbuf);
-		gtk_widget_show(image);
-		gtk_box_pack_start(GTK_BOX(hbox), image, FALSE, FALSE, 0);
-		gtk_widget_set_halign (image, GTK_ALIGN_CENTER);
-		gtk_widget_set_valign (image, GTK_ALIGN_CENTER);
-	}
+		windata->pie_countdown = gtk_drawing_area_new();
+		gtk_widget_set_halign(windata->pie_countdown, GTK_ALIGN_END);
+		gtk_widget_show(windata->pie_countdown);
 
-	label = gtk_label_new(NULL);
-	gtk_widget_show(label);
-	gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
-#if GTK_CHECK_VERSION (3, 16, 0)
-	gtk_label_set_xalign (GTK_LABEL (label), 0.0);
-	gtk_label_set_yalign (GTK_LABEL (label), 0.5);
-#else
-	gtk_misc_set_alignment(GTK_MISC(label), 0.0, 0.5);
-#endif
-	buf = g_strdup_printf("<small>%s</small>", text);
-	gtk_label_set_markup(GTK_LABEL(label), buf);
-	g_free(buf);
-
-add_button:
-	gtk_widget_show(button);
-	gtk_box_pack_start(GTK_BOX(windata->actions_box), button, FALSE, FALSE, 0);
-
-	g_object_set_data(G_OBJECT(button), "_nw", nw);
-	g_object_set_data_full(G_OBJECT(button), "_action_key", g_strdup(key), g_free);
-	g_signal_connect(G_OBJECT(button), "button-release-event", G_CALLBACK(action_clicked_cb), cb);
+		gtk_box_pack_end(GTK_BOX(windata->actions_box), windata->pie_countdown, FALSE, TRUE, 0);
+		gtk_widget_set_size_request(windata->pie_countdown, PIE_WIDTH, PIE_HEIGHT);
+		g_signal_connect(G_OBJECT(windata->pie_countdown), "draw", G_CALLBACK(on_countdown_draw), windata);
+	}
 
-	gtk_widget_show_all(windata->actions_box);
+	notify_action_pool_add(windata->actions, nw, text, key, windata->action_icons, (NotifyActionFunc) cb);
 }
 
 void clear_notification_actions(GtkWindow* nw)
 {
 	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
 
-	windata->pie_countdown = NULL;
-
+	/* Buttons are hidden, for the next actions to relabel */
 	gtk_widget_hide(windata->actions_box);
-	gtk_container_foreach(GTK_CONTAINER(windata->actions_box), (GtkCallback) gtk_widget_destroy, NULL);
+	notify_action_pool_clear(windata->actions);
 }
 
 void move_notification(GtkWidget* nw, int x, int y)
@@ -1147,3 +1261,80 @@ gboolean theme_check_init(unsigned int major_ver, unsigned int minor_ver, unsign
 {
 	return major_ver == NOTIFICATION_DAEMON_MAJOR_VERSION && minor_ver == NOTIFICATION_DAEMON_MINOR_VERSION && micro_ver == NOTIFICATION_DAEMON_MICRO_VERSION;
 }
+
+static void set_content_hints(GtkWindow* nw, guint8 urgency, gboolean action_icons)
+{
+	WindowData* windata = g_object_get_data(G_OBJECT(nw), "windata");
+
+	g_assert(windata != NULL);
+
+	windata->urgency = urgency;
+	windata->action_icons = action_icons;
+	gtk_window_set_title(nw, urgency == URGENCY_CRITICAL ? "Critical Notification" : "Notification");
+}
+
+static const NotifyUpdateFuncs update_funcs = {
+	set_content_hints,
+	set_notification_text,
+	set_notification_icon,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	set_notification_timeout,
+	update_size
+};
+
+static void set_notification_content(GtkWindow* nw, const NotificationContent* content)
+{
+	notify_update_apply(nw, content, &update_funcs);
+}
+
+static const NotifyEngineVTable engine_vtable = {
+	sizeof(NotifyEngineVTable),
+	NOTIFY_ENGINE_ABI_VERSION,
+	0,
+
+	"Standard",
+	PACKAGE_VERSION,
+	"Christian Hammond",
+	"http://www.galago-project.org/",
+
+	create_notification,
+	set_notification_text,
+	set_notification_icon,
+	(void (*) (GtkWindow*, gboolean, int, int)) set_notification_arrow,
+	(void (*) (GtkWindow*, const char*, const char*, GCallback)) add_notification_action,
+	clear_notification_actions,
+	(void (*) (GtkWindow*, int, int)) move_notification,
+
+	NULL,
+	NULL,
+	NULL,
+	set_notification_hints,
+	set_notification_timeout,
+	notification_tick,
+	NULL,
+	set_notification_content,
+	notify_repaint_get_counts,
+	notify_cache_get_size,
+	notify_cache_release
+};
+
+const NotifyEngineVTable* NOTIFY_ENGINE_GET_VTABLE(guint abi_version)
+{
+	return &engine_vtable;
+}
+
+#ifndef NOTIFY_ENGINE_BUILTIN
+/* The shared text attributes must not outlive the module */
+G_MODULE_EXPORT void g_module_unload(GModule* module)
+{
+	if (summary_attrs != NULL)
+	{
+		pango_attr_list_unref(summary_attrs);
+	}
+
+	notify_markup_cache_free(body_cache);
+	notify_action_icon_cache_free();
+}
+#endif